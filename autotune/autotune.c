@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include "mpi.h"
+#include "autotune.h"
+#include "../operations/operations.h"
+#include "../fft_convolution/fft_convolution.h"
+#include "../specialized_kernels/specialized_kernels.h"
+
+/* Every trial runs this many times and keeps its fastest run, the first one paying for page faults and FFT plans */
+#define TRIAL_REPEATS 3
+
+/* Largest FFT tile side tried */
+#define MAX_TUNED_FFT_TILE_SIZE 512
+
+typedef struct {
+    omp_sched_t schedule;
+    int chunk_size;
+} ScheduleCandidate;
+
+static const ScheduleCandidate schedule_candidates[] = {
+    { omp_sched_static, 0 },
+    { omp_sched_static, 1 },
+    { omp_sched_dynamic, 1 },
+    { omp_sched_dynamic, 4 },
+    { omp_sched_dynamic, 16 },
+    { omp_sched_guided, 0 }
+};
+
+const char *schedule_name(
+    omp_sched_t schedule    /* in */
+) {
+    switch (schedule) {
+        case omp_sched_dynamic:
+            return "dynamic";
+        case omp_sched_guided:
+            return "guided";
+        case omp_sched_static:
+        default:
+            return "static";
+    }
+}
+
+static int parse_schedule_name(
+    const char *name,           /* in */
+    omp_sched_t *schedule       /* out */
+) {
+    if (strcmp(name, "static") == 0) {
+        *schedule = omp_sched_static;
+    } else if (strcmp(name, "dynamic") == 0) {
+        *schedule = omp_sched_dynamic;
+    } else if (strcmp(name, "guided") == 0) {
+        *schedule = omp_sched_guided;
+    } else {
+        return 1;
+    }
+    return 0;
+}
+
+void tuning_profile_file_name(
+    char *file_name,        /* out */
+    size_t file_name_size   /* in */
+) {
+    const char *path = getenv("IMAGE_TRANSFORMER_PROFILE");
+    if (path && *path) {
+        snprintf(file_name, file_name_size, "%s", path);
+        return;
+    }
+
+    char host_name[64];
+    if (gethostname(host_name, sizeof(host_name)) != 0) {
+        strcpy(host_name, "unknown");
+    }
+    host_name[sizeof(host_name) - 1] = '\0';
+
+    const char *home = getenv("HOME");
+    snprintf(file_name, file_name_size, "%s/.image_transformer_%s", (home && *home) ? home : ".", host_name);
+}
+
+int load_tuning_profile(
+    const char *file_name,      /* in */
+    TuningProfile *profile      /* out */
+) {
+    FILE *file = fopen(file_name, "r");
+    if (!file) {
+        return 1;
+    }
+
+    char schedule[16];
+    int read = fscanf(
+        file,
+        " threads %d schedule %15s chunk %d fft_crossover %d fft_tile %d",
+        &profile->number_of_threads,
+        schedule,
+        &profile->chunk_size,
+        &profile->fft_crossover_kernel_size,
+        &profile->fft_tile_size
+    );
+    fclose(file);
+
+    if (read != 5 || parse_schedule_name(schedule, &profile->schedule) || profile->number_of_threads < 1
+            || profile->chunk_size < 0 || profile->fft_crossover_kernel_size < 1 || profile->fft_tile_size < 0) {
+        return 1;
+    }
+
+    return 0;
+}
+
+int save_tuning_profile(
+    const char *file_name,          /* in */
+    const TuningProfile *profile    /* in */
+) {
+    FILE *file = fopen(file_name, "w");
+    if (!file) {
+        return 1;
+    }
+
+    fprintf(file, "threads %d\n", profile->number_of_threads);
+    fprintf(file, "schedule %s\n", schedule_name(profile->schedule));
+    fprintf(file, "chunk %d\n", profile->chunk_size);
+    fprintf(file, "fft_crossover %d\n", profile->fft_crossover_kernel_size);
+    fprintf(file, "fft_tile %d\n", profile->fft_tile_size);
+
+    return (fclose(file) == 0) ? 0 : 1;
+}
+
+void apply_tuning_profile(
+    const TuningProfile *profile    /* in */
+) {
+    omp_set_schedule(profile->schedule, profile->chunk_size);
+    set_fft_convolution_parameters(profile->fft_crossover_kernel_size, profile->fft_tile_size);
+}
+
+/*
+ * Returns the fastest of TRIAL_REPEATS runs, each timed on the slowest process; the direct
+ * trials run the specialization convolution() would pick for the kernel, when there is one
+ */
+static double time_trial(
+    MPI_Comm communicator,          /* in */
+    int number_of_threads,          /* in */
+    int use_fft,                    /* in */
+    const RGB *band_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_band,                  /* out */
+    int height,                     /* in */
+    int width,                      /* in */
+    const double *kernel,           /* in */
+    int kernel_size,                /* in */
+    int padding                     /* in */
+) {
+    double best = 0.0;
+
+    SpecializedConvolution specialized_convolution = find_specialized_convolution(kernel, kernel_size);
+
+    for (int repeat = 0; repeat < TRIAL_REPEATS; repeat++) {
+        MPI_Barrier(communicator);
+        double start = MPI_Wtime();
+
+        if (use_fft) {
+            fft_convolution(number_of_threads, band_with_padding, height_with_padding, width_with_padding, new_band, height, width, kernel, kernel_size, padding, NULL);
+        } else if (specialized_convolution) {
+            specialized_convolution(number_of_threads, band_with_padding, width_with_padding, new_band, height, width, kernel, padding, NULL);
+        } else {
+            direct_convolution(number_of_threads, band_with_padding, height_with_padding, width_with_padding, new_band, height, width, kernel, kernel_size, padding, NULL);
+        }
+
+        double elapsed = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, communicator);
+
+        if (repeat == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+void tune_convolution(
+    int process_rank,               /* in */
+    MPI_Comm communicator,          /* in */
+    int max_threads,                /* in */
+    const RGB *band_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_band,                  /* out */
+    int height,                     /* in */
+    int width,                      /* in */
+    const double *kernel,           /* in */
+    int kernel_size,                /* in */
+    int padding,                    /* in */
+    TuningProfile *profile,         /* in / out */
+    double *single_thread_time,     /* out */
+    double *best_time               /* out */
+) {
+    int number_of_schedules = sizeof(schedule_candidates) / sizeof(schedule_candidates[0]);
+    int halo = kernel_size - 1;
+
+    double best_direct_time = -1.0;
+    double best_fft_time = -1.0;
+    int best_direct_threads = 1;
+    int best_fft_threads = 1;
+    ScheduleCandidate best_schedule = schedule_candidates[0];
+    int best_tile_size = 0;
+
+    *single_thread_time = -1.0;
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\n%8s %10s %6s %10s %12s\n", "threads", "engine", "chunk", "schedule", "seconds");
+    }
+
+    /* Powers of two below max_threads, then max_threads itself */
+    int thread_counts[8 * sizeof(int)];
+    int number_of_thread_counts = 0;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts[number_of_thread_counts++] = threads;
+    }
+    thread_counts[number_of_thread_counts++] = max_threads;
+
+    for (int t = 0; t < number_of_thread_counts; t++) {
+        int threads = thread_counts[t];
+
+        for (int s = 0; s < number_of_schedules; s++) {
+            omp_set_schedule(schedule_candidates[s].schedule, schedule_candidates[s].chunk_size);
+
+            double elapsed = time_trial(communicator, threads, 0, band_with_padding, height_with_padding, width_with_padding, new_band, height, width, kernel, kernel_size, padding);
+
+            if (process_rank == 0) {
+                fprintf(stdout, "%8d %10s %6d %10s %12.6f\n", threads, "direct", schedule_candidates[s].chunk_size, schedule_name(schedule_candidates[s].schedule), elapsed);
+            }
+
+            if (threads == 1 && (*single_thread_time < 0.0 || elapsed < *single_thread_time)) {
+                *single_thread_time = elapsed;
+            }
+            if (best_direct_time < 0.0 || elapsed < best_direct_time) {
+                best_direct_time = elapsed;
+                best_direct_threads = threads;
+                best_schedule = schedule_candidates[s];
+            }
+        }
+
+        /* Tile side 0 is the one derived from the kernel size */
+        for (int tile_size = 0; tile_size <= MAX_TUNED_FFT_TILE_SIZE; tile_size = (tile_size == 0) ? 64 : 2 * tile_size) {
+            if (tile_size > 0 && tile_size < 2 * halo) {
+                continue;
+            }
+            set_fft_convolution_parameters(profile->fft_crossover_kernel_size, tile_size);
+
+            double elapsed = time_trial(communicator, threads, 1, band_with_padding, height_with_padding, width_with_padding, new_band, height, width, kernel, kernel_size, padding);
+
+            if (process_rank == 0) {
+                fprintf(stdout, "%8d %10s %6d %10s %12.6f\n", threads, "fft", tile_size, "tile", elapsed);
+            }
+
+            if (best_fft_time < 0.0 || elapsed < best_fft_time) {
+                best_fft_time = elapsed;
+                best_fft_threads = threads;
+                best_tile_size = tile_size;
+            }
+        }
+    }
+    fflush(stdout);
+
+    /* One kernel size only tells on which side of the crossover it lies */
+    int use_fft = (best_fft_time < best_direct_time);
+    if (use_fft && kernel_size < profile->fft_crossover_kernel_size) {
+        profile->fft_crossover_kernel_size = kernel_size;
+    } else if (!use_fft && kernel_size >= profile->fft_crossover_kernel_size) {
+        profile->fft_crossover_kernel_size = kernel_size + 1;
+    }
+
+    profile->number_of_threads = use_fft ? best_fft_threads : best_direct_threads;
+    profile->schedule = best_schedule.schedule;
+    profile->chunk_size = best_schedule.chunk_size;
+    profile->fft_tile_size = best_tile_size;
+
+    *best_time = use_fft ? best_fft_time : best_direct_time;
+
+    apply_tuning_profile(profile);
+}
\ No newline at end of file
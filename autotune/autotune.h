@@ -0,0 +1,71 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stddef.h>
+#include <omp.h>
+#include "mpi.h"
+#include "../bmp_image.h"
+
+/* Best convolution settings measured on one host, saved so that later runs pick them up */
+typedef struct {
+    int number_of_threads;
+    omp_sched_t schedule;
+    int chunk_size;                 /* 0 for the default chunk of the schedule */
+    int fft_crossover_kernel_size;
+    int fft_tile_size;              /* 0 for tiles derived from the kernel size */
+} TuningProfile;
+
+/* Returns the name used for the schedule in profiles: static, dynamic or guided */
+const char *schedule_name(
+    omp_sched_t schedule
+);
+
+/* Returns the profile of this host: $IMAGE_TRANSFORMER_PROFILE, or ~/.image_transformer_<host name> */
+void tuning_profile_file_name(
+    char *file_name,
+    size_t file_name_size
+);
+
+/* Returns 0 when the profile was read, 1 when the file is missing or malformed */
+int load_tuning_profile(
+    const char *file_name,
+    TuningProfile *profile
+);
+
+/* Returns 0 when the profile was written */
+int save_tuning_profile(
+    const char *file_name,
+    const TuningProfile *profile
+);
+
+/* Sets the OpenMP schedule and the FFT parameters used by convolution() */
+void apply_tuning_profile(
+    const TuningProfile *profile
+);
+
+/*
+ * Times trial convolutions of a padded sample band on every process at once, so
+ * that processes sharing a host contend as in real runs. Sweeps thread counts up
+ * to max_threads, the schedules of the direct engine and the tile sides of the FFT
+ * engine, and returns the fastest settings, the same on every process. The
+ * elapsed time of every trial is the slowest process's.
+ */
+void tune_convolution(
+    int process_rank,
+    MPI_Comm communicator,
+    int max_threads,
+    const RGB *band_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_band,
+    int height,
+    int width,
+    const double *kernel,
+    int kernel_size,
+    int padding,
+    TuningProfile *profile,
+    double *single_thread_time,
+    double *best_time
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "bilateral_grid.h"
+#include "../luma/luma.h"
+
+/* Cells the blur reaches on either side of a cell */
+#define BILATERAL_GRID_BLUR_REACH 2
+
+/* Sums of the blue, green and red channels and the number of pixels splatted, in homogeneous coordinates */
+#define BILATERAL_GRID_CHANNELS 4
+
+/* Cell of a coordinate that pixels splat into, the nearest one */
+static inline int splat_cell(double coordinate, double sampling) {
+    return (int)floor(coordinate / sampling + 0.5);
+}
+
+int bilateral_grid_padding(
+    double spatial_sigma    /* in */
+) {
+    /* A row slices cells floor(y / sigma) and the next one, which the blur feeds from two cells further each way */
+    return (int)ceil((BILATERAL_GRID_BLUR_REACH + 1.5) * spatial_sigma) + 1;
+}
+
+/* Blurs the grid along one axis with the 1 4 6 4 1 binomial filter, cells outside the grid being empty */
+static void blur_grid_axis(
+    int number_of_threads,  /* in */
+    const float *grid,      /* in */
+    float *blurred_grid,    /* out */
+    int outer_size,         /* in */
+    int axis_size,          /* in */
+    int inner_size          /* in */
+) {
+    static const float weights[2 * BILATERAL_GRID_BLUR_REACH + 1] = { 1.0f / 16.0f, 4.0f / 16.0f, 6.0f / 16.0f, 4.0f / 16.0f, 1.0f / 16.0f };
+
+    #pragma omp parallel for num_threads(number_of_threads) collapse(2) schedule(static)
+    for (int outer = 0; outer < outer_size; outer++) {
+        for (int cell = 0; cell < axis_size; cell++) {
+            float *destination = blurred_grid + ((size_t)outer * axis_size + cell) * inner_size;
+            memset(destination, 0, inner_size * sizeof(float));
+
+            for (int tap = -BILATERAL_GRID_BLUR_REACH; tap <= BILATERAL_GRID_BLUR_REACH; tap++) {
+                if (cell + tap < 0 || cell + tap >= axis_size) {
+                    continue;
+                }
+                const float *source = grid + ((size_t)outer * axis_size + cell + tap) * inner_size;
+                float weight = weights[tap + BILATERAL_GRID_BLUR_REACH];
+                for (int i = 0; i < inner_size; i++) {
+                    destination[i] += weight * source[i];
+                }
+            }
+        }
+    }
+}
+
+void bilateral_grid_filter(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* out */
+    int height,                     /* in */
+    int width,                      /* in */
+    double spatial_sigma,           /* in */
+    double range_sigma,             /* in */
+    int padding,                    /* in */
+    int first_row,                  /* in */
+    int image_height,               /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    if (height == 0) {
+        return;
+    }
+
+    /* Grid rows sliced by the strip, widened by the blur reach; the first one is grid row 0 */
+    int first_cell_row = (int)floor(first_row / spatial_sigma) - BILATERAL_GRID_BLUR_REACH;
+    int last_cell_row = (int)floor((first_row + height - 1) / spatial_sigma) + 1 + BILATERAL_GRID_BLUR_REACH;
+    int rows = last_cell_row - first_cell_row + 1;
+
+    /* Columns and luma levels start BILATERAL_GRID_BLUR_REACH cells in, leaving room for the blur */
+    int columns = splat_cell(width - 1, spatial_sigma) + 2 + 2 * BILATERAL_GRID_BLUR_REACH;
+    int levels = splat_cell(255.0, range_sigma) + 2 + 2 * BILATERAL_GRID_BLUR_REACH;
+
+    size_t grid_size = (size_t)rows * columns * levels * BILATERAL_GRID_CHANNELS;
+    float *grid = (float *)calloc(grid_size, sizeof(float));
+    float *blurred_grid = (float *)malloc(grid_size * sizeof(float));
+    int *first_strip_rows = (int *)malloc((rows + 1) * sizeof(int));
+    if (!grid || !blurred_grid || !first_strip_rows) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* Padded strip rows splatting into every grid row, contiguous since the cell grows with the row */
+    int strip_row = 0;
+    for (int row = 0; row <= rows; row++) {
+        while (strip_row < height_with_padding) {
+            int image_row = first_row - padding + strip_row;
+            if (image_row >= 0 && (image_row >= image_height || splat_cell(image_row, spatial_sigma) - first_cell_row >= row)) {
+                break;
+            }
+            strip_row++;
+        }
+        first_strip_rows[row] = strip_row;
+    }
+
+    /* Every thread splats whole grid rows, in the same order whatever the strips, so that the sums do not depend on them */
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int row = 0; row < rows; row++) {
+        float *grid_row = grid + (size_t)row * columns * levels * BILATERAL_GRID_CHANNELS;
+
+        for (int y = first_strip_rows[row]; y < first_strip_rows[row + 1]; y++) {
+            const RGB *pixels = data_with_padding + y * width_with_padding + padding;
+            for (int x = 0; x < width; x++) {
+                int column = splat_cell(x, spatial_sigma) + BILATERAL_GRID_BLUR_REACH;
+                int level = splat_cell(luma_of_pixel(pixels[x]), range_sigma) + BILATERAL_GRID_BLUR_REACH;
+
+                float *cell = grid_row + ((size_t)column * levels + level) * BILATERAL_GRID_CHANNELS;
+                cell[0] += pixels[x].b;
+                cell[1] += pixels[x].g;
+                cell[2] += pixels[x].r;
+                cell[3] += 1.0f;
+            }
+        }
+    }
+
+    blur_grid_axis(number_of_threads, grid, blurred_grid, 1, rows, columns * levels * BILATERAL_GRID_CHANNELS);
+    blur_grid_axis(number_of_threads, blurred_grid, grid, rows, columns, levels * BILATERAL_GRID_CHANNELS);
+    blur_grid_axis(number_of_threads, grid, blurred_grid, rows * columns, levels, BILATERAL_GRID_CHANNELS);
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < height; y++) {
+        double cell_y = (first_row + y) / spatial_sigma;
+        int row = (int)floor(cell_y);
+        double weight_y = cell_y - row;
+        row -= first_cell_row;
+
+        const RGB *pixels = data_with_padding + (y + padding) * width_with_padding + padding;
+        for (int x = 0; x < width; x++) {
+            double cell_x = x / spatial_sigma;
+            int column = (int)floor(cell_x);
+            double weight_x = cell_x - column;
+            column += BILATERAL_GRID_BLUR_REACH;
+
+            double cell_z = luma_of_pixel(pixels[x]) / range_sigma;
+            int level = (int)floor(cell_z);
+            double weight_z = cell_z - level;
+            level += BILATERAL_GRID_BLUR_REACH;
+
+            double accumulators[BILATERAL_GRID_CHANNELS] = { 0.0, 0.0, 0.0, 0.0 };
+            for (int corner = 0; corner < 8; corner++) {
+                int dy = corner >> 2;
+                int dx = (corner >> 1) & 1;
+                int dz = corner & 1;
+                double weight = (dy ? weight_y : 1.0 - weight_y) * (dx ? weight_x : 1.0 - weight_x) * (dz ? weight_z : 1.0 - weight_z);
+
+                const float *cell = blurred_grid + (((size_t)(row + dy) * columns + column + dx) * levels + level + dz) * BILATERAL_GRID_CHANNELS;
+                for (int channel = 0; channel < BILATERAL_GRID_CHANNELS; channel++) {
+                    accumulators[channel] += weight * cell[channel];
+                }
+            }
+
+            /* The pixel itself always lies in a neighbouring cell, so the weight is never zero */
+            store_pixel(
+                &new_data[y * width + x],
+                accumulators[0] / accumulators[3] + 0.5,
+                accumulators[1] / accumulators[3] + 0.5,
+                accumulators[2] / accumulators[3] + 0.5,
+                epilogue
+            );
+        }
+    }
+
+    free(grid);
+    free(blurred_grid);
+    free(first_strip_rows);
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef BILATERAL_GRID_H
+#define BILATERAL_GRID_H
+
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/* Returns the halo depth the bilateral grid needs around every strip for the given spatial sigma */
+int bilateral_grid_padding(
+    double spatial_sigma
+);
+
+/*
+ * Edge-preserving smoothing with a bilateral grid (Chen, Paris and Durand): the
+ * pixels are splatted into a grid of spatial_sigma pixel cells by range_sigma
+ * luma levels, the grid is blurred with a separable 5-tap binomial filter and
+ * every pixel is sliced back from it by trilinear interpolation, in constant
+ * time per pixel whatever the sigmas. The grid is aligned on the image, not on
+ * the strip, so that strips give the same pixels as the whole image; halo rows
+ * outside the image, rows first_row - padding and image_height onwards, are
+ * left out rather than taken as zeros or replicas.
+ */
+void bilateral_grid_filter(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    double spatial_sigma,
+    double range_sigma,
+    int padding,
+    int first_row,
+    int image_height,
+    const Epilogue *epilogue
+);
+
+#endif
\ No newline at end of file
@@ -2,7 +2,7 @@
 #include <stdlib.h>
 #include "bmp_io.h"
 
-/* Reads a 24-bit BMP file, builds an Image struct and returns it */
+/* Reads a 24-bit, 32-bit or 8-bit paletted BMP file, bottom-up or top-down, builds an Image struct and returns it */
 Image *read_image_from_BMP_file(const char *file_name) {
     FILE *file = fopen(file_name, "rb");
     if (!file) {
@@ -27,14 +27,47 @@ Image *read_image_from_BMP_file(const char *file_name) {
     int width = *(int *)&header[18];
     int height = *(int *)&header[22];
     int bits_per_pixel = *(short *)&header[28];
+    int compression = *(int *)&header[30];
 
-    if (bits_per_pixel != 24) {
-        fprintf(stderr, "Error: Only 24-bit BMPs are supported\n");
+    /* A negative height stores the top row first */
+    int top_down = (height < 0);
+    if (top_down) {
+        height = -height;
+    }
+
+    /* 32-bit bit field BMPs are only read when their masks are the usual BGRX ones */
+    unsigned int masks[3] = { 0x00ff0000, 0x0000ff00, 0x000000ff };
+    if (bits_per_pixel == 32 && compression == 3 && fread(masks, sizeof(unsigned int), 3, file) != 3) {
+        masks[0] = 0;
+    }
+
+    if ((bits_per_pixel != 24 && bits_per_pixel != 32 && bits_per_pixel != 8)
+            || (compression != 0 && !(bits_per_pixel == 32 && compression == 3))
+            || masks[0] != 0x00ff0000 || masks[1] != 0x0000ff00 || masks[2] != 0x000000ff) {
+        fprintf(stderr, "Error: Only uncompressed 24-bit, 32-bit and 8-bit BMPs are supported\n");
         fclose(file);
         return NULL;
     }
 
-    int row_with_padding_size = (width * 3 + 3) & (~3);
+    /* 8-bit pixels index the palette that follows the DIB header, e.g. the grays of luma outputs */
+    unsigned char palette[256 * 4] = { 0 };
+    if (bits_per_pixel == 8) {
+        int dib_header_size = *(int *)&header[14];
+        int number_of_colors = *(int *)&header[46];
+        if (number_of_colors <= 0 || number_of_colors > 256) {
+            number_of_colors = 256;
+        }
+        fseek(file, 14 + dib_header_size, SEEK_SET);
+        if (fread(palette, 4, number_of_colors, file) != (size_t)number_of_colors) {
+            fprintf(stderr, "Error: Invalid BMP palette\n");
+            fclose(file);
+            return NULL;
+        }
+    }
+    fseek(file, *(int *)&header[10], SEEK_SET);
+
+    int bytes_per_pixel = bits_per_pixel / 8;
+    int row_with_padding_size = (width * bytes_per_pixel + 3) & (~3);
     unsigned char *row_with_padding = (unsigned char *)malloc(row_with_padding_size * sizeof(unsigned char));
     if (!row_with_padding) {
         fprintf(stderr, "Error: Memory allocation failed\n");
@@ -52,10 +85,12 @@ Image *read_image_from_BMP_file(const char *file_name) {
 
     for (int y = 0; y < height; y++) {
         fread(row_with_padding, sizeof(unsigned char), row_with_padding_size, file);
+        RGB *row = data + (top_down ? y : height - 1 - y) * width;
         for (int x = 0; x < width; x++) {
-            data[(height - 1 - y) * width + x].b = row_with_padding[x * 3];
-            data[(height - 1 - y) * width + x].g = row_with_padding[x * 3 + 1];
-            data[(height - 1 - y) * width + x].r = row_with_padding[x * 3 + 2];
+            const unsigned char *bgr = (bytes_per_pixel == 1) ? &palette[row_with_padding[x] * 4] : &row_with_padding[x * bytes_per_pixel];
+            row[x].b = bgr[0];
+            row[x].g = bgr[1];
+            row[x].r = bgr[2];
         }
     }
     
@@ -3,7 +3,7 @@
 
 #include "../bmp_image.h"
 
-/* Reads a 24-bit BMP file, builds an Image struct and returns it */
+/* Reads a 24-bit, 32-bit or 8-bit paletted BMP file, bottom-up or top-down, builds an Image struct and returns it */
 Image *read_image_from_BMP_file(const char *file_name);
 
 /* Saves an Image struct in the given file in the 24-bit BMP format */
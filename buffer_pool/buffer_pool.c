@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <omp.h>
+#include "mpi.h"
+#include "buffer_pool.h"
+
+/* Below one huge page capacities are powers of two, from it they are multiples of it */
+#define SMALLEST_CAPACITY 64
+
+/* Largest capacity handed out, beyond which a request is taken for exhausted memory */
+#define LARGEST_CAPACITY ((size_t)1 << 47)
+
+/* Released buffers are kept up to this count and this many bytes, the ones released first being freed first */
+#define MAX_KEPT_BUFFERS 64
+#define MAX_KEPT_BYTES ((size_t)512 << 20)
+
+/* The capacity is stored in front of every buffer, in a header that keeps the data cache line aligned */
+#define BUFFER_HEADER_SIZE 64
+
+/* Buffers of at least one transparent huge page are aligned on it and advised to use huge pages */
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+/* Distance between the bytes written by the first touch, the smallest page size */
+#define FIRST_TOUCH_STRIDE 4096
+
+/* Kept buffers in the order of their release, and the sum of their capacities */
+static void *kept_buffers[MAX_KEPT_BUFFERS];
+static int number_of_kept_buffers;
+static size_t kept_bytes;
+
+/* Large buffers are only rounded to the next huge page, so that images of close sizes do not pin twice their size */
+static size_t capacity_of_size(size_t size) {
+    if (size >= HUGE_PAGE_SIZE) {
+        return (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    }
+
+    size_t capacity = SMALLEST_CAPACITY;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+static size_t capacity_of_buffer(const void *buffer) {
+    return *(const size_t *)((const unsigned char *)buffer - BUFFER_HEADER_SIZE);
+}
+
+/* Takes the kept buffer at index out of the pool and returns it */
+static void *take_kept_buffer(int index) {
+    void *buffer = kept_buffers[index];
+
+    for (int i = index + 1; i < number_of_kept_buffers; i++) {
+        kept_buffers[i - 1] = kept_buffers[i];
+    }
+    number_of_kept_buffers--;
+    kept_bytes -= capacity_of_buffer(buffer);
+
+    return buffer;
+}
+
+/* Returns a buffer of at least size bytes; fresh tells whether its pages have never been touched */
+static void *acquire_pooled_buffer(
+    size_t size,    /* in */
+    int *fresh      /* out */
+) {
+    if (size > LARGEST_CAPACITY) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        return NULL;
+    }
+
+    size_t capacity = capacity_of_size(size);
+
+    /* The buffer released last is the likeliest to still be in the caches */
+    for (int i = number_of_kept_buffers - 1; i >= 0; i--) {
+        if (capacity_of_buffer(kept_buffers[i]) == capacity) {
+            *fresh = 0;
+            return take_kept_buffer(i);
+        }
+    }
+
+    size_t block_size = BUFFER_HEADER_SIZE + capacity;
+    size_t alignment = (block_size >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : BUFFER_HEADER_SIZE;
+
+    unsigned char *block = NULL;
+    if (posix_memalign((void **)&block, alignment, block_size) != 0) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* Only advice: without transparent huge pages the buffer keeps regular pages */
+    if (alignment == HUGE_PAGE_SIZE) {
+        madvise(block, block_size & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+    }
+#endif
+
+    *(size_t *)block = capacity;
+    *fresh = 1;
+
+    return block + BUFFER_HEADER_SIZE;
+}
+
+void *acquire_buffer(
+    size_t size     /* in */
+) {
+    int fresh;
+    return acquire_pooled_buffer(size, &fresh);
+}
+
+void *acquire_image_buffer(
+    size_t size,            /* in */
+    size_t row_size,        /* in */
+    int number_of_threads   /* in */
+) {
+    int fresh;
+    unsigned char *buffer = (unsigned char *)acquire_pooled_buffer(size, &fresh);
+
+    /* A pooled buffer keeps the placement of its first use, only fresh pages are touched */
+    if (fresh && number_of_threads > 1 && row_size > 0) {
+        long number_of_rows = (long)(size / row_size);
+
+        #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+        for (long row = 0; row < number_of_rows; row++) {
+            unsigned char *row_start = buffer + row * row_size;
+            for (size_t offset = 0; offset < row_size; offset += FIRST_TOUCH_STRIDE) {
+                row_start[offset] = 0;
+            }
+        }
+    }
+
+    return buffer;
+}
+
+void release_buffer(
+    void *buffer    /* in */
+) {
+    if (!buffer) {
+        return;
+    }
+
+    size_t capacity = capacity_of_buffer(buffer);
+
+    if (capacity > MAX_KEPT_BYTES) {
+        free((unsigned char *)buffer - BUFFER_HEADER_SIZE);
+        return;
+    }
+
+    /* The buffers released first make room, so that the pool follows the sizes of the current images */
+    while (number_of_kept_buffers == MAX_KEPT_BUFFERS || kept_bytes + capacity > MAX_KEPT_BYTES) {
+        free((unsigned char *)take_kept_buffer(0) - BUFFER_HEADER_SIZE);
+    }
+
+    kept_buffers[number_of_kept_buffers++] = buffer;
+    kept_bytes += capacity;
+}
+
+void free_buffer_pool(void) {
+    while (number_of_kept_buffers > 0) {
+        free((unsigned char *)take_kept_buffer(number_of_kept_buffers - 1) - BUFFER_HEADER_SIZE);
+    }
+}
\ No newline at end of file
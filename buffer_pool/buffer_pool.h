@@ -0,0 +1,41 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Pool of image buffers. Requests are rounded to a power of two below 2 MiB and
+ * to a multiple of 2 MiB above, and a released buffer is handed out again to the
+ * next request of its size class, so that a long-running process stops paying for
+ * fresh allocations and page faults on every image. The pool keeps a bounded
+ * number of buffers and of bytes, freeing the buffers released first to make room.
+ * Buffers of 2 MiB and more are backed by transparent huge pages where the kernel
+ * provides them. Buffers are not zeroed. Only the master thread may use the pool.
+ */
+
+/* Returns a buffer of at least size bytes, aborting when memory is exhausted */
+void *acquire_buffer(
+    size_t size
+);
+
+/*
+ * Same as acquire_buffer() for a buffer of rows of row_size bytes. When the buffer
+ * is freshly allocated, number_of_threads threads first touch its rows with the
+ * static schedule of the compute loops, so that on NUMA nodes every page lands
+ * next to the thread that will process it.
+ */
+void *acquire_image_buffer(
+    size_t size,
+    size_t row_size,
+    int number_of_threads
+);
+
+/* Gives a buffer obtained from acquire_buffer() back to the pool; NULL is ignored */
+void release_buffer(
+    void *buffer
+);
+
+/* Frees every buffer kept by the pool */
+void free_buffer_pool(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "fft_convolution.h"
+
+#define MAX_FFT_LOG2_SIZE 30
+
+/* Smallest FFT tile side, so that small kernels still get tiles with a useful valid area */
+#define MIN_FFT_TILE_SIZE 64
+
+/* Number of tile columns gathered together before being transformed as contiguous arrays */
+#define COLUMN_BLOCK_SIZE 16
+
+/* Keeps results such as 99.9999999 from being truncated to 99 where direct convolution gives 100 */
+#define FFT_ROUNDING_GUARD 1e-6
+
+typedef struct {
+    double re;
+    double im;
+} Complex;
+
+typedef struct {
+    int size;
+    int *bit_reversal;
+    Complex *twiddles;
+} FFTPlan;
+
+/* Plans are cached per power-of-two size for the lifetime of the process */
+static FFTPlan *fft_plans[MAX_FFT_LOG2_SIZE + 1];
+
+static int crossover_kernel_size = FFT_CONVOLUTION_CROSSOVER_KERNEL_SIZE;
+
+/* Tile side chosen by a tuning profile, 0 deriving it from the kernel size */
+static int tuned_tile_size = 0;
+
+static int next_power_of_two(int n) {
+    int power = 1;
+    while (power < n) {
+        power <<= 1;
+    }
+    return power;
+}
+
+static int log2_of_power_of_two(int n) {
+    int log2_n = 0;
+    while ((1 << log2_n) < n) {
+        log2_n++;
+    }
+    return log2_n;
+}
+
+/* Returns the cached plan for the given power-of-two size, building it on first use */
+static const FFTPlan *get_fft_plan(int size) {
+    int log2_size = log2_of_power_of_two(size);
+
+    if (fft_plans[log2_size]) {
+        return fft_plans[log2_size];
+    }
+
+    FFTPlan *plan = (FFTPlan *)malloc(sizeof(FFTPlan));
+    if (!plan) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    plan->size = size;
+    plan->bit_reversal = (int *)malloc(size * sizeof(int));
+    plan->twiddles = (Complex *)malloc((size / 2 + 1) * sizeof(Complex));
+    if (!plan->bit_reversal || !plan->twiddles) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int bit = 0; bit < log2_size; bit++) {
+            if (i & (1 << bit)) {
+                reversed |= 1 << (log2_size - 1 - bit);
+            }
+        }
+        plan->bit_reversal[i] = reversed;
+    }
+
+    for (int k = 0; k <= size / 2; k++) {
+        double angle = -2.0 * M_PI * (double)k / (double)size;
+        plan->twiddles[k].re = cos(angle);
+        plan->twiddles[k].im = sin(angle);
+    }
+
+    fft_plans[log2_size] = plan;
+
+    return plan;
+}
+
+void set_fft_convolution_parameters(
+    int new_crossover_kernel_size,  /* in */
+    int tile_size                   /* in */
+) {
+    crossover_kernel_size = (new_crossover_kernel_size > 0) ? new_crossover_kernel_size : FFT_CONVOLUTION_CROSSOVER_KERNEL_SIZE;
+    tuned_tile_size = (tile_size > 0) ? next_power_of_two(tile_size) : 0;
+}
+
+int fft_convolution_crossover_kernel_size(void) {
+    return crossover_kernel_size;
+}
+
+void free_fft_plans(void) {
+    for (int i = 0; i <= MAX_FFT_LOG2_SIZE; i++) {
+        if (fft_plans[i]) {
+            free(fft_plans[i]->bit_reversal);
+            free(fft_plans[i]->twiddles);
+            free(fft_plans[i]);
+            fft_plans[i] = NULL;
+        }
+    }
+}
+
+/* In-place iterative radix-2 FFT; the inverse transform is left unscaled */
+static void fft(const FFTPlan *plan, Complex *data, int inverse) {
+    int size = plan->size;
+
+    for (int i = 0; i < size; i++) {
+        int j = plan->bit_reversal[i];
+        if (i < j) {
+            Complex temporary = data[i];
+            data[i] = data[j];
+            data[j] = temporary;
+        }
+    }
+
+    for (int length = 2; length <= size; length <<= 1) {
+        int half = length / 2;
+        int step = size / length;
+        for (int start = 0; start < size; start += length) {
+            for (int k = 0; k < half; k++) {
+                Complex w = plan->twiddles[k * step];
+                if (inverse) {
+                    w.im = -w.im;
+                }
+                Complex *u = &data[start + k];
+                Complex *v = &data[start + k + half];
+                double t_re = v->re * w.re - v->im * w.im;
+                double t_im = v->re * w.im + v->im * w.re;
+                v->re = u->re - t_re;
+                v->im = u->im - t_im;
+                u->re += t_re;
+                u->im += t_im;
+            }
+        }
+    }
+}
+
+/* Transforms the first number_of_rows rows of a tile, each of them contiguous */
+static void fft_tile_rows(
+    const FFTPlan *row_plan,    /* in */
+    Complex *tile,              /* in / out */
+    int first_row,              /* in */
+    int number_of_rows,         /* in */
+    int inverse                 /* in */
+) {
+    for (int y = first_row; y < first_row + number_of_rows; y++) {
+        fft(row_plan, tile + y * row_plan->size, inverse);
+    }
+}
+
+/* Transforms every column of a tile, gathering blocks of columns into contiguous scratch space */
+static void fft_tile_columns(
+    const FFTPlan *column_plan, /* in */
+    Complex *tile,              /* in / out */
+    int tile_width,             /* in */
+    Complex *scratch,           /* in */
+    int inverse                 /* in */
+) {
+    int tile_height = column_plan->size;
+
+    for (int x0 = 0; x0 < tile_width; x0 += COLUMN_BLOCK_SIZE) {
+        for (int y = 0; y < tile_height; y++) {
+            for (int c = 0; c < COLUMN_BLOCK_SIZE; c++) {
+                scratch[c * tile_height + y] = tile[y * tile_width + x0 + c];
+            }
+        }
+
+        for (int c = 0; c < COLUMN_BLOCK_SIZE; c++) {
+            fft(column_plan, scratch + c * tile_height, inverse);
+        }
+
+        for (int y = 0; y < tile_height; y++) {
+            for (int c = 0; c < COLUMN_BLOCK_SIZE; c++) {
+                tile[y * tile_width + x0 + c] = scratch[c * tile_height + y];
+            }
+        }
+    }
+}
+
+/*
+ * Convolves either the RGB pixels of data_with_padding into new_data or, when it is NULL,
+ * the single plane of plane_with_padding into new_plane, which only needs one real tile
+ */
+static void overlap_save_convolution(
+    int number_of_threads,                      /* in */
+    const RGB *data_with_padding,               /* in */
+    const unsigned char *plane_with_padding,    /* in */
+    int height_with_padding,                    /* in */
+    int width_with_padding,                     /* in */
+    RGB *new_data,                              /* in / out */
+    unsigned char *new_plane,                   /* out */
+    int height,                                 /* in */
+    int width,                                  /* in */
+    const double *kernel,                       /* in */
+    int kernel_size,                            /* in */
+    const Epilogue *epilogue                    /* in */
+) {
+    /*
+     * Overlap-save: every tile of tile_height x tile_width input pixels yields
+     * (tile_height - halo) x (tile_width - halo) valid outputs, the first halo
+     * rows and columns of the circular result being discarded.
+     */
+    int halo = kernel_size - 1;
+
+    /* A tuned tile side is only used when it leaves at least as many valid outputs as halo pixels */
+    int tile_size = (tuned_tile_size >= 2 * halo) ? tuned_tile_size : next_power_of_two(4 * halo);
+    if (tile_size < MIN_FFT_TILE_SIZE) {
+        tile_size = MIN_FFT_TILE_SIZE;
+    }
+
+    int tile_height = tile_size;
+    if (tile_height > next_power_of_two(height_with_padding)) {
+        tile_height = next_power_of_two(height_with_padding);
+    }
+    int tile_width = tile_size;
+    if (tile_width > next_power_of_two(width_with_padding)) {
+        tile_width = next_power_of_two(width_with_padding);
+    }
+    if (tile_width < COLUMN_BLOCK_SIZE) {
+        tile_width = COLUMN_BLOCK_SIZE;
+    }
+
+    int valid_tile_height = tile_height - halo;
+    int valid_tile_width = tile_width - halo;
+
+    int number_of_row_bands = (height + valid_tile_height - 1) / valid_tile_height;
+    int number_of_column_tiles = (width + valid_tile_width - 1) / valid_tile_width;
+
+    const FFTPlan *row_plan = get_fft_plan(tile_width);
+    const FFTPlan *column_plan = get_fft_plan(tile_height);
+
+    int tile_area = tile_height * tile_width;
+
+    Complex *kernel_spectrum = (Complex *)calloc(tile_area, sizeof(Complex));
+    Complex *tiles = (Complex *)malloc(2 * number_of_threads * tile_area * sizeof(Complex));
+    Complex *scratch = (Complex *)malloc(number_of_threads * COLUMN_BLOCK_SIZE * tile_height * sizeof(Complex));
+    if (!kernel_spectrum || !tiles || !scratch) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* convolution() correlates, so the kernel is flipped before transforming it */
+    double scale = 1.0 / (double)tile_area;
+    for (int i = 0; i < kernel_size; i++) {
+        for (int j = 0; j < kernel_size; j++) {
+            kernel_spectrum[i * tile_width + j].re = kernel[(halo - i) * kernel_size + (halo - j)] * scale;
+        }
+    }
+    fft_tile_rows(row_plan, kernel_spectrum, 0, kernel_size, 0);
+    fft_tile_columns(column_plan, kernel_spectrum, tile_width, scratch, 0);
+
+    #pragma omp parallel num_threads(number_of_threads)
+    {
+        int thread_id = omp_get_thread_num();
+
+        /* Blue and green share one complex tile as real and imaginary parts, red uses the other */
+        Complex *blue_green_tile = tiles + (2 * thread_id) * tile_area;
+        Complex *red_tile = tiles + (2 * thread_id + 1) * tile_area;
+        Complex *thread_scratch = scratch + thread_id * COLUMN_BLOCK_SIZE * tile_height;
+
+        #pragma omp for collapse(2) schedule(static)
+        for (int band = 0; band < number_of_row_bands; band++) {
+            for (int column_tile = 0; column_tile < number_of_column_tiles; column_tile++) {
+                int y0 = band * valid_tile_height;
+                int x0 = column_tile * valid_tile_width;
+
+                int input_rows = height_with_padding - y0;
+                if (input_rows > tile_height) {
+                    input_rows = tile_height;
+                }
+                int input_columns = width_with_padding - x0;
+                if (input_columns > tile_width) {
+                    input_columns = tile_width;
+                }
+
+                memset(blue_green_tile, 0, tile_area * sizeof(Complex));
+
+                if (!data_with_padding) {
+                    for (int y = 0; y < input_rows; y++) {
+                        const unsigned char *input_row = plane_with_padding + (size_t)(y0 + y) * width_with_padding + x0;
+                        for (int x = 0; x < input_columns; x++) {
+                            blue_green_tile[y * tile_width + x].re = (double)input_row[x];
+                        }
+                    }
+
+                    fft_tile_rows(row_plan, blue_green_tile, 0, input_rows, 0);
+                    fft_tile_columns(column_plan, blue_green_tile, tile_width, thread_scratch, 0);
+
+                    /* The plane is real, so its one tile is multiplied like the blue and green one */
+                    for (int i = 0; i < tile_area; i++) {
+                        Complex k = kernel_spectrum[i];
+                        Complex value = blue_green_tile[i];
+                        blue_green_tile[i].re = value.re * k.re - value.im * k.im;
+                        blue_green_tile[i].im = value.re * k.im + value.im * k.re;
+                    }
+
+                    fft_tile_columns(column_plan, blue_green_tile, tile_width, thread_scratch, 1);
+                    fft_tile_rows(row_plan, blue_green_tile, halo, input_rows - halo, 1);
+
+                    for (int y = 0; y < input_rows - halo; y++) {
+                        for (int x = 0; x < input_columns - halo; x++) {
+                            new_plane[(size_t)(y0 + y) * width + (x0 + x)] = clamp_to_unsigned_char(blue_green_tile[(y + halo) * tile_width + (x + halo)].re + FFT_ROUNDING_GUARD);
+                        }
+                    }
+                    continue;
+                }
+
+                memset(red_tile, 0, tile_area * sizeof(Complex));
+
+                for (int y = 0; y < input_rows; y++) {
+                    const RGB *input_row = data_with_padding + (y0 + y) * width_with_padding + x0;
+                    for (int x = 0; x < input_columns; x++) {
+                        blue_green_tile[y * tile_width + x].re = (double)input_row[x].b;
+                        blue_green_tile[y * tile_width + x].im = (double)input_row[x].g;
+                        red_tile[y * tile_width + x].re = (double)input_row[x].r;
+                    }
+                }
+
+                fft_tile_rows(row_plan, blue_green_tile, 0, input_rows, 0);
+                fft_tile_rows(row_plan, red_tile, 0, input_rows, 0);
+                fft_tile_columns(column_plan, blue_green_tile, tile_width, thread_scratch, 0);
+                fft_tile_columns(column_plan, red_tile, tile_width, thread_scratch, 0);
+
+                for (int i = 0; i < tile_area; i++) {
+                    Complex k = kernel_spectrum[i];
+                    Complex bg = blue_green_tile[i];
+                    Complex r = red_tile[i];
+                    blue_green_tile[i].re = bg.re * k.re - bg.im * k.im;
+                    blue_green_tile[i].im = bg.re * k.im + bg.im * k.re;
+                    red_tile[i].re = r.re * k.re - r.im * k.im;
+                    red_tile[i].im = r.re * k.im + r.im * k.re;
+                }
+
+                fft_tile_columns(column_plan, blue_green_tile, tile_width, thread_scratch, 1);
+                fft_tile_columns(column_plan, red_tile, tile_width, thread_scratch, 1);
+
+                int output_rows = input_rows - halo;
+                int output_columns = input_columns - halo;
+
+                fft_tile_rows(row_plan, blue_green_tile, halo, output_rows, 1);
+                fft_tile_rows(row_plan, red_tile, halo, output_rows, 1);
+
+                for (int y = 0; y < output_rows; y++) {
+                    for (int x = 0; x < output_columns; x++) {
+                        store_pixel(
+                            &new_data[(y0 + y) * width + (x0 + x)],
+                            blue_green_tile[(y + halo) * tile_width + (x + halo)].re + FFT_ROUNDING_GUARD,
+                            blue_green_tile[(y + halo) * tile_width + (x + halo)].im + FFT_ROUNDING_GUARD,
+                            red_tile[(y + halo) * tile_width + (x + halo)].re + FFT_ROUNDING_GUARD,
+                            epilogue
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    free(kernel_spectrum);
+    free(tiles);
+    free(scratch);
+}
+
+void fft_convolution(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    const double *kernel,           /* in */
+    int kernel_size,                /* in */
+    int padding,                    /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    overlap_save_convolution(
+        number_of_threads,
+        data_with_padding,
+        NULL,
+        height_with_padding,
+        width_with_padding,
+        new_data,
+        NULL,
+        height,
+        width,
+        kernel,
+        kernel_size,
+        epilogue
+    );
+}
+
+void fft_plane_convolution(
+    int number_of_threads,                      /* in */
+    const unsigned char *plane_with_padding,    /* in */
+    int height_with_padding,                    /* in */
+    int width_with_padding,                     /* in */
+    unsigned char *new_plane,                   /* out */
+    int height,                                 /* in */
+    int width,                                  /* in */
+    const double *kernel,                       /* in */
+    int kernel_size                             /* in */
+) {
+    overlap_save_convolution(
+        number_of_threads,
+        NULL,
+        plane_with_padding,
+        height_with_padding,
+        width_with_padding,
+        NULL,
+        new_plane,
+        height,
+        width,
+        kernel,
+        kernel_size,
+        NULL
+    );
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef FFT_CONVOLUTION_H
+#define FFT_CONVOLUTION_H
+
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/*
+ * Smallest kernel size for which convolution() hands the work to the FFT engine.
+ * Measured with one thread on a 900x700 image and dense kernels: a 7x7 kernel
+ * is break-even, a 9x9 kernel is ~1.7x faster through the FFT and a 31x31
+ * kernel ~10x faster.
+ */
+#define FFT_CONVOLUTION_CROSSOVER_KERNEL_SIZE 9
+
+/* Convolves the padded data with the kernel using overlap-save over row bands of 2D FFTs */
+void fft_convolution(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    const double *kernel,
+    int kernel_size,
+    int padding,
+    const Epilogue *epilogue
+);
+
+/* Same as fft_convolution() for one plane of bytes, clamped like store_pixel() without an epilogue */
+void fft_plane_convolution(
+    int number_of_threads,
+    const unsigned char *plane_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    unsigned char *new_plane,
+    int height,
+    int width,
+    const double *kernel,
+    int kernel_size
+);
+
+/* Overrides the crossover kernel size and the tile side, 0 restoring the defaults; used by tuning profiles */
+void set_fft_convolution_parameters(
+    int crossover_kernel_size,
+    int tile_size
+);
+
+/* Smallest kernel size for which convolution() currently uses the FFT engine */
+int fft_convolution_crossover_kernel_size(void);
+
+/* Releases the cached FFT plans */
+void free_fft_plans(void);
+
+#endif
\ No newline at end of file
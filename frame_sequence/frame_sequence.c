@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mpi.h"
+#include "frame_sequence.h"
+#include "../bmp_io/bmp_io.h"
+#include "../buffer_pool/buffer_pool.h"
+
+#define DIMENSIONS_TAG 1
+#define STRIP_TAG 2
+#define RESULT_TAG 3
+
+/* Frames in flight per stage: the one being processed and the one whose sends are completing */
+#define FRAMES_IN_FLIGHT 2
+
+#define MAX_FRAME_FILE_NAME_LENGTH 1024
+
+typedef enum {
+    READER_STAGE,
+    COMPUTE_STAGE,
+    WRITER_STAGE
+} PipelineStage;
+
+int check_frame_pattern(
+    const char *pattern     /* in */
+) {
+    int conversions = 0;
+
+    for (const char *c = pattern; *c; c++) {
+        if (*c != '%') {
+            continue;
+        }
+        c++;
+        while (isdigit((unsigned char)*c)) {
+            c++;
+        }
+        if (*c != 'd') {
+            return 1;
+        }
+        conversions++;
+    }
+
+    return (conversions == 1) ? 0 : 1;
+}
+
+void frame_file_name(
+    const char *pattern,        /* in */
+    int frame,                  /* in */
+    char *file_name,            /* out */
+    size_t file_name_size       /* in */
+) {
+    snprintf(file_name, file_name_size, pattern, frame);
+}
+
+/* The compute processes are split into contiguous groups, group g starting at compute process first_member(g) */
+static int first_member(
+    int group,                      /* in */
+    int number_of_compute_processes,/* in */
+    int number_of_compute_groups    /* in */
+) {
+    return (group * number_of_compute_processes + number_of_compute_groups - 1) / number_of_compute_groups;
+}
+
+/* First row and row count of the strip of member rank of a group of group_size processes */
+static void strip_rows(
+    int height,         /* in */
+    int group_size,     /* in */
+    int member,         /* in */
+    int *first_row,     /* out */
+    int *local_height   /* out */
+) {
+    int height_per_process = height / group_size;
+    int rest = height % group_size;
+
+    *local_height = height_per_process + ((member < rest) ? 1 : 0);
+    *first_row = member * height_per_process + ((member < rest) ? member : rest);
+}
+
+/* Reads every frame and sends its dimensions to the writer and its strips to the group in charge of it */
+static double read_frames(
+    MPI_Comm pipeline,                  /* in */
+    const Operation *operation,         /* in */
+    const char *in_pattern,             /* in */
+    int first_frame,                    /* in */
+    int number_of_frames,               /* in */
+    int number_of_compute_processes,    /* in */
+    int number_of_compute_groups,       /* in */
+    int writer                          /* in */
+) {
+    double busy_time = 0.0;
+
+    Image *images[FRAMES_IN_FLIGHT] = { NULL };
+    int dimensions[FRAMES_IN_FLIGHT][2];
+    MPI_Request *requests[FRAMES_IN_FLIGHT];
+    int number_of_requests[FRAMES_IN_FLIGHT] = { 0 };
+
+    for (int slot = 0; slot < FRAMES_IN_FLIGHT; slot++) {
+        requests[slot] = (MPI_Request *)malloc((2 * number_of_compute_processes + 1) * sizeof(MPI_Request));
+        if (!requests[slot]) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < number_of_frames; i++) {
+        int slot = i % FRAMES_IN_FLIGHT;
+
+        MPI_Waitall(number_of_requests[slot], requests[slot], MPI_STATUSES_IGNORE);
+        if (images[slot]) {
+            free(images[slot]->data);
+            free(images[slot]);
+        }
+
+        double start = MPI_Wtime();
+
+        char file_name[MAX_FRAME_FILE_NAME_LENGTH];
+        frame_file_name(in_pattern, first_frame + i, file_name, sizeof(file_name));
+
+        Image *image = read_image_from_BMP_file(file_name);
+        if (!image) {
+            fprintf(stderr, "Error reading %s\n", file_name);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        images[slot] = image;
+
+        int group = i % number_of_compute_groups;
+        int first = first_member(group, number_of_compute_processes, number_of_compute_groups);
+        int group_size = first_member(group + 1, number_of_compute_processes, number_of_compute_groups) - first;
+
+        if (operation_padding(operation, image->height) > image->height / group_size) {
+            fprintf(stderr, "Error: The halo of the operation is deeper than the strips of %s, use fewer processes per group\n", file_name);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        dimensions[slot][0] = image->height;
+        dimensions[slot][1] = image->width;
+
+        number_of_requests[slot] = 0;
+        MPI_Isend(dimensions[slot], 2, MPI_INT, writer, DIMENSIONS_TAG, pipeline, &requests[slot][number_of_requests[slot]++]);
+
+        for (int member = 0; member < group_size; member++) {
+            int first_row;
+            int local_height;
+            strip_rows(image->height, group_size, member, &first_row, &local_height);
+
+            int destination = 1 + first + member;
+            MPI_Isend(dimensions[slot], 2, MPI_INT, destination, DIMENSIONS_TAG, pipeline, &requests[slot][number_of_requests[slot]++]);
+            MPI_Isend(
+                image->data + first_row * image->width,
+                local_height * image->width * 3,
+                MPI_UNSIGNED_CHAR,
+                destination,
+                STRIP_TAG,
+                pipeline,
+                &requests[slot][number_of_requests[slot]++]
+            );
+        }
+
+        busy_time += MPI_Wtime() - start;
+    }
+
+    for (int slot = 0; slot < FRAMES_IN_FLIGHT; slot++) {
+        MPI_Waitall(number_of_requests[slot], requests[slot], MPI_STATUSES_IGNORE);
+        if (images[slot]) {
+            free(images[slot]->data);
+            free(images[slot]);
+        }
+        free(requests[slot]);
+    }
+
+    return busy_time;
+}
+
+/* Applies the operation to the strips of the frames of one group, sending the results to the writer */
+static double compute_frames(
+    MPI_Comm pipeline,                  /* in */
+    MPI_Comm group_communicator,        /* in */
+    int number_of_threads,              /* in */
+    const Operation *operation,         /* in */
+    int number_of_frames,               /* in */
+    int group,                          /* in */
+    int number_of_compute_groups,       /* in */
+    int writer                          /* in */
+) {
+    double busy_time = 0.0;
+
+    int member;
+    int group_size;
+    MPI_Comm_rank(group_communicator, &member);
+    MPI_Comm_size(group_communicator, &group_size);
+
+    RGB *results[FRAMES_IN_FLIGHT] = { NULL };
+    MPI_Request requests[FRAMES_IN_FLIGHT] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+
+    for (int i = group, n = 0; i < number_of_frames; i += number_of_compute_groups, n++) {
+        int slot = n % FRAMES_IN_FLIGHT;
+
+        int dimensions[2];
+        MPI_Recv(dimensions, 2, MPI_INT, 0, DIMENSIONS_TAG, pipeline, MPI_STATUS_IGNORE);
+
+        int height = dimensions[0];
+        int width = dimensions[1];
+
+        int first_row;
+        int local_height;
+        strip_rows(height, group_size, member, &first_row, &local_height);
+
+        RGB *strip = (RGB *)acquire_image_buffer((local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+        MPI_Recv(strip, local_height * width * 3, MPI_UNSIGNED_CHAR, 0, STRIP_TAG, pipeline, MPI_STATUS_IGNORE);
+
+        /* The result of two frames ago is reused once the writer has received it */
+        MPI_Wait(&requests[slot], MPI_STATUS_IGNORE);
+        release_buffer(results[slot]);
+
+        double start = MPI_Wtime();
+
+        results[slot] = (RGB *)acquire_image_buffer((local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+
+        int padding = operation_padding(operation, height);
+
+        RGB *strip_with_padding;
+        int local_height_with_padding;
+        int width_with_padding;
+
+        add_padding_to_data(
+            number_of_threads,
+            strip,
+            local_height,
+            width,
+            padding,
+            &strip_with_padding,
+            &local_height_with_padding,
+            &width_with_padding
+        );
+        release_buffer(strip);
+
+        exchange_frontiers(
+            member,
+            group_size,
+            strip_with_padding,
+            local_height_with_padding,
+            width_with_padding,
+            padding,
+            group_communicator
+        );
+
+        if (operation_replicates_borders(operation)) {
+            replicate_border_padding(
+                member,
+                group_size,
+                strip_with_padding,
+                local_height_with_padding,
+                width_with_padding,
+                padding
+            );
+        }
+
+        apply_operation(
+            number_of_threads,
+            operation,
+            strip_with_padding,
+            local_height_with_padding,
+            width_with_padding,
+            results[slot],
+            local_height,
+            width,
+            padding,
+            first_row,
+            height,
+            group_communicator
+        );
+
+        release_buffer(strip_with_padding);
+
+        MPI_Isend(results[slot], local_height * width * 3, MPI_UNSIGNED_CHAR, writer, RESULT_TAG, pipeline, &requests[slot]);
+
+        busy_time += MPI_Wtime() - start;
+    }
+
+    MPI_Waitall(FRAMES_IN_FLIGHT, requests, MPI_STATUSES_IGNORE);
+    for (int slot = 0; slot < FRAMES_IN_FLIGHT; slot++) {
+        release_buffer(results[slot]);
+    }
+
+    return busy_time;
+}
+
+/* Gathers the strips of every frame and writes the frames in order */
+static double write_frames(
+    MPI_Comm pipeline,                  /* in */
+    const char *out_pattern,            /* in */
+    int first_frame,                    /* in */
+    int number_of_frames,               /* in */
+    int number_of_compute_processes,    /* in */
+    int number_of_compute_groups        /* in */
+) {
+    double busy_time = 0.0;
+
+    MPI_Request *requests = (MPI_Request *)malloc(number_of_compute_processes * sizeof(MPI_Request));
+    if (!requests) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < number_of_frames; i++) {
+        int dimensions[2];
+        MPI_Recv(dimensions, 2, MPI_INT, 0, DIMENSIONS_TAG, pipeline, MPI_STATUS_IGNORE);
+
+        Image image = { .width = dimensions[1], .height = dimensions[0] };
+        image.data = (RGB *)malloc(image.height * image.width * sizeof(RGB));
+        if (!image.data) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        int group = i % number_of_compute_groups;
+        int first = first_member(group, number_of_compute_processes, number_of_compute_groups);
+        int group_size = first_member(group + 1, number_of_compute_processes, number_of_compute_groups) - first;
+
+        for (int member = 0; member < group_size; member++) {
+            int first_row;
+            int local_height;
+            strip_rows(image.height, group_size, member, &first_row, &local_height);
+
+            MPI_Irecv(
+                image.data + first_row * image.width,
+                local_height * image.width * 3,
+                MPI_UNSIGNED_CHAR,
+                1 + first + member,
+                RESULT_TAG,
+                pipeline,
+                &requests[member]
+            );
+        }
+        MPI_Waitall(group_size, requests, MPI_STATUSES_IGNORE);
+
+        double start = MPI_Wtime();
+
+        char file_name[MAX_FRAME_FILE_NAME_LENGTH];
+        frame_file_name(out_pattern, first_frame + i, file_name, sizeof(file_name));
+
+        if (save_image_to_BMP_file(&image, file_name)) {
+            fprintf(stderr, "Error writing %s\n", file_name);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        free(image.data);
+
+        busy_time += MPI_Wtime() - start;
+    }
+
+    free(requests);
+
+    return busy_time;
+}
+
+void process_frame_sequence(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    const char *in_pattern,         /* in */
+    const char *out_pattern,        /* in */
+    int first_frame,                /* in */
+    int number_of_frames,           /* in */
+    int number_of_compute_groups    /* in */
+) {
+    int number_of_compute_processes = number_of_processes - 2;
+    int writer = number_of_processes - 1;
+
+    PipelineStage stage = COMPUTE_STAGE;
+    int group = 0;
+    if (process_rank == 0) {
+        stage = READER_STAGE;
+    } else if (process_rank == writer) {
+        stage = WRITER_STAGE;
+    } else {
+        group = (process_rank - 1) * number_of_compute_groups / number_of_compute_processes;
+    }
+
+    /* Strips travel between stages on their own communicator, halos within each compute group */
+    MPI_Comm pipeline;
+    MPI_Comm_dup(MPI_COMM_WORLD, &pipeline);
+
+    MPI_Comm stage_communicator;
+    MPI_Comm_split(
+        MPI_COMM_WORLD,
+        (stage == COMPUTE_STAGE) ? group : number_of_compute_groups + (int)stage,
+        process_rank,
+        &stage_communicator
+    );
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+
+    double busy_time;
+    switch (stage) {
+        case READER_STAGE:
+            busy_time = read_frames(pipeline, operation, in_pattern, first_frame, number_of_frames, number_of_compute_processes, number_of_compute_groups, writer);
+            break;
+        case WRITER_STAGE:
+            busy_time = write_frames(pipeline, out_pattern, first_frame, number_of_frames, number_of_compute_processes, number_of_compute_groups);
+            break;
+        case COMPUTE_STAGE:
+        default:
+            busy_time = compute_frames(pipeline, stage_communicator, number_of_threads, operation, number_of_frames, group, number_of_compute_groups, writer);
+            break;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double elapsed = MPI_Wtime() - start;
+
+    double *busy_times = NULL;
+    if (process_rank == 0) {
+        busy_times = (double *)malloc(number_of_processes * sizeof(double));
+        if (!busy_times) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+
+    MPI_Gather(&busy_time, 1, MPI_DOUBLE, busy_times, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (process_rank == 0) {
+        double compute_busy_time = 0.0;
+        for (int i = 1; i < writer; i++) {
+            compute_busy_time += busy_times[i];
+        }
+
+        fprintf(stdout, "\n%d frames in %f seconds, %.2f frames per second\n", number_of_frames, elapsed, number_of_frames / elapsed);
+        fprintf(stdout, "Read stage utilization: %5.1f%% (1 process)\n", 100.0 * busy_times[0] / elapsed);
+        fprintf(stdout, "Compute stage utilization: %5.1f%% (%d processes in %d groups)\n",
+            100.0 * compute_busy_time / (number_of_compute_processes * elapsed),
+            number_of_compute_processes,
+            number_of_compute_groups
+        );
+        fprintf(stdout, "Write stage utilization: %5.1f%% (1 process)\n", 100.0 * busy_times[writer] / elapsed);
+        fflush(stdout);
+
+        free(busy_times);
+    }
+
+    MPI_Comm_free(&stage_communicator);
+    MPI_Comm_free(&pipeline);
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef FRAME_SEQUENCE_H
+#define FRAME_SEQUENCE_H
+
+#include <stddef.h>
+#include "../operations/operations.h"
+
+/* Returns 0 when the pattern holds exactly one %d conversion, possibly with a width such as %04d */
+int check_frame_pattern(
+    const char *pattern
+);
+
+/* Expands a frame pattern accepted by check_frame_pattern(), e.g. frame_%04d.bmp */
+void frame_file_name(
+    const char *pattern,
+    int frame,
+    char *file_name,
+    size_t file_name_size
+);
+
+/*
+ * Applies the operation to a numbered sequence of BMP frames with the processes
+ * arranged in a pipeline: process 0 reads frame N+1 while the compute groups
+ * convolve frame N and the last process writes frame N-1. Consecutive frames go
+ * to the compute groups in turn, each group splitting its frame into strips.
+ * Stages exchange frames and strips with non-blocking sends, and a frame is
+ * only freed once its sends have completed. Needs at least 3 processes and an
+ * operation with a single output of the input size. Prints the sustained frames
+ * per second and the share of the time every stage spent working.
+ */
+void process_frame_sequence(
+    int process_rank,
+    int number_of_processes,
+    int number_of_threads,
+    const Operation *operation,
+    const char *in_pattern,
+    const char *out_pattern,
+    int first_frame,
+    int number_of_frames,
+    int number_of_compute_groups
+);
+
+#endif
\ No newline at end of file
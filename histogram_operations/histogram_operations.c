@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "histogram_operations.h"
+
+/* Maps every channel of the strip through its lookup table, running the epilogue on the result */
+static void apply_lookup_tables(
+    int number_of_threads,                      /* in */
+    const RGB *data,                            /* in */
+    RGB *new_data,                              /* out */
+    int height,                                 /* in */
+    int width,                                  /* in */
+    const unsigned char lookup_tables[3][256],  /* in */
+    const Epilogue *epilogue                    /* in */
+) {
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int i = 0; i < height * width; i++) {
+        new_data[i].r = lookup_tables[0][data[i].r];
+        new_data[i].g = lookup_tables[1][data[i].g];
+        new_data[i].b = lookup_tables[2][data[i].b];
+        if (epilogue && epilogue->number_of_stages > 0) {
+            apply_epilogue(epilogue, &new_data[i]);
+        }
+    }
+}
+
+void histogram_equalization(
+    int number_of_threads,      /* in */
+    MPI_Comm communicator,      /* in */
+    const RGB *data,            /* in */
+    RGB *new_data,              /* out */
+    int height,                 /* in */
+    int width,                  /* in */
+    const Epilogue *epilogue    /* in */
+) {
+    long long histogram[256] = { 0 };
+
+    #pragma omp parallel for num_threads(number_of_threads) reduction(+:histogram[:256]) schedule(static)
+    for (int i = 0; i < height * width; i++) {
+        histogram[data[i].r]++;
+        histogram[data[i].g]++;
+        histogram[data[i].b]++;
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, histogram, 256, MPI_LONG_LONG, MPI_SUM, communicator);
+
+    long long cumulative = 0;
+    long long first_nonzero_cumulative = -1;
+    long long total = 0;
+    for (int value = 0; value < 256; value++) {
+        total += histogram[value];
+    }
+
+    unsigned char lookup_tables[3][256];
+    for (int value = 0; value < 256; value++) {
+        cumulative += histogram[value];
+        if (first_nonzero_cumulative < 0 && cumulative > 0) {
+            first_nonzero_cumulative = cumulative;
+        }
+        unsigned char equalized = (unsigned char)value;
+        if (total > first_nonzero_cumulative && first_nonzero_cumulative >= 0) {
+            equalized = (unsigned char)llround((double)(cumulative - first_nonzero_cumulative) * 255.0 / (double)(total - first_nonzero_cumulative));
+        }
+        lookup_tables[0][value] = equalized;
+        lookup_tables[1][value] = equalized;
+        lookup_tables[2][value] = equalized;
+    }
+
+    apply_lookup_tables(number_of_threads, data, new_data, height, width, (const unsigned char (*)[256])lookup_tables, epilogue);
+}
+
+void auto_levels(
+    int number_of_threads,      /* in */
+    MPI_Comm communicator,      /* in */
+    const RGB *data,            /* in */
+    RGB *new_data,              /* out */
+    int height,                 /* in */
+    int width,                  /* in */
+    double clip_percent,        /* in */
+    const Epilogue *epilogue    /* in */
+) {
+    /* One histogram per channel, in RGB memory order */
+    long long histograms[3 * 256] = { 0 };
+
+    #pragma omp parallel for num_threads(number_of_threads) reduction(+:histograms[:3 * 256]) schedule(static)
+    for (int i = 0; i < height * width; i++) {
+        histograms[data[i].r]++;
+        histograms[256 + data[i].g]++;
+        histograms[512 + data[i].b]++;
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, histograms, 3 * 256, MPI_LONG_LONG, MPI_SUM, communicator);
+
+    unsigned char lookup_tables[3][256];
+
+    for (int channel = 0; channel < 3; channel++) {
+        const long long *histogram = histograms + channel * 256;
+
+        long long total = 0;
+        for (int value = 0; value < 256; value++) {
+            total += histogram[value];
+        }
+        double clipped = clip_percent / 100.0 * (double)total;
+
+        int low = 0;
+        long long cumulative = histogram[0];
+        while (low < 255 && (double)cumulative <= clipped) {
+            low++;
+            cumulative += histogram[low];
+        }
+
+        int high = 255;
+        cumulative = histogram[255];
+        while (high > 0 && (double)cumulative <= clipped) {
+            high--;
+            cumulative += histogram[high];
+        }
+
+        for (int value = 0; value < 256; value++) {
+            if (high > low) {
+                lookup_tables[channel][value] = clamp_to_unsigned_char((double)(value - low) * 255.0 / (double)(high - low) + 0.5);
+            } else {
+                lookup_tables[channel][value] = (unsigned char)value;
+            }
+        }
+    }
+
+    apply_lookup_tables(number_of_threads, data, new_data, height, width, (const unsigned char (*)[256])lookup_tables, epilogue);
+}
+
+void contrast_limited_adaptive_histogram_equalization(
+    int number_of_threads,      /* in */
+    MPI_Comm communicator,      /* in */
+    const RGB *data,            /* in */
+    RGB *new_data,              /* out */
+    int height,                 /* in */
+    int width,                  /* in */
+    int first_row,              /* in */
+    int image_height,           /* in */
+    int tiles,                  /* in */
+    double clip_limit,          /* in */
+    const Epilogue *epilogue    /* in */
+) {
+    /* The grid covers the whole image, so a tile usually spans several strips */
+    int tile_height = (image_height + tiles - 1) / tiles;
+    int tile_width = (width + tiles - 1) / tiles;
+    int tile_rows = (image_height + tile_height - 1) / tile_height;
+    int tile_columns = (width + tile_width - 1) / tile_width;
+    int number_of_bins = tile_rows * tile_columns * 256;
+
+    /* One set of tile histograms per thread, on the heap since it grows with the square of tiles */
+    long long *thread_histograms = (long long *)calloc((size_t)number_of_threads * number_of_bins, sizeof(long long));
+    long long *histograms = (long long *)malloc(number_of_bins * sizeof(long long));
+    unsigned char *lookup_tables = (unsigned char *)malloc(number_of_bins * sizeof(unsigned char));
+    if (!thread_histograms || !histograms || !lookup_tables) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    #pragma omp parallel num_threads(number_of_threads)
+    {
+        long long *own_histograms = thread_histograms + (size_t)omp_get_thread_num() * number_of_bins;
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            long long *tile_row_histograms = own_histograms + ((first_row + y) / tile_height) * tile_columns * 256;
+            for (int x = 0; x < width; x++) {
+                long long *histogram = tile_row_histograms + (x / tile_width) * 256;
+                RGB pixel = data[y * width + x];
+                histogram[pixel.r]++;
+                histogram[pixel.g]++;
+                histogram[pixel.b]++;
+            }
+        }
+
+        #pragma omp for schedule(static)
+        for (int bin = 0; bin < number_of_bins; bin++) {
+            long long sum = 0;
+            for (int thread = 0; thread < number_of_threads; thread++) {
+                sum += thread_histograms[(size_t)thread * number_of_bins + bin];
+            }
+            histograms[bin] = sum;
+        }
+    }
+
+    free(thread_histograms);
+
+    /* Sharing the tile histograms stitches together the tiles cut by strip boundaries */
+    MPI_Allreduce(MPI_IN_PLACE, histograms, number_of_bins, MPI_LONG_LONG, MPI_SUM, communicator);
+
+    for (int tile = 0; tile < tile_rows * tile_columns; tile++) {
+        long long *histogram = histograms + tile * 256;
+        unsigned char *lookup_table = lookup_tables + tile * 256;
+
+        long long total = 0;
+        for (int value = 0; value < 256; value++) {
+            total += histogram[value];
+        }
+        if (total == 0) {
+            for (int value = 0; value < 256; value++) {
+                lookup_table[value] = (unsigned char)value;
+            }
+            continue;
+        }
+
+        long long limit = (long long)(clip_limit * (double)total / 256.0);
+        if (limit < 1) {
+            limit = 1;
+        }
+
+        long long excess = 0;
+        for (int value = 0; value < 256; value++) {
+            if (histogram[value] > limit) {
+                excess += histogram[value] - limit;
+                histogram[value] = limit;
+            }
+        }
+        for (int value = 0; value < 256; value++) {
+            histogram[value] += excess / 256 + ((value < excess % 256) ? 1 : 0);
+        }
+
+        long long cumulative = 0;
+        for (int value = 0; value < 256; value++) {
+            cumulative += histogram[value];
+            lookup_table[value] = (unsigned char)llround((double)cumulative * 255.0 / (double)total);
+        }
+    }
+
+    /* Every pixel blends the lookup tables of the four tiles whose centres surround it */
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < height; y++) {
+        double tile_y = ((double)(first_row + y) + 0.5) / (double)tile_height - 0.5;
+        int top = (int)floor(tile_y);
+        double weight_y = tile_y - (double)top;
+        int bottom = top + 1;
+        if (top < 0) {
+            top = 0;
+            weight_y = 0.0;
+        }
+        if (bottom > tile_rows - 1) {
+            bottom = tile_rows - 1;
+        }
+        if (top > tile_rows - 1) {
+            top = tile_rows - 1;
+        }
+
+        for (int x = 0; x < width; x++) {
+            double tile_x = ((double)x + 0.5) / (double)tile_width - 0.5;
+            int left = (int)floor(tile_x);
+            double weight_x = tile_x - (double)left;
+            int right = left + 1;
+            if (left < 0) {
+                left = 0;
+                weight_x = 0.0;
+            }
+            if (right > tile_columns - 1) {
+                right = tile_columns - 1;
+            }
+            if (left > tile_columns - 1) {
+                left = tile_columns - 1;
+            }
+
+            const unsigned char *top_left = lookup_tables + (top * tile_columns + left) * 256;
+            const unsigned char *top_right = lookup_tables + (top * tile_columns + right) * 256;
+            const unsigned char *bottom_left = lookup_tables + (bottom * tile_columns + left) * 256;
+            const unsigned char *bottom_right = lookup_tables + (bottom * tile_columns + right) * 256;
+
+            const unsigned char *pixel = (const unsigned char *)&data[y * width + x];
+            unsigned char *new_pixel = (unsigned char *)&new_data[y * width + x];
+            for (int channel = 0; channel < 3; channel++) {
+                int value = pixel[channel];
+                double blended = (1.0 - weight_y) * ((1.0 - weight_x) * top_left[value] + weight_x * top_right[value])
+                    + weight_y * ((1.0 - weight_x) * bottom_left[value] + weight_x * bottom_right[value]);
+                new_pixel[channel] = clamp_to_unsigned_char(blended + 0.5);
+            }
+
+            if (epilogue && epilogue->number_of_stages > 0) {
+                apply_epilogue(epilogue, &new_data[y * width + x]);
+            }
+        }
+    }
+
+    free(histograms);
+    free(lookup_tables);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef HISTOGRAM_OPERATIONS_H
+#define HISTOGRAM_OPERATIONS_H
+
+#include "mpi.h"
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/*
+ * Contrast operations driven by histograms of the whole image: every rank counts
+ * its strip with per-thread histograms, the counts are summed over the communicator
+ * and every rank maps its own strip through the resulting lookup tables.
+ */
+
+/* Equalizes the intensity histogram of all three channels with a single lookup table */
+void histogram_equalization(
+    int number_of_threads,
+    MPI_Comm communicator,
+    const RGB *data,
+    RGB *new_data,
+    int height,
+    int width,
+    const Epilogue *epilogue
+);
+
+/* Stretches every channel so that clip_percent of its values saturate at each end */
+void auto_levels(
+    int number_of_threads,
+    MPI_Comm communicator,
+    const RGB *data,
+    RGB *new_data,
+    int height,
+    int width,
+    double clip_percent,
+    const Epilogue *epilogue
+);
+
+/* Most CLAHE tiles per image side; every thread keeps tiles * tiles histograms */
+#define MAX_CLAHE_TILES 64
+
+/*
+ * Contrast limited adaptive histogram equalization over a grid of tiles x tiles
+ * regions of the whole image, the strip starting at row first_row; clip_limit is
+ * a multiple of the mean bin count of a tile histogram.
+ */
+void contrast_limited_adaptive_histogram_equalization(
+    int number_of_threads,
+    MPI_Comm communicator,
+    const RGB *data,
+    RGB *new_data,
+    int height,
+    int width,
+    int first_row,
+    int image_height,
+    int tiles,
+    double clip_limit,
+    const Epilogue *epilogue
+);
+
+#endif
\ No newline at end of file
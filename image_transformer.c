@@ -1,76 +1,330 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <omp.h>
 #include "mpi.h"
 #include "bmp_io/bmp_io.h"
 #include "shared_file_system_bmp_io/shared_file_system_bmp_io.h"
-#include "kernels.h"
+#include "tiled_image_io/tiled_image_io.h"
 #include "operations/operations.h"
+#include "fft_convolution/fft_convolution.h"
+#include "luma/luma.h"
+#include "buffer_pool/buffer_pool.h"
+#include "job_server/job_server.h"
+#include "autotune/autotune.h"
+#include "frame_sequence/frame_sequence.h"
+#include "tile_cache/tile_cache.h"
+#include "region_of_interest/region_of_interest.h"
+#include "line_buffer_convolution/line_buffer_convolution.h"
+#include "work_stealing/work_stealing.h"
+#include "preview/preview.h"
 
 #define SHARED_FILE_SYSTEM
 
-int main(int argc, char *argv[]) {
-    int provided;
-    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+/* Reads a whole image serially, in the format its file name selects */
+static Image *read_image_from_file(const char *file_name) {
+    if (is_tiled_image_file_name(file_name)) {
+        return read_image_from_tiled_image_file(file_name);
+    }
+    return read_image_from_BMP_file(file_name);
+}
+
+#ifndef SHARED_FILE_SYSTEM
+/* Saves a whole image serially, in the format its file name selects */
+static int save_image_to_file(const Image *image, const char *file_name) {
+    if (is_tiled_image_file_name(file_name)) {
+        return save_image_to_tiled_image_file(image, file_name);
+    }
+    return save_image_to_BMP_file(image, file_name);
+}
+#endif
 
-    int process_rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+#ifdef SHARED_FILE_SYSTEM
+/*
+ * Writes one output strip of the operation in the format the file name selects; in
+ * luma modes the strip holds gray pixels, stored as luma first and then written as
+ * an 8-bit grayscale BMP or, recombined with the chroma planes, like any other output
+ */
+static void write_output_strip(
+    int process_rank,                   /* in */
+    int number_of_processes,            /* in */
+    int number_of_threads,              /* in */
+    const Operation *operation,         /* in */
+    const char *file_name,              /* in */
+    int height,                         /* in */
+    int width,                          /* in */
+    RGB *new_local_data,                /* in / out */
+    int local_height,                   /* in */
+    int first_row,                      /* in */
+    const BMPLayout *layout,            /* in */
+    const unsigned char *chroma_blue,   /* in */
+    const unsigned char *chroma_red     /* in */
+) {
+    unsigned char *new_local_luma = NULL;
+
+    if (operation->luma_mode == GRAYSCALE_LUMA_MODE) {
+        new_local_luma = (unsigned char *)acquire_buffer((local_height * width + 1) * sizeof(unsigned char));
+    }
+    if (operation->luma_mode != NO_LUMA_MODE) {
+        store_luma_result(number_of_threads, new_local_data, local_height * width, chroma_blue, chroma_red, new_local_luma, &operation->epilogue);
+    }
 
-    int number_of_processes;
-    MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+    MPI_File file_handle;
 
-    if (argc != 5) {
-        if (process_rank == 0) {
-            fprintf(stdout, "Usage: %s <number of threads> <operation> <input file> <output file>\n", argv[0]);
-            fflush(stderr);
-        }
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    MPI_File_open(
+        MPI_COMM_WORLD,                         /* the communicator */
+        file_name,                              /* the name of the file to open */
+        MPI_MODE_WRONLY | MPI_MODE_CREATE,      /* the file access mode */
+        MPI_INFO_NULL,                          /* the info object */
+        &file_handle                            /* the file handle */
+    );
+
+    if (new_local_luma) {
+        write_luma_strip_to_BMP_file(process_rank, number_of_processes, &file_handle, height, width, new_local_luma, local_height, first_row);
+    } else if (is_tiled_image_file_name(file_name)) {
+        write_strip_to_tiled_image_file(process_rank, number_of_processes, number_of_threads, &file_handle, height, width, new_local_data, local_height, first_row);
+    } else {
+        write_strip_to_BMP_file(process_rank, number_of_processes, &file_handle, height, width, new_local_data, local_height, first_row, layout);
     }
 
-    int number_of_threads = strtol(argv[1], NULL, 10);
+    MPI_File_close(&file_handle);
 
-    if (number_of_threads < 1) {
+    release_buffer(new_local_luma);
+}
+#endif
+
+/* Negative results of transform_image(), rank 0 having printed the reason */
+#define UNSUPPORTED_OPERATION_RESULT -1.0
+#define INVALID_INPUT_RESULT -2.0
+#define HALO_TOO_DEEP_RESULT -3.0
+
+/* Returns 1, rank 0 printing why, when several processes split the image in strips shallower than the halo */
+static int halo_deeper_than_strips(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int padding,                /* in */
+    int height,                 /* in */
+    int height_per_process      /* in */
+) {
+    /* A single process exchanges no halo, so only several processes need strips as deep as it */
+    if (number_of_processes > 1 && padding > height_per_process) {
         if (process_rank == 0) {
-            fprintf(stdout, "Error: The number of threads must be at least 1\n");
-            fflush(stderr);
+            fprintf(stdout, "Error: The %d rows halo is deeper than the %d rows strips, use at most %d processes\n", padding, height_per_process, (height / padding > 1) ? height / padding : 1);
+            fflush(stdout);
         }
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        return 1;
     }
+    return 0;
+}
 
-    const char *operation = argv[2];
-    const char *in_file_name = argv[3];
-    const char *out_file_name = argv[4];
+#ifdef SHARED_FILE_SYSTEM
+/* Bytes of BMP rows the luma plane path decodes or encodes at a time */
+#define LUMA_STAGING_SIZE (1 << 20)
+
+/*
+ * Runs a convolution in a luma mode on one plane of bytes: the luma is decoded from the
+ * BMP rows straight into the padded plane, its 1-byte halos are exchanged, and the new
+ * plane is written as an 8-bit BMP or recombined with the chroma planes chunk by chunk,
+ * so that no RGB strip is ever held. Returns the parallel elapsed time on rank 0, or
+ * HALO_TOO_DEEP_RESULT like transform_image().
+ */
+static double transform_luma_plane(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    MPI_File *in_file_handle,       /* in */
+    const char *out_file_name,      /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    int height_per_process,         /* in */
+    int local_height,               /* in */
+    int first_row,                  /* in */
+    const BMPLayout *layout         /* in */
+) {
+    double parallel_version_start_time = 0.0;
+    double parallel_version_end_time = 0.0;
+    double parallel_version_elapsed_time = 0.0;
+
+    int padding = operation_padding(operation, height);
+
+    if (halo_deeper_than_strips(process_rank, number_of_processes, padding, height, height_per_process)) {
+        return HALO_TOO_DEEP_RESULT;
+    }
+
+    int local_height_with_padding = local_height + 2 * padding;
+    int width_with_padding = width + 2 * padding;
+    int number_of_pixels = local_height * width;
+
+    int chunk_rows = LUMA_STAGING_SIZE / (width * 4 + 3);
+    if (chunk_rows < 1) {
+        chunk_rows = 1;
+    }
+
+    unsigned char *luma_with_padding = (unsigned char *)acquire_image_buffer((size_t)local_height_with_padding * width_with_padding + 1, width_with_padding, number_of_threads);
+    unsigned char *new_local_luma = (unsigned char *)acquire_image_buffer((size_t)number_of_pixels + 1, width, number_of_threads);
+    unsigned char *chroma_blue = NULL;
+    unsigned char *chroma_red = NULL;
+
+    if (operation->luma_mode == CHROMA_LUMA_MODE) {
+        chroma_blue = (unsigned char *)acquire_image_buffer((size_t)number_of_pixels + 1, width, number_of_threads);
+        chroma_red = (unsigned char *)acquire_image_buffer((size_t)number_of_pixels + 1, width, number_of_threads);
+    }
+
+    /* Pooled buffers come back dirty, so the zero padding frame is written explicitly */
+    memset(luma_with_padding, 0, (size_t)padding * width_with_padding);
+    memset(luma_with_padding + (size_t)(local_height + padding) * width_with_padding, 0, (size_t)padding * width_with_padding);
+    for (int y = padding; y < local_height + padding; y++) {
+        memset(luma_with_padding + (size_t)y * width_with_padding, 0, padding);
+        memset(luma_with_padding + (size_t)y * width_with_padding + padding + width, 0, padding);
+    }
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\nStarted parallel work ...\n");
+        fflush(stdout);
+        parallel_version_start_time = MPI_Wtime();
+    }
+
+    read_luma_strip_from_BMP_file(
+        process_rank,
+        number_of_processes,
+        in_file_handle,
+        height,
+        width,
+        luma_with_padding + (size_t)padding * width_with_padding + padding,
+        width_with_padding,
+        chroma_blue,
+        chroma_red,
+        local_height,
+        first_row,
+        chunk_rows
+    );
+
+    exchange_luma_frontiers(
+        process_rank,
+        number_of_processes,
+        luma_with_padding,
+        local_height_with_padding,
+        width_with_padding,
+        padding,
+        MPI_COMM_WORLD
+    );
+
+    luma_convolution(
+        number_of_threads,
+        luma_with_padding,
+        local_height_with_padding,
+        width_with_padding,
+        new_local_luma,
+        local_height,
+        width,
+        operation->kernel,
+        operation->kernel_size,
+        padding
+    );
+
+    release_buffer(luma_with_padding);
+
+    if (process_rank == 0) {
+        parallel_version_end_time = MPI_Wtime();
+        fprintf(stdout, "\nEnded parallel work ...\n");
+        fflush(stdout);
+    }
+
+    MPI_File out_file_handle;
+
+    MPI_File_open(
+        MPI_COMM_WORLD,                         /* the communicator */
+        out_file_name,                          /* the name of the file to open */
+        MPI_MODE_WRONLY | MPI_MODE_CREATE,      /* the file access mode */
+        MPI_INFO_NULL,                          /* the info object */
+        &out_file_handle                        /* the file handle */
+    );
 
-    const double *kernel = NULL;
-    int kernel_size;
-
-    if (strcmp(operation, "RIDGE") == 0) {
-        kernel = RIDGE_KERNEL;
-        kernel_size = 3;
-    } else if (strcmp(operation, "EDGE") == 0) {
-        kernel = EDGE_KERNEL;
-        kernel_size = 3;
-    } else if (strcmp(operation, "SHARPEN") == 0) {
-        kernel = SHARPEN_KERNEL;
-        kernel_size = 3;
-    } else if (strcmp(operation, "BOXBLUR") == 0) {
-        kernel = BOX_BLUR_KERNEL;
-        kernel_size = 3;
-    } else if (strcmp(operation, "GAUSSIANBLUR3") == 0) {
-        kernel = GAUSSIAN_BLUR_3x3_KERNEL;
-        kernel_size = 3;
-    } else if (strcmp(operation, "GAUSSIANBLUR5") == 0) {
-        kernel = GAUSSIAN_BLUR_5x5_KERNEL;
-        kernel_size = 5;
-    } else if (strcmp(operation, "UNSHARP5") == 0) {
-        kernel = UNSHARP_MASKING_5x5_KERNEL;
-        kernel_size = 5;
+    if (operation->luma_mode == GRAYSCALE_LUMA_MODE) {
+        apply_epilogue_to_luma(number_of_threads, new_local_luma, number_of_pixels, &operation->epilogue);
+        write_luma_strip_to_BMP_file(process_rank, number_of_processes, &out_file_handle, height, width, new_local_luma, local_height, first_row);
     } else {
+        write_luma_and_chroma_strip_to_BMP_file(
+            process_rank,
+            number_of_processes,
+            &out_file_handle,
+            height,
+            width,
+            new_local_luma,
+            chroma_blue,
+            chroma_red,
+            &operation->epilogue,
+            local_height,
+            first_row,
+            chunk_rows,
+            layout
+        );
+    }
+
+    MPI_File_close(&out_file_handle);
+
+    release_buffer(new_local_luma);
+    release_buffer(chroma_blue);
+    release_buffer(chroma_red);
+
+    if (process_rank == 0) {
+        printf("\nModified image saved in file %s\n", out_file_name);
+        parallel_version_elapsed_time = parallel_version_end_time - parallel_version_start_time;
+        fprintf(stdout, "\nParallel version elapsed time: %f seconds\n", parallel_version_elapsed_time);
+        fflush(stdout);
+    }
+
+    return parallel_version_elapsed_time;
+}
+#endif
+
+/*
+ * Runs the operation on the strips of all ranks, from reading in_file_name to writing
+ * out_file_name; returns the parallel elapsed time on rank 0, or one of the negative
+ * results above when the operation, the input or the split among the ranks is not one
+ * it can run, on every rank
+ */
+static double transform_image(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    const char *in_file_name,       /* in */
+    const char *out_file_name       /* in */
+) {
+#ifndef SHARED_FILE_SYSTEM
+    if (operation_resamples(operation) || operation_number_of_outputs(operation) > 1 || operation->luma_mode != NO_LUMA_MODE) {
         if (process_rank == 0) {
-            fprintf(stdout, "Unknown operation!\n");
+            fprintf(stdout, "Error: RESIZE, PYRAMID, fused passes and luma modes need the shared file system build\n");
             fflush(stdout);
         }
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        return UNSUPPORTED_OPERATION_RESULT;
+    }
+#endif
+
+    if (operation->luma_mode == GRAYSCALE_LUMA_MODE && is_tiled_image_file_name(out_file_name)) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: GRAY: writes 8-bit BMP files only\n");
+            fflush(stdout);
+        }
+        return UNSUPPORTED_OPERATION_RESULT;
+    }
+
+    /*
+     * Luma modes run the operation on gray pixels, their point operations waiting for the luma
+     * to be stored, unless it is a convolution that transform_luma_plane() runs on the luma alone
+     */
+    const Operation *requested_operation = operation;
+    Operation gray_operation;
+    if (operation->luma_mode != NO_LUMA_MODE) {
+        gray_operation = *operation;
+        gray_operation.epilogue.number_of_stages = 0;
+        operation = &gray_operation;
     }
 
     double parallel_version_start_time = 0.0;
@@ -86,7 +340,7 @@ int main(int argc, char *argv[]) {
 
     MPI_File in_file_handle;
 
-    MPI_File_open(
+    int open_error = MPI_File_open(
         MPI_COMM_WORLD,     /* the communicator */
         in_file_name,       /* the name of the file to open */
         MPI_MODE_RDONLY,    /* the file access mode */
@@ -94,21 +348,68 @@ int main(int argc, char *argv[]) {
         &in_file_handle     /* the file handle */
     );
 
-    int height;
-    int width;
+    int tiled_input = is_tiled_image_file_name(in_file_name);
 
-    read_image_height_and_width_from_BMP_file(
-        process_rank,
-        number_of_processes,
-        &in_file_handle,
-        &height,
-        &width
-    );
+    /* BMP outputs keep the pixel size and row order of BMP inputs */
+    BMPLayout layout = { 54, 3, 0 };
+
+    /* Rank 0 checks the header for everyone, a bad input failing the run instead of aborting it */
+    int header_fields[3] = { 1, 0, 0 };
+    if (process_rank == 0 && open_error == MPI_SUCCESS) {
+        if (tiled_input) {
+            header_fields[0] = read_header_from_tiled_image_file(&in_file_handle, &header_fields[1], &header_fields[2]);
+        } else {
+            header_fields[0] = read_BMP_header_from_BMP_file(&in_file_handle, &header_fields[1], &header_fields[2], &layout);
+        }
+    }
+
+    MPI_Bcast(header_fields, 3, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (header_fields[0]) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: %s is not a 24-bit or 32-bit BMP file or a tiled image file\n", in_file_name);
+            fflush(stdout);
+        }
+        if (open_error == MPI_SUCCESS) {
+            MPI_File_close(&in_file_handle);
+        }
+        return INVALID_INPUT_RESULT;
+    }
+
+    int height = header_fields[1];
+    int width = header_fields[2];
+
+    if (!tiled_input) {
+        read_BMP_layout_from_BMP_file(&in_file_handle, &layout);
+    }
 
     int height_per_process = height / number_of_processes;
     int rest = height % number_of_processes;
 
     int local_height = height_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
+
+    /* Convolutions of BMP files never need the RGB pixels, other luma operations go through gray ones */
+    if (operation->luma_mode != NO_LUMA_MODE && operation->type == CONVOLUTION_OPERATION && !tiled_input && !is_tiled_image_file_name(out_file_name)) {
+        double elapsed_time = transform_luma_plane(
+            process_rank,
+            number_of_processes,
+            number_of_threads,
+            requested_operation,
+            &in_file_handle,
+            out_file_name,
+            height,
+            width,
+            height_per_process,
+            local_height,
+            first_row,
+            &layout
+        );
+
+        MPI_File_close(&in_file_handle);
+
+        return elapsed_time;
+    }
 
     RGB *initial_local_data;
     RGB *new_local_data;
@@ -116,6 +417,7 @@ int main(int argc, char *argv[]) {
     allocate_local_data(
         process_rank,
         number_of_processes,
+        number_of_threads,
         &initial_local_data,
         &new_local_data,
         local_height,
@@ -128,17 +430,31 @@ int main(int argc, char *argv[]) {
         parallel_version_start_time = MPI_Wtime();
     }
 
-    read_local_data_from_BMP_file(
-        process_rank,
-        number_of_processes,
-        &in_file_handle,
-        height,
-        width,
-        initial_local_data,
-        local_height,
-        height_per_process,
-        rest
-    );
+    if (tiled_input) {
+        read_strip_from_tiled_image_file(
+            process_rank,
+            number_of_processes,
+            number_of_threads,
+            &in_file_handle,
+            height,
+            width,
+            initial_local_data,
+            local_height,
+            first_row
+        );
+    } else {
+        read_local_data_from_BMP_file(
+            process_rank,
+            number_of_processes,
+            &in_file_handle,
+            height,
+            width,
+            initial_local_data,
+            local_height,
+            height_per_process,
+            rest
+        );
+    }
     
     MPI_File_close(&in_file_handle);
 
@@ -151,22 +467,27 @@ int main(int argc, char *argv[]) {
         fprintf(stdout, "\nLoading image from file %s\n", in_file_name);
         fflush(stdout);
 
-        Image *image = read_image_from_BMP_file(in_file_name);
-        if (!image) {
-            fprintf(stderr, "Error reading %s\n", in_file_name);
-            fflush(stderr);
-            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-        }
-
-        image_dimensions[0] = image->height;
-        image_dimensions[1] = image->width;
-        whole_initial_data = image->data;
+        Image *image = read_image_from_file(in_file_name);
+        if (image) {
+            image_dimensions[0] = image->height;
+            image_dimensions[1] = image->width;
+            whole_initial_data = image->data;
 
-        free(image);
+            free(image);
+        } else {
+            fprintf(stdout, "Error: Cannot read the image in %s\n", in_file_name);
+            fflush(stdout);
+            image_dimensions[0] = 0;
+            image_dimensions[1] = 0;
+        }
     }
 
     MPI_Bcast(image_dimensions, 2, MPI_INT, 0, MPI_COMM_WORLD);
 
+    if (image_dimensions[0] < 1) {
+        return INVALID_INPUT_RESULT;
+    }
+
     int height = image_dimensions[0];
     int width = image_dimensions[1];
 
@@ -174,6 +495,7 @@ int main(int argc, char *argv[]) {
     int rest = height % number_of_processes;
 
     int local_height = height_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
 
     RGB *initial_local_data;
     RGB *new_local_data;
@@ -181,6 +503,7 @@ int main(int argc, char *argv[]) {
     allocate_local_data(
         process_rank,
         number_of_processes,
+        number_of_threads,
         &initial_local_data,
         &new_local_data,
         local_height,
@@ -204,15 +527,35 @@ int main(int argc, char *argv[]) {
         width
     );
 
+    free(whole_initial_data);
+
 #endif
 
-    int padding = kernel_size / 2;
+    int padding = operation_padding(operation, height);
+
+    if (halo_deeper_than_strips(process_rank, number_of_processes, padding, height, height_per_process)) {
+        release_buffer(initial_local_data);
+        release_buffer(new_local_data);
+        return HALO_TOO_DEEP_RESULT;
+    }
+
+    unsigned char *chroma_blue = NULL;
+    unsigned char *chroma_red = NULL;
+
+    if (requested_operation->luma_mode == CHROMA_LUMA_MODE) {
+        chroma_blue = (unsigned char *)acquire_image_buffer((local_height * width + 1) * sizeof(unsigned char), width, number_of_threads);
+        chroma_red = (unsigned char *)acquire_image_buffer((local_height * width + 1) * sizeof(unsigned char), width, number_of_threads);
+    }
+    if (requested_operation->luma_mode != NO_LUMA_MODE) {
+        convert_to_gray_luma(number_of_threads, initial_local_data, local_height * width, chroma_blue, chroma_red);
+    }
 
     RGB *initial_local_data_with_padding;
     int local_height_with_padding;
     int width_with_padding;
     
     add_padding_to_data(
+        number_of_threads,
         initial_local_data,
         local_height,
         width,
@@ -228,59 +571,180 @@ int main(int argc, char *argv[]) {
         initial_local_data_with_padding,
         local_height_with_padding,
         width_with_padding,
-        padding
-    );
-    
-    convolution(
-        number_of_threads,
-        initial_local_data_with_padding,
-        local_height_with_padding,
-        width_with_padding,
-        new_local_data,
-        local_height,
-        width,
-        kernel,
-        kernel_size,
-        padding
+        padding,
+        MPI_COMM_WORLD
     );
 
-#ifdef SHARED_FILE_SYSTEM
+    if (operation_replicates_borders(operation)) {
+        replicate_border_padding(
+            process_rank,
+            number_of_processes,
+            initial_local_data_with_padding,
+            local_height_with_padding,
+            width_with_padding,
+            padding
+        );
+    }
 
-    if (process_rank == 0) {
-        parallel_version_end_time = MPI_Wtime();
-        fprintf(stdout, "\nEnded parallel work ...\n");
-        fflush(stdout);
+    /*
+     * Operations writing several images, or images of another size, keep one strip per
+     * output; a resampled strip holds the rows whose centre falls in the input strip
+     */
+    int number_of_outputs = operation_number_of_outputs(operation);
+    int separate_outputs = operation_resamples(operation) || number_of_outputs > 1;
+    RGB *output_local_data[MAX_OPERATION_OUTPUTS];
+    int output_heights[MAX_OPERATION_OUTPUTS];
+    int output_widths[MAX_OPERATION_OUTPUTS];
+    int output_first_rows[MAX_OPERATION_OUTPUTS];
+    int output_local_heights[MAX_OPERATION_OUTPUTS];
+
+    if (operation->type == PYRAMID_OPERATION) {
+        pyramid_level_strip_rows(first_row, local_height, height, number_of_outputs, output_first_rows, output_local_heights);
     }
 
-    MPI_File out_file_handle;
+    for (int output = 0; output < number_of_outputs && separate_outputs; output++) {
+        operation_output_size(operation, output, height, width, &output_heights[output], &output_widths[output]);
+
+        if (operation->type != PYRAMID_OPERATION) {
+            resampled_strip_rows(
+                first_row,
+                local_height,
+                height,
+                output_heights[output],
+                &output_first_rows[output],
+                &output_local_heights[output]
+            );
+        }
 
-    MPI_File_open(
-        MPI_COMM_WORLD,                         /* the communicator */
-        out_file_name,                          /* the name of the file to open */
-        MPI_MODE_WRONLY | MPI_MODE_CREATE,      /* the file access mode */
-        MPI_INFO_NULL,                          /* the info object */
-        &out_file_handle                        /* the file handle */
-    );
+        output_local_data[output] = (RGB *)acquire_image_buffer(
+            (output_local_heights[output] * output_widths[output] + 1) * sizeof(RGB),
+            output_widths[output] * sizeof(RGB),
+            number_of_threads
+        );
+    }
 
-    write_local_data_to_BMP_file(
-        process_rank,
-        number_of_processes,
-        &out_file_handle,
-        height,
-        width,
-        new_local_data,
-        local_height,
-        height_per_process,
-        rest
-    );
+    if (operation->type == PYRAMID_OPERATION) {
+        build_pyramid(
+            number_of_threads,
+            MPI_COMM_WORLD,
+            initial_local_data_with_padding,
+            width_with_padding,
+            padding,
+            first_row,
+            local_height,
+            height,
+            width,
+            output_local_data,
+            number_of_outputs,
+            operation->filter,
+            &operation->epilogue
+        );
+    } else if (operation_resamples(operation)) {
+        resample(
+            number_of_threads,
+            initial_local_data_with_padding,
+            width_with_padding,
+            padding,
+            first_row,
+            height,
+            width,
+            output_local_data[0],
+            output_first_rows[0],
+            output_local_heights[0],
+            output_heights[0],
+            output_widths[0],
+            operation->filter,
+            &operation->epilogue
+        );
+    } else if (separate_outputs) {
+        fused_convolution(
+            number_of_threads,
+            initial_local_data_with_padding,
+            local_height_with_padding,
+            width_with_padding,
+            output_local_data,
+            local_height,
+            width,
+            operation->fused_outputs,
+            operation->number_of_fused_outputs,
+            padding,
+            &operation->epilogue
+        );
+    } else {
+        apply_operation(
+            number_of_threads,
+            operation,
+            initial_local_data_with_padding,
+            local_height_with_padding,
+            width_with_padding,
+            new_local_data,
+            local_height,
+            width,
+            padding,
+            first_row,
+            height,
+            MPI_COMM_WORLD
+        );
+    }
 
-    MPI_File_close(&out_file_handle);
+#ifdef SHARED_FILE_SYSTEM
 
     if (process_rank == 0) {
-        printf("\nModified image saved in file %s\n", out_file_name);
+        parallel_version_end_time = MPI_Wtime();
+        fprintf(stdout, "\nEnded parallel work ...\n");
+        fflush(stdout);
     }
 
-    if (process_rank == 0) {
+    if (separate_outputs) {
+        for (int output = 0; output < number_of_outputs; output++) {
+            char output_file_name[FILENAME_MAX];
+            operation_output_file_name(operation, output, out_file_name, output_file_name, sizeof(output_file_name));
+
+            write_output_strip(
+                process_rank,
+                number_of_processes,
+                number_of_threads,
+                requested_operation,
+                output_file_name,
+                output_heights[output],
+                output_widths[output],
+                output_local_data[output],
+                output_local_heights[output],
+                output_first_rows[output],
+                &layout,
+                chroma_blue,
+                chroma_red
+            );
+
+            release_buffer(output_local_data[output]);
+
+            if (process_rank == 0) {
+                printf("\nModified %dx%d image saved in file %s\n", output_widths[output], output_heights[output], output_file_name);
+            }
+        }
+    } else {
+        write_output_strip(
+            process_rank,
+            number_of_processes,
+            number_of_threads,
+            requested_operation,
+            out_file_name,
+            height,
+            width,
+            new_local_data,
+            local_height,
+            first_row,
+            &layout,
+            chroma_blue,
+            chroma_red
+        );
+
+        if (process_rank == 0) {
+            printf("\nModified image saved in file %s\n", out_file_name);
+        }
+    }
+
+    if (process_rank == 0) {
         parallel_version_elapsed_time = parallel_version_end_time - parallel_version_start_time;
         fprintf(stdout, "\nParallel version elapsed time: %f seconds\n", parallel_version_elapsed_time);
         fflush(stdout);
@@ -295,10 +759,9 @@ int main(int argc, char *argv[]) {
         if (!whole_new_data) {
             fprintf(stderr, "Error: Memory allocation failed\n");
             fflush(stderr);
-            free(whole_initial_data);
-            free(initial_local_data);
-            free(initial_local_data_with_padding);
-            free(new_local_data);
+            release_buffer(initial_local_data);
+            release_buffer(initial_local_data_with_padding);
+            release_buffer(new_local_data);
             MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
         }
     }
@@ -326,7 +789,7 @@ int main(int argc, char *argv[]) {
         new_image->width = width;
         new_image->data = whole_new_data;
 
-        save_image_to_BMP_file(new_image, out_file_name);
+        save_image_to_file(new_image, out_file_name);
         fprintf(stdout, "\nModified image saved in file %s\n", out_file_name);
         fflush(stdout);
 
@@ -340,98 +803,224 @@ int main(int argc, char *argv[]) {
 
 #endif
 
-    free(initial_local_data);
-    free(initial_local_data_with_padding);
-    free(new_local_data);
+    release_buffer(initial_local_data);
+    release_buffer(initial_local_data_with_padding);
+    release_buffer(new_local_data);
+    release_buffer(chroma_blue);
+    release_buffer(chroma_red);
+
+    return parallel_version_elapsed_time;
+}
+
+/* Runs the operation serially on rank 0 and compares the result with the parallel output files */
+static void compare_with_serial_version(
+    const Operation *operation,             /* in */
+    const char *in_file_name,               /* in */
+    const char *out_file_name,              /* in */
+    double parallel_version_elapsed_time    /* in */
+) {
+    const Operation *requested_operation = operation;
+    Operation gray_operation;
+    if (operation->luma_mode != NO_LUMA_MODE) {
+        gray_operation = *operation;
+        gray_operation.epilogue.number_of_stages = 0;
+        operation = &gray_operation;
+    }
 
-    if (process_rank == 0) {
-        double serial_version_start_time = 0.0;
-        double serial_version_end_time = 0.0;
-        double serial_version_elapsed_time = 0.0;
+    double serial_version_start_time = 0.0;
+    double serial_version_end_time = 0.0;
+    double serial_version_elapsed_time = 0.0;
 
-        fprintf(stdout, "\nLoading image from file %s\n", in_file_name);
-        fflush(stdout);
-        
-        Image *image = read_image_from_BMP_file(in_file_name);
-        if (!image) {
-            fprintf(stderr, "Error reading %s\n", in_file_name);
+    fprintf(stdout, "\nLoading image from file %s\n", in_file_name);
+    fflush(stdout);
+    
+    Image *image = read_image_from_file(in_file_name);
+    if (!image) {
+        fprintf(stderr, "Error reading %s\n", in_file_name);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int height = image->height;
+    int width = image->width;
+    int padding = operation_padding(operation, height);
+    int number_of_outputs = operation_number_of_outputs(operation);
+    int separate_outputs = operation_resamples(operation) || number_of_outputs > 1;
+
+    RGB *serial_new_data[MAX_OPERATION_OUTPUTS];
+    int serial_new_heights[MAX_OPERATION_OUTPUTS];
+    int serial_new_widths[MAX_OPERATION_OUTPUTS];
+
+    for (int output = 0; output < number_of_outputs; output++) {
+        operation_output_size(operation, output, image->height, image->width, &serial_new_heights[output], &serial_new_widths[output]);
+        serial_new_data[output] = (RGB *)malloc(serial_new_heights[output] * serial_new_widths[output] * sizeof(RGB));
+        if (!serial_new_data[output]) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
             fflush(stderr);
             MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
         }
+    }
+
+    fprintf(stdout, "\nStart serial work ...\n");
+    fflush(stdout);
 
-        RGB *new_data = (RGB *)malloc(image->height * image->width * sizeof(RGB));
-        if (!new_data) {
+    serial_version_start_time = MPI_Wtime();
+
+    unsigned char *chroma_blue = NULL;
+    unsigned char *chroma_red = NULL;
+
+    if (requested_operation->luma_mode == CHROMA_LUMA_MODE) {
+        chroma_blue = (unsigned char *)malloc(height * width * sizeof(unsigned char));
+        chroma_red = (unsigned char *)malloc(height * width * sizeof(unsigned char));
+        if (!chroma_blue || !chroma_red) {
             fprintf(stderr, "Error: Memory allocation failed\n");
             fflush(stderr);
             MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
         }
+    }
+    if (requested_operation->luma_mode != NO_LUMA_MODE) {
+        convert_to_gray_luma(1, image->data, height * width, chroma_blue, chroma_red);
+    }
 
-        fprintf(stdout, "\nStart serial work ...\n");
-        fflush(stdout);
+    RGB *data_with_padding;
+    int height_with_padding;
+    int width_with_padding;
 
-        serial_version_start_time = MPI_Wtime();
+    add_padding_to_data(
+        1,
+        image->data,
+        image->height,
+        image->width,
+        padding,
+        &data_with_padding,
+        &height_with_padding,
+        &width_with_padding
+    );
 
-        int padding = kernel_size / 2;
+    free(image->data);
 
-        RGB *data_with_padding;
-        int height_with_padding;
-        int width_with_padding;
+    if (operation_replicates_borders(operation)) {
+        replicate_border_padding(
+            0,
+            1,
+            data_with_padding,
+            height_with_padding,
+            width_with_padding,
+            padding
+        );
+    }
 
-        add_padding_to_data(
-            image->data,
-            image->height,
-            image->width,
+    if (operation->type == PYRAMID_OPERATION) {
+        build_pyramid(
+            1,
+            MPI_COMM_SELF,
+            data_with_padding,
+            width_with_padding,
             padding,
-            &data_with_padding,
-            &height_with_padding,
-            &width_with_padding
+            0,
+            height,
+            height,
+            width,
+            serial_new_data,
+            number_of_outputs,
+            operation->filter,
+            &operation->epilogue
         );
-
-        free(image->data);
-
-        convolution(
+    } else if (operation_resamples(operation)) {
+        resample(
+            1,
+            data_with_padding,
+            width_with_padding,
+            padding,
+            0,
+            height,
+            width,
+            serial_new_data[0],
+            0,
+            serial_new_heights[0],
+            serial_new_heights[0],
+            serial_new_widths[0],
+            operation->filter,
+            &operation->epilogue
+        );
+    } else if (separate_outputs) {
+        fused_convolution(
             1,
             data_with_padding,
             height_with_padding,
             width_with_padding,
-            new_data,
+            serial_new_data,
             height,
             width,
-            kernel,
-            kernel_size,
-            padding
+            operation->fused_outputs,
+            operation->number_of_fused_outputs,
+            padding,
+            &operation->epilogue
         );
+    } else {
+        apply_operation(
+            1,
+            operation,
+            data_with_padding,
+            height_with_padding,
+            width_with_padding,
+            serial_new_data[0],
+            height,
+            width,
+            padding,
+            0,
+            height,
+            MPI_COMM_SELF
+        );
+    }
 
-        serial_version_end_time = MPI_Wtime();
+    if (requested_operation->luma_mode != NO_LUMA_MODE) {
+        for (int output = 0; output < number_of_outputs; output++) {
+            store_luma_result(1, serial_new_data[output], serial_new_heights[output] * serial_new_widths[output], chroma_blue, chroma_red, NULL, &requested_operation->epilogue);
+        }
+    }
 
-        fprintf(stdout, "\nEnded serial work ...\n");
-        fflush(stdout);
+    serial_version_end_time = MPI_Wtime();
 
-        free(data_with_padding);
+    fprintf(stdout, "\nEnded serial work ...\n");
+    fflush(stdout);
 
-        image->data = new_data;
+    release_buffer(data_with_padding);
+    free(chroma_blue);
+    free(chroma_red);
 
-        save_image_to_BMP_file(image, "serial_version.bmp");
+    serial_version_elapsed_time = serial_version_end_time - serial_version_start_time;
 
-        fprintf(stdout, "\nModified image saved in file serial_version.bmp\n");
-        fflush(stdout);
+    fprintf(stdout, "\nSerial version elapsed time: %f seconds\n", serial_version_elapsed_time);
+    fflush(stdout);
 
-        serial_version_elapsed_time = serial_version_end_time - serial_version_start_time;
+    fprintf(stdout, "\nSpeedup = %f\n", serial_version_elapsed_time / parallel_version_elapsed_time);
+    fflush(stdout);
 
-        fprintf(stdout, "\nSerial version elapsed time: %f seconds\n", serial_version_elapsed_time);
-        fflush(stdout);
+    for (int output = 0; output < number_of_outputs; output++) {
+        char serial_file_name[FILENAME_MAX];
+        char parallel_file_name[FILENAME_MAX];
+        operation_output_file_name(operation, output, "serial_version.bmp", serial_file_name, sizeof(serial_file_name));
+        operation_output_file_name(operation, output, out_file_name, parallel_file_name, sizeof(parallel_file_name));
 
-        fprintf(stdout, "\nSpeedup = %f\n", serial_version_elapsed_time / parallel_version_elapsed_time);
+        image->height = serial_new_heights[output];
+        image->width = serial_new_widths[output];
+        image->data = serial_new_data[output];
+
+        save_image_to_BMP_file(image, serial_file_name);
+
+        fprintf(stdout, "\nModified image saved in file %s\n", serial_file_name);
         fflush(stdout);
 
-        Image *image_from_parallel_version = read_image_from_BMP_file(out_file_name);
+        Image *image_from_parallel_version = read_image_from_file(parallel_file_name);
         if (!image_from_parallel_version) {
-            fprintf(stderr, "Error reading %s\n", in_file_name);
+            fprintf(stderr, "Error reading %s\n", parallel_file_name);
             fflush(stderr);
             MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
         }
 
-        if (!equal_results(new_data, image_from_parallel_version->data, image->height, image->width)) {
+        if (image_from_parallel_version->height != image->height || image_from_parallel_version->width != image->width
+                || !equal_results(image->data, image_from_parallel_version->data, image->height, image->width)) {
             fprintf(stdout, "\nSerial and parallel results are different!\n");
             fflush(stdout);
         } else {
@@ -439,12 +1028,911 @@ int main(int argc, char *argv[]) {
             fflush(stdout);
         }
 
-        free(image->data);
-        free(image);
+        free(serial_new_data[output]);
 
         free(image_from_parallel_version->data);
         free(image_from_parallel_version);
     }
 
+    free(image);
+}
+
+/* Returns 1 when the header of the file is one transform_image() reads; rank 0 only, before the job is broadcast */
+static int readable_image_file(
+    const char *file_name   /* in */
+) {
+    MPI_File file_handle;
+    if (MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &file_handle) != MPI_SUCCESS) {
+        return 0;
+    }
+
+    int height;
+    int width;
+    BMPLayout layout;
+    int invalid = is_tiled_image_file_name(file_name)
+        ? read_header_from_tiled_image_file(&file_handle, &height, &width)
+        : read_BMP_header_from_BMP_file(&file_handle, &height, &width, &layout);
+
+    MPI_File_close(&file_handle);
+    return !invalid;
+}
+
+/* Waits for a job rank 0 can start, itself answering malformed jobs and jobs whose input it cannot read */
+static int accept_startable_job(
+    int job_socket,     /* in */
+    char *job           /* out */
+) {
+    char job_fields[MAX_JOB_LENGTH];
+    char reply[MAX_JOB_LENGTH];
+
+    while (1) {
+        int connection = accept_job(job_socket, job, MAX_JOB_LENGTH);
+        if (connection < 0) {
+            continue;
+        }
+        if (strcmp(job, SHUTDOWN_JOB) == 0) {
+            return connection;
+        }
+
+        int number_of_threads;
+        char *operation_argument;
+        char *in_file_name;
+        char *out_file_name;
+        strcpy(job_fields, job);
+
+        /* Teams are capped at the threads the server was started with, which the host was sized for */
+        if (split_job(job_fields, &number_of_threads, &operation_argument, &in_file_name, &out_file_name) || number_of_threads < 1) {
+            reply_to_job(connection, "ERROR Jobs are <threads, at least 1>\t<operation>\t<input file>\t<output file>\n");
+        } else if (number_of_threads > omp_get_max_threads()) {
+            snprintf(reply, sizeof(reply), "ERROR Jobs take at most %d threads\n", omp_get_max_threads());
+            reply_to_job(connection, reply);
+        } else if (access(in_file_name, R_OK) != 0) {
+            snprintf(reply, sizeof(reply), "ERROR Cannot read %s\n", in_file_name);
+            reply_to_job(connection, reply);
+        } else if (!readable_image_file(in_file_name)) {
+            snprintf(reply, sizeof(reply), "ERROR %s is not a 24-bit or 32-bit BMP file or a tiled image file\n", in_file_name);
+            reply_to_job(connection, reply);
+        } else {
+            return connection;
+        }
+    }
+}
+
+/*
+ * Server mode: MPI, the OpenMP teams, the FFT plans and the buffer pool are set up once,
+ * then rank 0 accepts jobs on a UNIX socket and broadcasts them to every rank
+ */
+static void serve_jobs(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    const char *socket_path     /* in */
+) {
+    int job_socket = -1;
+    char job[MAX_JOB_LENGTH];
+    char reply[MAX_JOB_LENGTH];
+
+    if (process_rank == 0) {
+        job_socket = open_job_socket(socket_path);
+        if (job_socket < 0) {
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        fprintf(stdout, "\nServing jobs on %s with %d processes\n", socket_path, number_of_processes);
+        fflush(stdout);
+    }
+
+    while (1) {
+        int connection = -1;
+
+        if (process_rank == 0) {
+            connection = accept_startable_job(job_socket, job);
+        }
+
+        MPI_Bcast(job, MAX_JOB_LENGTH, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        if (strcmp(job, SHUTDOWN_JOB) == 0) {
+            if (process_rank == 0) {
+                reply_to_job(connection, "OK\n");
+            }
+            break;
+        }
+
+        double job_start_time = MPI_Wtime();
+
+        int number_of_threads;
+        char *operation_argument;
+        char *in_file_name;
+        char *out_file_name;
+        split_job(job, &number_of_threads, &operation_argument, &in_file_name, &out_file_name);
+
+        double *custom_kernel = NULL;
+        Operation operation;
+        double parallel_version_elapsed_time = -1.0;
+
+        /* Every rank parses the same job, so they all agree on its validity */
+        int invalid_operation = parse_operation(process_rank, operation_argument, &operation, &custom_kernel);
+        if (!invalid_operation) {
+            parallel_version_elapsed_time = transform_image(
+                process_rank,
+                number_of_processes,
+                number_of_threads,
+                &operation,
+                in_file_name,
+                out_file_name
+            );
+        }
+
+        free(custom_kernel);
+
+        if (process_rank == 0) {
+            if (invalid_operation) {
+                snprintf(reply, sizeof(reply), "ERROR Invalid operation %s\n", operation_argument);
+            } else if (parallel_version_elapsed_time == HALO_TOO_DEEP_RESULT) {
+                snprintf(reply, sizeof(reply), "ERROR The halo of %s is deeper than the strips of %d processes\n", operation_argument, number_of_processes);
+            } else if (parallel_version_elapsed_time == INVALID_INPUT_RESULT) {
+                snprintf(reply, sizeof(reply), "ERROR Cannot read the image in %s\n", in_file_name);
+            } else if (parallel_version_elapsed_time < 0.0) {
+                snprintf(reply, sizeof(reply), "ERROR %s is not supported by this build or for %s\n", operation_argument, out_file_name);
+            } else {
+                snprintf(reply, sizeof(reply), "OK %f %f\n", parallel_version_elapsed_time, MPI_Wtime() - job_start_time);
+            }
+            reply_to_job(connection, reply);
+        }
+    }
+
+    if (process_rank == 0) {
+        close_job_socket(job_socket, socket_path);
+    }
+}
+
+#define MAX_PLACEMENT_LENGTH 1024
+
+/* Rows of the input band the trial convolutions of the autotune mode run on */
+#define TUNING_BAND_HEIGHT 128
+
+#define MAX_PROFILE_FILE_NAME_LENGTH 1024
+
+/* Prints, for every process, the host and the cores its OpenMP threads run on, warning when they are not pinned */
+static void report_thread_placement(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int number_of_threads       /* in */
+) {
+    char placement[MAX_PLACEMENT_LENGTH];
+    char host_name[64];
+    int cpus[number_of_threads];
+
+    if (gethostname(host_name, sizeof(host_name)) != 0) {
+        strcpy(host_name, "unknown");
+    }
+    host_name[sizeof(host_name) - 1] = '\0';
+
+    #pragma omp parallel num_threads(number_of_threads)
+    {
+        cpus[omp_get_thread_num()] = sched_getcpu();
+    }
+
+    int length = snprintf(placement, sizeof(placement), "Process %d on %s, threads on cores", process_rank, host_name);
+    for (int thread = 0; thread < number_of_threads && length < (int)sizeof(placement); thread++) {
+        length += snprintf(placement + length, sizeof(placement) - length, " %d", cpus[thread]);
+    }
+    if (length < (int)sizeof(placement) && omp_get_proc_bind() == omp_proc_bind_false) {
+        snprintf(placement + length, sizeof(placement) - length, " (not pinned, set OMP_PROC_BIND and OMP_PLACES)");
+    }
+
+    char *placements = NULL;
+    if (process_rank == 0) {
+        placements = (char *)malloc(number_of_processes * MAX_PLACEMENT_LENGTH * sizeof(char));
+        if (!placements) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+
+    MPI_Gather(placement, MAX_PLACEMENT_LENGTH, MPI_CHAR, placements, MAX_PLACEMENT_LENGTH, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\n");
+        for (int i = 0; i < number_of_processes; i++) {
+            fprintf(stdout, "%s\n", placements + i * MAX_PLACEMENT_LENGTH);
+        }
+        fflush(stdout);
+        free(placements);
+    }
+}
+
+/*
+ * Tunes convolution() for the given operation on a band from the middle of the
+ * input. The processes of every host tune together and the host's first process
+ * saves the profile, which later runs on that host load at startup.
+ */
+static void autotune(
+    int process_rank,                   /* in */
+    int number_of_processes,            /* in */
+    const char *operation_argument,     /* in */
+    const char *in_file_name            /* in */
+) {
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, operation_argument, &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (operation.type != CONVOLUTION_OPERATION || operation.luma_mode != NO_LUMA_MODE || operation.epilogue.number_of_stages > 0) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The autotune mode takes a single convolution kernel\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    MPI_Comm host_communicator;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, process_rank, MPI_INFO_NULL, &host_communicator);
+
+    int host_rank;
+    int processes_on_host;
+    MPI_Comm_rank(host_communicator, &host_rank);
+    MPI_Comm_size(host_communicator, &processes_on_host);
+
+    int band_dimensions[3];
+    RGB *band = NULL;
+
+    if (process_rank == 0) {
+        Image *image = read_image_from_file(in_file_name);
+        if (!image) {
+            fprintf(stderr, "Error reading %s\n", in_file_name);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        int band_height = (image->height < TUNING_BAND_HEIGHT) ? image->height : TUNING_BAND_HEIGHT;
+        int first_band_row = (image->height - band_height) / 2;
+
+        band_dimensions[0] = band_height;
+        band_dimensions[1] = image->width;
+        band_dimensions[2] = image->height;
+
+        band = (RGB *)malloc(band_height * image->width * sizeof(RGB));
+        if (!band) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        memcpy(band, image->data + first_band_row * image->width, band_height * image->width * sizeof(RGB));
+
+        free(image->data);
+        free(image);
+    }
+
+    MPI_Bcast(band_dimensions, 3, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int height = band_dimensions[0];
+    int width = band_dimensions[1];
+
+    if (process_rank != 0) {
+        band = (RGB *)malloc(height * width * sizeof(RGB));
+        if (!band) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+
+    MPI_Bcast(band, height * width * 3, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+
+    int padding = operation_padding(&operation, band_dimensions[2]);
+
+    RGB *band_with_padding;
+    int height_with_padding;
+    int width_with_padding;
+
+    add_padding_to_data(1, band, height, width, padding, &band_with_padding, &height_with_padding, &width_with_padding);
+    free(band);
+
+    RGB *new_band = (RGB *)acquire_buffer((height * width + 1) * sizeof(RGB));
+
+    /* Processes left unbound see every core of the host, which they share */
+    int cores_on_host = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = omp_get_num_procs();
+    if (max_threads * processes_on_host > cores_on_host) {
+        max_threads = cores_on_host / processes_on_host;
+    }
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+
+    char profile_file_name[MAX_PROFILE_FILE_NAME_LENGTH];
+    tuning_profile_file_name(profile_file_name, sizeof(profile_file_name));
+
+    TuningProfile profile;
+    if (load_tuning_profile(profile_file_name, &profile)) {
+        profile.fft_crossover_kernel_size = FFT_CONVOLUTION_CROSSOVER_KERNEL_SIZE;
+    }
+
+    double single_thread_time;
+    double best_time;
+
+    tune_convolution(
+        process_rank,
+        host_communicator,
+        max_threads,
+        band_with_padding,
+        height_with_padding,
+        width_with_padding,
+        new_band,
+        height,
+        width,
+        operation.kernel,
+        operation.kernel_size,
+        padding,
+        &profile,
+        &single_thread_time,
+        &best_time
+    );
+
+    if (host_rank == 0) {
+        char host_name[64];
+        if (gethostname(host_name, sizeof(host_name)) != 0) {
+            strcpy(host_name, "unknown");
+        }
+        host_name[sizeof(host_name) - 1] = '\0';
+
+        fprintf(stdout, "\nBest on %s: %d threads, %s schedule with chunk %d, FFT from %dx%d kernels with tile side %d (0 is automatic)\n",
+            host_name,
+            profile.number_of_threads,
+            schedule_name(profile.schedule),
+            profile.chunk_size,
+            profile.fft_crossover_kernel_size,
+            profile.fft_crossover_kernel_size,
+            profile.fft_tile_size
+        );
+        fprintf(stdout, "%d threads run %.2fx faster than 1 thread with %d processes on the host\n",
+            profile.number_of_threads,
+            single_thread_time / best_time,
+            processes_on_host
+        );
+
+        int advised_processes = cores_on_host / profile.number_of_threads;
+        if (advised_processes < 1) {
+            advised_processes = 1;
+        }
+        fprintf(stdout, "Advice: run %d processes per %d core host with %d threads each\n", advised_processes, cores_on_host, profile.number_of_threads);
+
+        if (save_tuning_profile(profile_file_name, &profile)) {
+            fprintf(stderr, "Error: Cannot write the tuning profile %s\n", profile_file_name);
+            fflush(stderr);
+        } else {
+            fprintf(stdout, "Tuning profile saved in %s\n", profile_file_name);
+        }
+        fflush(stdout);
+    }
+
+    release_buffer(band_with_padding);
+    release_buffer(new_band);
+    free(custom_kernel);
+    MPI_Comm_free(&host_communicator);
+}
+
+/* Checks the arguments of the sequence mode, then runs the frame pipeline */
+static void run_frame_sequence(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int argc,                   /* in */
+    char *argv[]                /* in */
+) {
+    int number_of_threads = strtol(argv[2], NULL, 10);
+    int first_frame = strtol(argv[6], NULL, 10);
+    int number_of_frames = strtol(argv[7], NULL, 10);
+    int number_of_compute_groups = (argc == 9) ? strtol(argv[8], NULL, 10) : 1;
+
+    const char *error = NULL;
+    if (number_of_processes < 3) {
+        error = "The sequence mode needs at least 3 processes, a reader, a writer and compute processes";
+    } else if (number_of_threads < 1) {
+        error = "The number of threads must be at least 1";
+    } else if (check_frame_pattern(argv[4]) || check_frame_pattern(argv[5])) {
+        error = "Frame patterns must hold exactly one %d, such as frame_%04d.bmp";
+    } else if (number_of_frames < 1) {
+        error = "The number of frames must be at least 1";
+    } else if (number_of_compute_groups < 1 || number_of_compute_groups > number_of_processes - 2) {
+        error = "There must be between 1 compute group and one per compute process";
+    }
+
+    if (error) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: %s\n", error);
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[3], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (operation_resamples(&operation) || operation_number_of_outputs(&operation) > 1 || operation.luma_mode != NO_LUMA_MODE) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The sequence mode takes operations writing one image of the input size\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    report_thread_placement(process_rank, number_of_processes, number_of_threads);
+
+    process_frame_sequence(
+        process_rank,
+        number_of_processes,
+        number_of_threads,
+        &operation,
+        argv[4],
+        argv[5],
+        first_frame,
+        number_of_frames,
+        number_of_compute_groups
+    );
+
+    free(custom_kernel);
+}
+
+/* Checks the arguments of the incremental mode, then reprocesses the tiles whose input changed */
+static void run_incrementally(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    char *argv[]                /* in */
+) {
+    int number_of_threads = strtol(argv[2], NULL, 10);
+
+    if (number_of_threads < 1) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The number of threads must be at least 1\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[3], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (!operation_is_tile_local(&operation)) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The incremental mode takes operations whose pixels only depend on their neighbourhood\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    process_incrementally(
+        process_rank,
+        number_of_processes,
+        number_of_threads,
+        &operation,
+        argv[4],
+        argv[5],
+        argv[6]
+    );
+
+    free(custom_kernel);
+}
+
+/* Checks the arguments of the region of interest modes, --roi writing the crop and --roi-patch a patched copy */
+static void run_region_of_interest(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    char *argv[]                /* in */
+) {
+    RegionOfInterest region;
+    int number_of_threads = strtol(argv[3], NULL, 10);
+
+    const char *error = NULL;
+    if (parse_region_of_interest(argv[2], &region)) {
+        error = "The region must be given as x,y,width,height";
+    } else if (number_of_threads < 1) {
+        error = "The number of threads must be at least 1";
+    }
+
+    if (error) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: %s\n", error);
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[4], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (!operation_is_tile_local(&operation)) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: Regions of interest take operations whose pixels only depend on their neighbourhood\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    process_region_of_interest(
+        process_rank,
+        number_of_processes,
+        number_of_threads,
+        &operation,
+        &region,
+        argv[5],
+        argv[6],
+        strcmp(argv[1], "--roi-patch") == 0
+    );
+
+    free(custom_kernel);
+}
+
+/* Checks the arguments of the low-memory mode, which only runs direct convolutions, below the FFT crossover, between BMP files */
+static void run_low_memory(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    char *argv[]                /* in */
+) {
+    int number_of_threads = strtol(argv[2], NULL, 10);
+
+    if (number_of_threads < 1) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The number of threads must be at least 1\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[3], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* Kernels past the crossover run through the FFT engine, whose tiles are as large as the strips */
+    int crossover_kernel_size = fft_convolution_crossover_kernel_size();
+    char kernel_size_error[128];
+    snprintf(kernel_size_error, sizeof(kernel_size_error), "The low-memory mode takes kernels smaller than %dx%d, the ones convolved directly", crossover_kernel_size, crossover_kernel_size);
+
+    const char *error = NULL;
+    if (operation.type != CONVOLUTION_OPERATION || operation.luma_mode != NO_LUMA_MODE) {
+        error = "The low-memory mode takes convolutions of all the channels";
+    } else if (operation.kernel_size >= crossover_kernel_size) {
+        error = kernel_size_error;
+    } else if (is_tiled_image_file_name(argv[4]) || is_tiled_image_file_name(argv[5])) {
+        error = "The low-memory mode reads and writes BMP files";
+    }
+
+    if (error) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: %s\n", error);
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    process_with_line_buffers(
+        process_rank,
+        number_of_processes,
+        number_of_threads,
+        &operation,
+        argv[4],
+        argv[5]
+    );
+
+    free(custom_kernel);
+}
+
+/* Checks the arguments of the dynamic mode, which balances blocks of rows of BMP files among the processes */
+static void run_with_work_stealing(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    char *argv[]                /* in */
+) {
+    int number_of_threads = strtol(argv[2], NULL, 10);
+
+    if (number_of_threads < 1) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The number of threads must be at least 1\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[3], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    const char *error = NULL;
+    if (!operation_is_tile_local(&operation)) {
+        error = "The dynamic mode takes operations whose pixels only depend on their neighbourhood";
+    } else if (is_tiled_image_file_name(argv[4]) || is_tiled_image_file_name(argv[5])) {
+        error = "The dynamic mode reads and writes BMP files";
+    }
+
+    if (error) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: %s\n", error);
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    process_with_work_stealing(
+        process_rank,
+        number_of_processes,
+        number_of_threads,
+        &operation,
+        argv[4],
+        argv[5]
+    );
+
+    free(custom_kernel);
+}
+
+/*
+ * Checks the arguments of the preview mode, which writes a preview of the operation on the
+ * input decimated by the given factor, then optionally runs the full-resolution job
+ */
+static void run_preview(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int argc,                   /* in */
+    char *argv[]                /* in */
+) {
+    int factor = strtol(argv[2], NULL, 10);
+    int number_of_threads = strtol(argv[3], NULL, 10);
+
+    const char *error = NULL;
+    if (factor < 2) {
+        error = "The decimation factor must be at least 2";
+    } else if (number_of_threads < 1) {
+        error = "The number of threads must be at least 1";
+    } else if (is_tiled_image_file_name(argv[5]) || is_tiled_image_file_name(argv[6])) {
+        error = "Previews are read from and written to BMP files";
+    }
+
+    if (error) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: %s\n", error);
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[4], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double *scaled_kernel;
+    Operation preview_operation;
+
+    if (scale_operation_for_preview(&operation, factor, &preview_operation, &scaled_kernel)) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: Previews take operations writing one image of the input size, without luma modes\n");
+            fflush(stdout);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (process_preview(process_rank, number_of_processes, number_of_threads, &preview_operation, factor, argv[5], argv[6]) < 0.0) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    free(scaled_kernel);
+
+    if (argc == 8) {
+        double parallel_version_elapsed_time = transform_image(
+            process_rank,
+            number_of_processes,
+            number_of_threads,
+            &operation,
+            argv[5],
+            argv[7]
+        );
+
+        if (parallel_version_elapsed_time < 0.0) {
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+
+        if (process_rank == 0) {
+            compare_with_serial_version(&operation, argv[5], argv[7], parallel_version_elapsed_time);
+        }
+    }
+
+    free(custom_kernel);
+}
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+
+    int number_of_processes;
+    MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+
+    /* Convolutions run with the static schedule unless this host has a tuning profile */
+    omp_set_schedule(omp_sched_static, 0);
+
+    char profile_file_name[MAX_PROFILE_FILE_NAME_LENGTH];
+    tuning_profile_file_name(profile_file_name, sizeof(profile_file_name));
+
+    TuningProfile profile;
+    int has_profile = (load_tuning_profile(profile_file_name, &profile) == 0);
+    if (has_profile) {
+        apply_tuning_profile(&profile);
+        if (process_rank == 0) {
+            fprintf(stdout, "Loaded tuning profile %s\n", profile_file_name);
+            fflush(stdout);
+        }
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--autotune") == 0) {
+        report_thread_placement(process_rank, number_of_processes, omp_get_max_threads());
+
+        autotune(process_rank, number_of_processes, argv[2], argv[3]);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if ((argc == 8 || argc == 9) && strcmp(argv[1], "--sequence") == 0) {
+        run_frame_sequence(process_rank, number_of_processes, argc, argv);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc == 7 && strcmp(argv[1], "--incremental") == 0) {
+        run_incrementally(process_rank, number_of_processes, argv);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc == 7 && (strcmp(argv[1], "--roi") == 0 || strcmp(argv[1], "--roi-patch") == 0)) {
+        run_region_of_interest(process_rank, number_of_processes, argv);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc == 6 && strcmp(argv[1], "--low-memory") == 0) {
+        run_low_memory(process_rank, number_of_processes, argv);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc == 6 && strcmp(argv[1], "--dynamic") == 0) {
+        run_with_work_stealing(process_rank, number_of_processes, argv);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if ((argc == 7 || argc == 8) && strcmp(argv[1], "--preview") == 0) {
+        run_preview(process_rank, number_of_processes, argc, argv);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0) {
+        report_thread_placement(process_rank, number_of_processes, omp_get_max_threads());
+
+        serve_jobs(process_rank, number_of_processes, argv[2]);
+
+        free_fft_plans();
+        free_buffer_pool();
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (argc != 5) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Usage: %s <number of threads> <operation> <input file> <output file>\n", argv[0]);
+            fprintf(stdout, "       %s --serve <socket path>\n", argv[0]);
+            fprintf(stdout, "       %s --autotune <convolution> <input file>\n", argv[0]);
+            fprintf(stdout, "       %s --sequence <number of threads> <operation> <input pattern> <output pattern> <first frame> <number of frames> [<compute groups>]\n", argv[0]);
+            fprintf(stdout, "       %s --incremental <number of threads> <operation> <input file> <output file> <cache directory>\n", argv[0]);
+            fprintf(stdout, "       %s --roi|--roi-patch <x,y,width,height> <number of threads> <operation> <input file> <output file>\n", argv[0]);
+            fprintf(stdout, "       %s --low-memory <number of threads> <convolution> <input file> <output file>\n", argv[0]);
+            fprintf(stdout, "       %s --dynamic <number of threads> <operation> <input file> <output file>\n", argv[0]);
+            fprintf(stdout, "       %s --preview <decimation factor> <number of threads> <operation> <input file> <preview file> [<output file>]\n", argv[0]);
+            fprintf(stdout, "<number of threads> may be auto, taken from the tuning profile of the host\n");
+            fprintf(stdout, "Input and output files ending in %s use the tiled compressed format instead of BMP\n", TILED_IMAGE_FILE_EXTENSION);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int number_of_threads = strtol(argv[1], NULL, 10);
+    if (strcmp(argv[1], "auto") == 0) {
+        number_of_threads = has_profile ? profile.number_of_threads : omp_get_max_threads();
+    }
+
+    if (number_of_threads < 1) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The number of threads must be at least 1\n");
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    report_thread_placement(process_rank, number_of_processes, number_of_threads);
+
+    const char *in_file_name = argv[3];
+    const char *out_file_name = argv[4];
+
+    double *custom_kernel;
+    Operation operation;
+
+    if (parse_operation(process_rank, argv[2], &operation, &custom_kernel)) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    double parallel_version_elapsed_time = transform_image(
+        process_rank,
+        number_of_processes,
+        number_of_threads,
+        &operation,
+        in_file_name,
+        out_file_name
+    );
+
+    if (parallel_version_elapsed_time < 0.0) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (process_rank == 0) {
+        compare_with_serial_version(&operation, in_file_name, out_file_name, parallel_version_elapsed_time);
+    }
+
+    free(custom_kernel);
+    free_fft_plans();
+    free_buffer_pool();
+
     MPI_Finalize();
 }
\ No newline at end of file
@@ -0,0 +1,528 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "image_transformer_api.h"
+#include "../buffer_pool/buffer_pool.h"
+#include "../shared_file_system_bmp_io/shared_file_system_bmp_io.h"
+
+typedef struct {
+    MPI_File file_handle;
+    int height;
+    int width;
+} FileImageContext;
+
+/* Gives the pixel size of the layout and where its red, green and blue bytes are */
+static int pixel_layout_offsets(
+    PixelLayout layout,     /* in */
+    int *red,               /* out */
+    int *green,             /* out */
+    int *blue               /* out */
+) {
+    int blue_first = (layout == BGR_PIXEL_LAYOUT || layout == BGRA_PIXEL_LAYOUT);
+
+    *red = blue_first ? 2 : 0;
+    *green = 1;
+    *blue = blue_first ? 0 : 2;
+
+    return (layout == RGBA_PIXEL_LAYOUT || layout == BGRA_PIXEL_LAYOUT) ? 4 : 3;
+}
+
+/* Tells whether the rows of the buffer are laid out exactly like an array of RGB */
+static int is_packed_RGB(
+    const ImageBuffer *buffer   /* in */
+) {
+    return buffer->layout == RGB_PIXEL_LAYOUT && buffer->stride == (ptrdiff_t)buffer->width * 3;
+}
+
+/* Decodes rows first_row to first_row + rows - 1 of the buffer into data, whose rows are data_pitch pixels apart */
+static void decode_buffer_rows(
+    int number_of_threads,      /* in */
+    const ImageBuffer *buffer,  /* in */
+    int rows,                   /* in */
+    int first_row,              /* in */
+    RGB *data,                  /* out */
+    int data_pitch              /* in */
+) {
+    int red, green, blue;
+    int bytes_per_pixel = pixel_layout_offsets(buffer->layout, &red, &green, &blue);
+    int width = buffer->width;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < rows; y++) {
+        const unsigned char *row = buffer->pixels + (ptrdiff_t)(first_row + y) * buffer->stride;
+        RGB *pixels = data + (size_t)y * data_pitch;
+
+        if (buffer->layout == RGB_PIXEL_LAYOUT) {
+            memcpy(pixels, row, width * sizeof(RGB));
+            continue;
+        }
+        for (int x = 0; x < width; x++) {
+            pixels[x].r = row[x * bytes_per_pixel + red];
+            pixels[x].g = row[x * bytes_per_pixel + green];
+            pixels[x].b = row[x * bytes_per_pixel + blue];
+        }
+    }
+}
+
+/* Encodes the packed rows of data into rows first_row to first_row + rows - 1 of the buffer, leaving any fourth byte alone */
+static void encode_buffer_rows(
+    int number_of_threads,      /* in */
+    const RGB *data,            /* in */
+    int rows,                   /* in */
+    int first_row,              /* in */
+    const ImageBuffer *buffer   /* in */
+) {
+    int red, green, blue;
+    int bytes_per_pixel = pixel_layout_offsets(buffer->layout, &red, &green, &blue);
+    int width = buffer->width;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < rows; y++) {
+        unsigned char *row = buffer->pixels + (ptrdiff_t)(first_row + y) * buffer->stride;
+        const RGB *pixels = data + (size_t)y * width;
+
+        if (buffer->layout == RGB_PIXEL_LAYOUT) {
+            memcpy(row, pixels, width * sizeof(RGB));
+            continue;
+        }
+        for (int x = 0; x < width; x++) {
+            row[x * bytes_per_pixel + red] = pixels[x].r;
+            row[x * bytes_per_pixel + green] = pixels[x].g;
+            row[x * bytes_per_pixel + blue] = pixels[x].b;
+        }
+    }
+}
+
+static int valid_buffer(
+    const ImageBuffer *buffer   /* in */
+) {
+    if (!buffer || !buffer->pixels || buffer->height <= 0 || buffer->width <= 0) {
+        return 0;
+    }
+    if (buffer->layout < RGB_PIXEL_LAYOUT || buffer->layout > BGRA_PIXEL_LAYOUT) {
+        return 0;
+    }
+
+    int red, green, blue;
+    ptrdiff_t row_size = (ptrdiff_t)buffer->width * pixel_layout_offsets(buffer->layout, &red, &green, &blue);
+
+    return buffer->stride >= row_size || -buffer->stride >= row_size;
+}
+
+static int read_file_rows(
+    ImageSource *source,    /* in */
+    RGB *data,              /* out */
+    int rows,               /* in */
+    int first_row           /* in */
+) {
+    FileImageContext *context = (FileImageContext *)source->context;
+    return read_rows_from_BMP_file(&context->file_handle, context->height, context->width, data, rows, first_row);
+}
+
+static void close_file_source(
+    ImageSource *source     /* in / out */
+) {
+    FileImageContext *context = (FileImageContext *)source->context;
+    MPI_File_close(&context->file_handle);
+    free(context);
+}
+
+static int read_memory_rows(
+    ImageSource *source,    /* in */
+    RGB *data,              /* out */
+    int rows,               /* in */
+    int first_row           /* in */
+) {
+    decode_buffer_rows(1, (const ImageBuffer *)source->context, rows, first_row, data, source->width);
+    return 0;
+}
+
+static int read_null_rows(
+    ImageSource *source,    /* in */
+    RGB *data,              /* out */
+    int rows,               /* in */
+    int first_row           /* in */
+) {
+    memset(data, 0, (size_t)rows * source->width * sizeof(RGB));
+    return 0;
+}
+
+static int write_file_rows(
+    ImageSink *sink,        /* in */
+    const RGB *data,        /* in */
+    int rows,               /* in */
+    int first_row           /* in */
+) {
+    FileImageContext *context = (FileImageContext *)sink->context;
+    return write_rows_to_BMP_file(&context->file_handle, context->height, context->width, data, rows, first_row, NULL);
+}
+
+static void close_file_sink(
+    ImageSink *sink         /* in / out */
+) {
+    FileImageContext *context = (FileImageContext *)sink->context;
+    MPI_File_close(&context->file_handle);
+    free(context);
+}
+
+static int write_memory_rows(
+    ImageSink *sink,        /* in */
+    const RGB *data,        /* in */
+    int rows,               /* in */
+    int first_row           /* in */
+) {
+    const ImageBuffer *buffer = (const ImageBuffer *)sink->context;
+    if (first_row < 0 || first_row + rows > buffer->height) {
+        return 1;
+    }
+    encode_buffer_rows(1, data, rows, first_row, buffer);
+    return 0;
+}
+
+static int write_null_rows(
+    ImageSink *sink,        /* in */
+    const RGB *data,        /* in */
+    int rows,               /* in */
+    int first_row           /* in */
+) {
+    return 0;
+}
+
+int open_file_image_source(
+    ImageSource *source,        /* out */
+    const char *file_name,      /* in */
+    MPI_Comm communicator       /* in */
+) {
+    int process_rank;
+    MPI_Comm_rank(communicator, &process_rank);
+
+    FileImageContext *context = (FileImageContext *)malloc(sizeof(FileImageContext));
+    if (!context) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (MPI_File_open(communicator, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &context->file_handle) != MPI_SUCCESS) {
+        free(context);
+        return IMAGE_TRANSFORMER_IO_ERROR;
+    }
+
+    /* Rank 0 checks the header for the communicator, a bad file being an error of the caller's rather than an abort */
+    int header_fields[3] = { 0, 0, 0 };
+    if (process_rank == 0) {
+        BMPLayout layout;
+        header_fields[0] = read_BMP_header_from_BMP_file(&context->file_handle, &header_fields[1], &header_fields[2], &layout);
+    }
+
+    MPI_Bcast(header_fields, 3, MPI_INT, 0, communicator);
+
+    if (header_fields[0]) {
+        MPI_File_close(&context->file_handle);
+        free(context);
+        return IMAGE_TRANSFORMER_IO_ERROR;
+    }
+
+    context->height = header_fields[1];
+    context->width = header_fields[2];
+
+    source->height = context->height;
+    source->width = context->width;
+    source->read_rows = read_file_rows;
+    source->close = close_file_source;
+    source->context = context;
+
+    return IMAGE_TRANSFORMER_SUCCESS;
+}
+
+void open_memory_image_source(
+    ImageSource *source,        /* out */
+    const ImageBuffer *buffer   /* in */
+) {
+    source->height = buffer->height;
+    source->width = buffer->width;
+    source->read_rows = read_memory_rows;
+    source->close = NULL;
+    source->context = (void *)buffer;
+}
+
+void open_null_image_source(
+    ImageSource *source,    /* out */
+    int height,             /* in */
+    int width               /* in */
+) {
+    source->height = height;
+    source->width = width;
+    source->read_rows = read_null_rows;
+    source->close = NULL;
+    source->context = NULL;
+}
+
+int open_file_image_sink(
+    ImageSink *sink,            /* out */
+    const char *file_name,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    MPI_Comm communicator       /* in */
+) {
+    int process_rank;
+    MPI_Comm_rank(communicator, &process_rank);
+
+    FileImageContext *context = (FileImageContext *)malloc(sizeof(FileImageContext));
+    if (!context) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (MPI_File_open(communicator, file_name, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &context->file_handle) != MPI_SUCCESS) {
+        free(context);
+        return IMAGE_TRANSFORMER_IO_ERROR;
+    }
+
+    /* MPI_MODE_CREATE keeps the bytes of an existing file, which may be longer than the new one */
+    int failed = (MPI_File_set_size(context->file_handle, 0) != MPI_SUCCESS);
+
+    context->height = height;
+    context->width = width;
+
+    if (process_rank == 0 && !failed) {
+        failed = write_BMP_header_to_BMP_file(&context->file_handle, height, width, NULL);
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, communicator);
+
+    if (failed) {
+        MPI_File_close(&context->file_handle);
+        free(context);
+        return IMAGE_TRANSFORMER_IO_ERROR;
+    }
+
+    sink->height = height;
+    sink->width = width;
+    sink->write_rows = write_file_rows;
+    sink->close = close_file_sink;
+    sink->context = context;
+
+    return IMAGE_TRANSFORMER_SUCCESS;
+}
+
+void open_memory_image_sink(
+    ImageSink *sink,        /* out */
+    ImageBuffer *buffer     /* in */
+) {
+    sink->height = buffer->height;
+    sink->width = buffer->width;
+    sink->write_rows = write_memory_rows;
+    sink->close = NULL;
+    sink->context = buffer;
+}
+
+void open_null_image_sink(
+    ImageSink *sink         /* out */
+) {
+    sink->height = 0;
+    sink->width = 0;
+    sink->write_rows = write_null_rows;
+    sink->close = NULL;
+    sink->context = NULL;
+}
+
+void close_image_source(
+    ImageSource *source     /* in / out */
+) {
+    if (source->close) {
+        source->close(source);
+    }
+    source->context = NULL;
+}
+
+void close_image_sink(
+    ImageSink *sink         /* in / out */
+) {
+    if (sink->close) {
+        sink->close(sink);
+    }
+    sink->context = NULL;
+}
+
+int transform_image_buffer(
+    int number_of_threads,              /* in */
+    const Operation *operation,         /* in */
+    const ImageBuffer *buffer,          /* in */
+    int first_row,                      /* in */
+    int image_height,                   /* in */
+    MPI_Comm communicator,              /* in */
+    ImageTransformerTimings *timings    /* out */
+) {
+    if (communicator == MPI_COMM_NULL) {
+        communicator = MPI_COMM_SELF;
+    }
+
+    int process_rank;
+    int number_of_processes;
+    MPI_Comm_rank(communicator, &process_rank);
+    MPI_Comm_size(communicator, &number_of_processes);
+
+    int status = IMAGE_TRANSFORMER_SUCCESS;
+    if (!valid_buffer(buffer) || first_row < 0 || first_row + buffer->height > image_height) {
+        status = IMAGE_TRANSFORMER_INVALID_ARGUMENT;
+    } else if (operation->luma_mode != NO_LUMA_MODE || operation_resamples(operation) || operation_number_of_outputs(operation) > 1) {
+        status = IMAGE_TRANSFORMER_UNSUPPORTED;
+    }
+
+    /* Every process checks every strip, so that all of them agree on the status before any halo is exchanged */
+    int strip[3] = { status, first_row, valid_buffer(buffer) ? buffer->height : 0 };
+    int *strips = (int *)malloc(3 * number_of_processes * sizeof(int));
+    if (!strips) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Allgather(strip, 3, MPI_INT, strips, 3, MPI_INT, communicator);
+
+    int padding = operation_padding(operation, image_height);
+    int next_row = 0;
+    status = IMAGE_TRANSFORMER_SUCCESS;
+    for (int i = 0; i < number_of_processes && status == IMAGE_TRANSFORMER_SUCCESS; i++) {
+        if (strips[3 * i] != IMAGE_TRANSFORMER_SUCCESS) {
+            status = strips[3 * i];
+        } else if (strips[3 * i + 1] != next_row) {
+            status = IMAGE_TRANSFORMER_INVALID_ARGUMENT;
+        } else if (number_of_processes > 1 && strips[3 * i + 2] < padding) {
+            status = IMAGE_TRANSFORMER_STRIP_TOO_SHORT;
+        }
+        next_row += strips[3 * i + 2];
+    }
+    if (status == IMAGE_TRANSFORMER_SUCCESS && next_row != image_height) {
+        status = IMAGE_TRANSFORMER_INVALID_ARGUMENT;
+    }
+    free(strips);
+
+    if (status != IMAGE_TRANSFORMER_SUCCESS) {
+        return status;
+    }
+
+    double start = MPI_Wtime();
+
+    int height = buffer->height;
+    int width = buffer->width;
+    int height_with_padding = height + 2 * padding;
+    int width_with_padding = width + 2 * padding;
+
+    RGB *data_with_padding = (RGB *)acquire_image_buffer((size_t)height_with_padding * width_with_padding * sizeof(RGB), width_with_padding * sizeof(RGB), number_of_threads);
+
+    /* The strip is decoded straight into the padded buffer, the zero padding frame being written around it */
+    memset(data_with_padding, 0, (size_t)padding * width_with_padding * sizeof(RGB));
+    memset(data_with_padding + (size_t)(height + padding) * width_with_padding, 0, (size_t)padding * width_with_padding * sizeof(RGB));
+    for (int y = padding; y < height + padding; y++) {
+        memset(data_with_padding + (size_t)y * width_with_padding, 0, padding * sizeof(RGB));
+        memset(data_with_padding + (size_t)y * width_with_padding + padding + width, 0, padding * sizeof(RGB));
+    }
+    decode_buffer_rows(number_of_threads, buffer, height, 0, data_with_padding + (size_t)padding * width_with_padding + padding, width_with_padding);
+
+    exchange_frontiers(process_rank, number_of_processes, data_with_padding, height_with_padding, width_with_padding, padding, communicator);
+
+    if (operation_replicates_borders(operation)) {
+        replicate_border_padding(process_rank, number_of_processes, data_with_padding, height_with_padding, width_with_padding, padding);
+    }
+
+    /* Packed RGB rows are stored into by the operation itself, any other layout goes through a packed strip */
+    RGB *new_data = is_packed_RGB(buffer) ? (RGB *)buffer->pixels : (RGB *)acquire_image_buffer(((size_t)height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+
+    apply_operation(
+        number_of_threads,
+        operation,
+        data_with_padding,
+        height_with_padding,
+        width_with_padding,
+        new_data,
+        height,
+        width,
+        padding,
+        first_row,
+        image_height,
+        communicator
+    );
+
+    if (new_data != (RGB *)buffer->pixels) {
+        encode_buffer_rows(number_of_threads, new_data, height, 0, buffer);
+        release_buffer(new_data);
+    }
+
+    release_buffer(data_with_padding);
+
+    if (timings) {
+        timings->compute_time = MPI_Wtime() - start;
+    }
+
+    return IMAGE_TRANSFORMER_SUCCESS;
+}
+
+int run_image_transformer(
+    int number_of_threads,              /* in */
+    const Operation *operation,         /* in */
+    ImageSource *source,                /* in */
+    ImageSink *sink,                    /* in */
+    MPI_Comm communicator,              /* in */
+    ImageTransformerTimings *timings    /* out */
+) {
+    if (communicator == MPI_COMM_NULL) {
+        communicator = MPI_COMM_SELF;
+    }
+
+    int process_rank;
+    int number_of_processes;
+    MPI_Comm_rank(communicator, &process_rank);
+    MPI_Comm_size(communicator, &number_of_processes);
+
+    int image_height = source->height;
+    int width = source->width;
+
+    if (image_height < number_of_processes || width <= 0) {
+        return (width <= 0) ? IMAGE_TRANSFORMER_INVALID_ARGUMENT : IMAGE_TRANSFORMER_STRIP_TOO_SHORT;
+    }
+
+    /* The rows handed to the sink have the pitch of the source */
+    if ((sink->height != 0 || sink->width != 0) && (sink->height != image_height || sink->width != width)) {
+        return IMAGE_TRANSFORMER_INVALID_ARGUMENT;
+    }
+
+    int height_per_process = image_height / number_of_processes;
+    int rest = image_height % number_of_processes;
+    int local_height = height_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
+
+    RGB *local_data = (RGB *)acquire_image_buffer(((size_t)local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+
+    ImageTransformerTimings local_timings = { 0.0, 0.0, 0.0 };
+
+    double start = MPI_Wtime();
+    int status = source->read_rows(source, local_data, local_height, first_row) ? IMAGE_TRANSFORMER_IO_ERROR : IMAGE_TRANSFORMER_SUCCESS;
+    local_timings.read_time = MPI_Wtime() - start;
+
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MAX, communicator);
+
+    if (status == IMAGE_TRANSFORMER_SUCCESS) {
+        /* The strip is packed RGB, so the operation stores its result in place */
+        ImageBuffer strip = { (unsigned char *)local_data, local_height, width, (ptrdiff_t)width * 3, RGB_PIXEL_LAYOUT };
+        status = transform_image_buffer(number_of_threads, operation, &strip, first_row, image_height, communicator, &local_timings);
+    }
+
+    if (status == IMAGE_TRANSFORMER_SUCCESS) {
+        start = MPI_Wtime();
+        status = sink->write_rows(sink, local_data, local_height, first_row) ? IMAGE_TRANSFORMER_IO_ERROR : IMAGE_TRANSFORMER_SUCCESS;
+        local_timings.write_time = MPI_Wtime() - start;
+
+        MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MAX, communicator);
+    }
+
+    release_buffer(local_data);
+
+    if (timings) {
+        *timings = local_timings;
+    }
+
+    return status;
+}
\ No newline at end of file
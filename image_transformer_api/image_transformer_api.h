@@ -0,0 +1,165 @@
+#ifndef IMAGE_TRANSFORMER_API_H
+#define IMAGE_TRANSFORMER_API_H
+
+#include <stddef.h>
+#include "mpi.h"
+#include "../bmp_image.h"
+#include "../operations/operations.h"
+
+/*
+ * Entry points for programs that embed the transform pipeline instead of running
+ * image_transformer: they work on images held by the caller, in its own pixel
+ * layout, or on pluggable sources and sinks. Nothing here depends on
+ * image_transformer.c, so every other module builds into a library whose
+ * interface is this header, operations.h (parse_operation()) and buffer_pool.h.
+ * MPI must have been initialized by the caller, with at least MPI_THREAD_FUNNELED.
+ * The buffer pool and the cached FFT plans are process-wide and unlocked, so the
+ * calls of a process must come from one thread at a time; each call runs its own
+ * OpenMP team.
+ */
+
+typedef enum {
+    IMAGE_TRANSFORMER_SUCCESS,
+    IMAGE_TRANSFORMER_INVALID_ARGUMENT,     /* bad buffer, or strips not in rank order */
+    IMAGE_TRANSFORMER_UNSUPPORTED,          /* luma modes, resampling and several outputs */
+    IMAGE_TRANSFORMER_STRIP_TOO_SHORT,      /* a strip is thinner than the halo of the operation */
+    IMAGE_TRANSFORMER_IO_ERROR
+} ImageTransformerStatus;
+
+/* Byte order of the pixels of a caller buffer; the fourth byte of 4-byte pixels is left untouched */
+typedef enum {
+    RGB_PIXEL_LAYOUT,   /* the order of RGB */
+    BGR_PIXEL_LAYOUT,   /* the order of 24-bit BMP rows */
+    RGBA_PIXEL_LAYOUT,
+    BGRA_PIXEL_LAYOUT
+} PixelLayout;
+
+/* Pixels owned by the caller, pixels pointing at the top row; a negative stride stores the rows bottom-up */
+typedef struct {
+    unsigned char *pixels;
+    int height;
+    int width;
+    ptrdiff_t stride;   /* bytes from one row to the row below */
+    PixelLayout layout;
+} ImageBuffer;
+
+/* Seconds spent by the calling process in every stage of a run */
+typedef struct {
+    double read_time;
+    double compute_time;    /* halo exchange included */
+    double write_time;
+} ImageTransformerTimings;
+
+typedef struct ImageSource ImageSource;
+typedef struct ImageSink ImageSink;
+
+/* Where a run reads its image from; read_rows() decodes rows first_row to first_row + rows - 1 into data, packed */
+struct ImageSource {
+    int height;
+    int width;
+    int (*read_rows)(ImageSource *source, RGB *data, int rows, int first_row);
+    void (*close)(ImageSource *source);
+    void *context;
+};
+
+/*
+ * Where a run writes its image to; write_rows() stores rows first_row to first_row + rows - 1
+ * of data, packed. The size is the one of the image the sink holds, 0 by 0 taking any size.
+ */
+struct ImageSink {
+    int height;
+    int width;
+    int (*write_rows)(ImageSink *sink, const RGB *data, int rows, int first_row);
+    void (*close)(ImageSink *sink);
+    void *context;
+};
+
+/*
+ * Opens a 24-bit or 32-bit BMP file shared by the processes of the communicator; collective,
+ * every process getting IMAGE_TRANSFORMER_IO_ERROR when the file cannot be opened or is not one
+ */
+int open_file_image_source(
+    ImageSource *source,
+    const char *file_name,
+    MPI_Comm communicator
+);
+
+/* Reads from an image held by the caller, which must outlive the source */
+void open_memory_image_source(
+    ImageSource *source,
+    const ImageBuffer *buffer
+);
+
+/* Produces a black image of the given size without any I/O, for timing the compute alone */
+void open_null_image_source(
+    ImageSource *source,
+    int height,
+    int width
+);
+
+/* Creates or truncates a 24-bit BMP file of the given size, rank 0 writing its header; collective, like open_file_image_source() */
+int open_file_image_sink(
+    ImageSink *sink,
+    const char *file_name,
+    int height,
+    int width,
+    MPI_Comm communicator
+);
+
+/* Writes into an image held by the caller, of the size of the source, which must outlive the sink */
+void open_memory_image_sink(
+    ImageSink *sink,
+    ImageBuffer *buffer
+);
+
+/* Discards every row */
+void open_null_image_sink(
+    ImageSink *sink
+);
+
+/* Releases a source; collective for file sources */
+void close_image_source(
+    ImageSource *source
+);
+
+/* Releases a sink, flushing file sinks; collective for file sinks */
+void close_image_sink(
+    ImageSink *sink
+);
+
+/*
+ * Applies the operation in place to the strip held in buffer, rows first_row to
+ * first_row + buffer->height - 1 of an image of image_height rows. The strips of
+ * the processes of the communicator must follow each other in rank order and
+ * cover the image; MPI_COMM_NULL stands for a process holding the whole image
+ * alone. The strip is decoded once into the padded working buffer, and the
+ * operation stores straight into buffer when it holds packed RGB_PIXEL_LAYOUT
+ * rows (stride of width * 3), through one more strip otherwise. Collective;
+ * every process gets the same status, and timings may be NULL.
+ */
+int transform_image_buffer(
+    int number_of_threads,
+    const Operation *operation,
+    const ImageBuffer *buffer,
+    int first_row,
+    int image_height,
+    MPI_Comm communicator,
+    ImageTransformerTimings *timings
+);
+
+/*
+ * Reads the image from source, every process taking its strip of rows as
+ * image_transformer does, applies the operation and writes the result to sink,
+ * timing the three stages separately. Collective, like transform_image_buffer();
+ * IMAGE_TRANSFORMER_INVALID_ARGUMENT when the sink is not of the size of the source.
+ */
+int run_image_transformer(
+    int number_of_threads,
+    const Operation *operation,
+    ImageSource *source,
+    ImageSink *sink,
+    MPI_Comm communicator,
+    ImageTransformerTimings *timings
+);
+
+#endif
\ No newline at end of file
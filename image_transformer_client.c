@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "job_server/job_server.h"
+
+/* Submits one job to an image_transformer --serve process and prints its reply */
+
+/* Makes a relative path absolute, since the server may run in another directory; returns 1 if it does not fit */
+static int absolute_path(
+    const char *path,           /* in */
+    char *absolute,             /* out */
+    size_t absolute_size        /* in */
+) {
+    char working_directory[MAX_JOB_LENGTH];
+
+    int length;
+    if (path[0] == '/' || !getcwd(working_directory, sizeof(working_directory))) {
+        length = snprintf(absolute, absolute_size, "%s", path);
+    } else {
+        length = snprintf(absolute, absolute_size, "%s/%s", working_directory, path);
+    }
+
+    return (length < 0 || (size_t)length >= absolute_size) ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    char job[MAX_JOB_LENGTH];
+
+    if (argc == 3 && strcmp(argv[2], SHUTDOWN_JOB) == 0) {
+        snprintf(job, sizeof(job), "%s\n", SHUTDOWN_JOB);
+    } else if (argc == 6) {
+        char in_file_name[MAX_JOB_LENGTH / 2];
+        char out_file_name[MAX_JOB_LENGTH / 2];
+        if (absolute_path(argv[4], in_file_name, sizeof(in_file_name))
+            || absolute_path(argv[5], out_file_name, sizeof(out_file_name))
+            || snprintf(job, sizeof(job), "%s\t%s\t%s\t%s\n", argv[2], argv[3], in_file_name, out_file_name) >= (int)sizeof(job)) {
+            fprintf(stderr, "Error: The job is too long\n");
+            return EXIT_FAILURE;
+        }
+    } else {
+        fprintf(stdout, "Usage: %s <socket path> <number of threads> <operation> <input file> <output file>\n", argv[0]);
+        fprintf(stdout, "       %s <socket path> %s\n", argv[0], SHUTDOWN_JOB);
+        return EXIT_FAILURE;
+    }
+
+    struct sockaddr_un address;
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: The socket path %s is too long\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0) {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, argv[1]);
+
+    if (connect(connection, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror(argv[1]);
+        close(connection);
+        return EXIT_FAILURE;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double submit_time = now.tv_sec + now.tv_nsec * 1e-9;
+
+    size_t length = strlen(job);
+    if (write(connection, job, length) != (ssize_t)length) {
+        perror("write");
+        close(connection);
+        return EXIT_FAILURE;
+    }
+
+    char reply[MAX_JOB_LENGTH];
+    size_t received = 0;
+    ssize_t count;
+    while (received < sizeof(reply) - 1 && (count = read(connection, reply + received, sizeof(reply) - 1 - received)) > 0) {
+        received += (size_t)count;
+    }
+    reply[received] = '\0';
+
+    close(connection);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double parallel_time;
+    double job_time;
+    if (sscanf(reply, "OK %lf %lf", &parallel_time, &job_time) == 2) {
+        fprintf(stdout, "Parallel version elapsed time: %f seconds\n", parallel_time);
+        fprintf(stdout, "Job time on the server: %f seconds\n", job_time);
+        fprintf(stdout, "Round trip time: %f seconds\n", now.tv_sec + now.tv_nsec * 1e-9 - submit_time);
+        return EXIT_SUCCESS;
+    }
+
+    fprintf(stdout, "%s", reply);
+
+    return (strncmp(reply, "OK", 2) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "job_server.h"
+
+int open_job_socket(
+    const char *socket_path     /* in */
+) {
+    struct sockaddr_un address;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: The socket path %s is too long\n", socket_path);
+        return -1;
+    }
+
+    /* A socket file left behind by a previous server would make bind() fail, any other file is the user's */
+    struct stat path_status;
+    if (lstat(socket_path, &path_status) == 0) {
+        if (!S_ISSOCK(path_status.st_mode)) {
+            fprintf(stderr, "Error: %s exists and is not a socket\n", socket_path);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+
+    int job_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (job_socket < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    if (bind(job_socket, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(job_socket, 16) < 0) {
+        perror(socket_path);
+        close(job_socket);
+        return -1;
+    }
+
+    return job_socket;
+}
+
+int accept_job(
+    int job_socket,     /* in */
+    char *job,          /* out */
+    size_t job_size     /* in */
+) {
+    int connection = accept(job_socket, NULL, NULL);
+    if (connection < 0) {
+        return -1;
+    }
+
+    /* The other ranks wait for the job, so a client that never ends its line must not hold them */
+    struct timeval timeout = { JOB_RECEIVE_TIMEOUT_SECONDS, 0 };
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    size_t length = 0;
+    while (length < job_size - 1) {
+        ssize_t received = read(connection, job + length, job_size - 1 - length);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            close(connection);
+            return -1;
+        }
+        if (received <= 0) {
+            break;
+        }
+        length += (size_t)received;
+        if (memchr(job + length - received, '\n', (size_t)received)) {
+            break;
+        }
+    }
+    job[length] = '\0';
+
+    char *end_of_line = strchr(job, '\n');
+    if (!end_of_line) {
+        reply_to_job(connection, "ERROR The job must be a single line\n");
+        return -1;
+    }
+    *end_of_line = '\0';
+
+    return connection;
+}
+
+void reply_to_job(
+    int connection,     /* in */
+    const char *reply   /* in */
+) {
+    size_t length = strlen(reply);
+    size_t sent = 0;
+    while (sent < length) {
+        /* A client gone before its reply must not kill the server with SIGPIPE */
+        ssize_t written = send(connection, reply + sent, length - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            break;
+        }
+        sent += (size_t)written;
+    }
+    close(connection);
+}
+
+void close_job_socket(
+    int job_socket,             /* in */
+    const char *socket_path     /* in */
+) {
+    close(job_socket);
+    unlink(socket_path);
+}
+
+int split_job(
+    char *job,                  /* in / out */
+    int *number_of_threads,     /* out */
+    char **operation,           /* out */
+    char **in_file_name,        /* out */
+    char **out_file_name        /* out */
+) {
+    char *fields[4];
+
+    for (int i = 0; i < 4; i++) {
+        fields[i] = job;
+        job = strchr(job, '\t');
+        if (!job && i < 3) {
+            return 1;
+        }
+        if (job) {
+            *job++ = '\0';
+        }
+    }
+    if (job) {
+        return 1;
+    }
+
+    char *end;
+    *number_of_threads = strtol(fields[0], &end, 10);
+    if (end == fields[0] || *end != '\0') {
+        return 1;
+    }
+
+    *operation = fields[1];
+    *in_file_name = fields[2];
+    *out_file_name = fields[3];
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef JOB_SERVER_H
+#define JOB_SERVER_H
+
+#include <stddef.h>
+
+/*
+ * Plumbing of the job server mode. A client connects to a local UNIX socket,
+ * sends one job line "<threads>\t<operation>\t<input file>\t<output file>\n",
+ * or "SHUTDOWN\n", and receives one line back: "OK <parallel seconds> <job
+ * seconds>\n" or "ERROR <message>\n".
+ */
+
+#define MAX_JOB_LENGTH 4096
+
+#define SHUTDOWN_JOB "SHUTDOWN"
+
+/* Longest wait for the rest of a job line, after which the connection is dropped */
+#define JOB_RECEIVE_TIMEOUT_SECONDS 5
+
+/* Creates the listening socket at socket_path, replacing a socket but no other file, returns its descriptor or -1 */
+int open_job_socket(
+    const char *socket_path
+);
+
+/* Waits for a client and reads its job line, returns the connection or -1, dropping clients that time out */
+int accept_job(
+    int job_socket,
+    char *job,
+    size_t job_size
+);
+
+/* Sends the reply line and closes the connection */
+void reply_to_job(
+    int connection,
+    const char *reply
+);
+
+void close_job_socket(
+    int job_socket,
+    const char *socket_path
+);
+
+/* Splits a job line in place into its fields, returns 0 on success */
+int split_job(
+    char *job,
+    int *number_of_threads,
+    char **operation,
+    char **in_file_name,
+    char **out_file_name
+);
+
+#endif
\ No newline at end of file
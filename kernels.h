@@ -1,37 +1,53 @@
 #ifndef KERNELS_H
 #define KERNELS_H
 
-const double RIDGE_KERNEL[9] = {
+static const double IDENTITY_KERNEL[1] = {
+    1.0
+};
+
+static const double RIDGE_KERNEL[9] = {
     0.0, -1.0, 0.0,
     -1.0, 4.0, -1.0,
     0.0, -1.0, 0.0
 };
 
-const double EDGE_KERNEL[9] = {
+static const double EDGE_KERNEL[9] = {
     -1.0, -1.0, -1.0,
     -1.0, 8.0, -1.0,
     -1.0, -1.0, -1.0
 };
 
-const double SHARPEN_KERNEL[9] = {
+static const double SHARPEN_KERNEL[9] = {
     0.0, -1.0, 0.0,
     -1.0, 5.0, -1.0,
     0.0, -1.0, 0.0
 };
 
-const double BOX_BLUR_KERNEL[9] = {
+static const double SOBEL_X_KERNEL[9] = {
+    -1.0, 0.0, 1.0,
+    -2.0, 0.0, 2.0,
+    -1.0, 0.0, 1.0
+};
+
+static const double SOBEL_Y_KERNEL[9] = {
+    -1.0, -2.0, -1.0,
+    0.0, 0.0, 0.0,
+    1.0, 2.0, 1.0
+};
+
+static const double BOX_BLUR_KERNEL[9] = {
     (1.0 / 9.0) * 1.0, (1.0 / 9.0) * 1.0, (1.0 / 9.0) * 1.0,
     (1.0 / 9.0) * 1.0, (1.0 / 9.0) * 1.0, (1.0 / 9.0) * 1.0,
     (1.0 / 9.0) * 1.0, (1.0 / 9.0) * 1.0, (1.0 / 9.0) * 1.0
 };
 
-const double GAUSSIAN_BLUR_3x3_KERNEL[9] = {
+static const double GAUSSIAN_BLUR_3x3_KERNEL[9] = {
     (1.0 / 16.0) * 1.0, (1.0 / 16.0) * 2.0, (1.0 / 16.0) * 1.0,
     (1.0 / 16.0) * 2.0, (1.0 / 16.0) * 4.0, (1.0 / 16.0) * 2.0,
     (1.0 / 16.0) * 1.0, (1.0 / 16.0) * 2.0, (1.0 / 16.0) * 1.0
 };
 
-const double GAUSSIAN_BLUR_5x5_KERNEL[25] = {
+static const double GAUSSIAN_BLUR_5x5_KERNEL[25] = {
     (1.0 / 256.0) * 1.0, (1.0 / 256.0) * 4.0, (1.0 / 256.0) * 6.0, (1.0 / 256.0) * 4.0, (1.0 / 256.0) * 1.0,
     (1.0 / 256.0) * 4.0, (1.0 / 256.0) * 16.0, (1.0 / 256.0) * 24.0, (1.0 / 256.0) * 16.0, (1.0 / 256.0) * 4.0,
     (1.0 / 256.0) * 6.0, (1.0 / 256.0) * 24.0, (1.0 / 256.0) * 36.0, (1.0 / 256.0) * 24.0, (1.0 / 256.0) * 6.0,
@@ -39,7 +55,7 @@ const double GAUSSIAN_BLUR_5x5_KERNEL[25] = {
     (1.0 / 256.0) * 1.0, (1.0 / 256.0) * 4.0, (1.0 / 256.0) * 6.0, (1.0 / 256.0) * 4.0, (1.0 / 256.0) * 1.0
 };
 
-const double UNSHARP_MASKING_5x5_KERNEL[25] = {
+static const double UNSHARP_MASKING_5x5_KERNEL[25] = {
     (-1.0 / 256.0) * 1.0, (-1.0 / 256.0) * 4.0, (-1.0 / 256.0) * 6.0, (-1.0 / 256.0) * 4.0, (-1.0 / 256.0) * 1.0,
     (-1.0 / 256.0) * 4.0, (-1.0 / 256.0) * 16.0, (-1.0 / 256.0) * 24.0, (-1.0 / 256.0) * 16.0, (-1.0 / 256.0) * 4.0,
     (-1.0 / 256.0) * 6.0, (-1.0 / 256.0) * 24.0, (-1.0 / 256.0) * (-476.0), (-1.0 / 256.0) * 24.0, (-1.0 / 256.0) * 6.0,
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "mpi.h"
+#include "line_buffer_convolution.h"
+#include "../shared_file_system_bmp_io/shared_file_system_bmp_io.h"
+#include "../buffer_pool/buffer_pool.h"
+
+/* Bytes of the staging buffers the strip is read and written through */
+#define LINE_BUFFER_STAGING_SIZE (1 << 20)
+
+/* Copies input row row of the strip, which may lie in the halos or in the saved rows, into a ring slot with its zero padding */
+static void load_ring_row(
+    RGB *slot,                  /* out */
+    const RGB *data,            /* in */
+    const RGB *saved_rows,      /* in */
+    int first_saved_row,        /* in */
+    int number_of_saved_rows,   /* in */
+    const RGB *top_halo,        /* in */
+    const RGB *bottom_halo,     /* in */
+    int row,                    /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    int padding                 /* in */
+) {
+    const RGB *source;
+    if (row < 0) {
+        source = top_halo + (row + padding) * width;
+    } else if (row >= height) {
+        source = bottom_halo + (row - height) * width;
+    } else if (row >= first_saved_row && row < first_saved_row + number_of_saved_rows) {
+        source = saved_rows + (row - first_saved_row) * width;
+    } else {
+        source = data + row * width;
+    }
+
+    memset(slot, 0, padding * sizeof(RGB));
+    memcpy(slot + padding, source, width * sizeof(RGB));
+    memset(slot + padding + width, 0, padding * sizeof(RGB));
+}
+
+void line_buffer_convolution(
+    int number_of_threads,      /* in */
+    RGB *data,                  /* in / out */
+    const RGB *top_halo,        /* in */
+    const RGB *bottom_halo,     /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const double *kernel,       /* in */
+    int kernel_size,            /* in */
+    const Epilogue *epilogue    /* in */
+) {
+    int padding = kernel_size / 2;
+    int width_with_padding = width + 2 * padding;
+
+    RGB *rings = (RGB *)acquire_buffer(((size_t)number_of_threads * kernel_size * width_with_padding + 1) * sizeof(RGB));
+    RGB *saved = (RGB *)acquire_buffer(((size_t)number_of_threads * padding * width + 1) * sizeof(RGB));
+
+    #pragma omp parallel num_threads(number_of_threads)
+    {
+        int thread = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+
+        /* Blocks of rows as the static schedule would deal them */
+        int rows_per_thread = height / threads;
+        int rest = height % threads;
+        int first_row = thread * rows_per_thread + ((thread < rest) ? thread : rest);
+        int last_row = first_row + rows_per_thread + ((thread < rest) ? 1 : 0);
+
+        RGB *ring = rings + (size_t)thread * kernel_size * width_with_padding;
+        RGB *saved_rows = saved + (size_t)thread * padding * width;
+
+        /* The rows below the block belong to threads that may overwrite them first */
+        int number_of_saved_rows = (last_row + padding < height) ? padding : height - last_row;
+        memcpy(saved_rows, data + (size_t)last_row * width, number_of_saved_rows * width * sizeof(RGB));
+
+        /* So do the rows above it, which go straight into the ring with the first rows of the block */
+        for (int row = first_row - padding; row < first_row + padding && first_row < last_row; row++) {
+            load_ring_row(
+                ring + ((row + kernel_size) % kernel_size) * width_with_padding,
+                data, saved_rows, last_row, number_of_saved_rows, top_halo, bottom_halo,
+                row, height, width, padding
+            );
+        }
+
+        #pragma omp barrier
+
+        for (int y = first_row; y < last_row; y++) {
+            load_ring_row(
+                ring + ((y + padding) % kernel_size) * width_with_padding,
+                data, saved_rows, last_row, number_of_saved_rows, top_halo, bottom_halo,
+                y + padding, height, width, padding
+            );
+
+            /* Same accumulation order as direct_convolution(), hence the same results */
+            for (int x = 0; x < width; x++) {
+                double accumulator_b = 0.0;
+                double accumulator_g = 0.0;
+                double accumulator_r = 0.0;
+
+                for (int i = 0; i < kernel_size; i++) {
+                    const RGB *ring_row = ring + ((y - padding + i + kernel_size) % kernel_size) * width_with_padding + x;
+                    for (int j = 0; j < kernel_size; j++) {
+                        RGB pixel = ring_row[j];
+                        double kernel_value = kernel[i * kernel_size + j];
+                        accumulator_b += (double)pixel.b * kernel_value;
+                        accumulator_g += (double)pixel.g * kernel_value;
+                        accumulator_r += (double)pixel.r * kernel_value;
+                    }
+                }
+
+                store_pixel(&data[(size_t)y * width + x], accumulator_b, accumulator_g, accumulator_r, epilogue);
+            }
+        }
+    }
+
+    release_buffer(rings);
+    release_buffer(saved);
+}
+
+/* Gets the rows above and below the strip from the neighbouring processes, zero beyond the image */
+static void exchange_halo_rows(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    const RGB *data,            /* in */
+    RGB *top_halo,              /* out */
+    RGB *bottom_halo,           /* out */
+    int local_height,           /* in */
+    int width,                  /* in */
+    int padding                 /* in */
+) {
+    int halo_size = padding * width * sizeof(RGB);
+    MPI_Status status;
+
+    memset(top_halo, 0, halo_size);
+    memset(bottom_halo, 0, halo_size);
+
+    if (process_rank > 0) {
+        MPI_Sendrecv(
+            data, halo_size, MPI_UNSIGNED_CHAR, process_rank - 1, 0,
+            top_halo, halo_size, MPI_UNSIGNED_CHAR, process_rank - 1, 0,
+            MPI_COMM_WORLD, &status
+        );
+    }
+
+    if (process_rank < number_of_processes - 1) {
+        MPI_Sendrecv(
+            data + (local_height - padding) * width, halo_size, MPI_UNSIGNED_CHAR, process_rank + 1, 0,
+            bottom_halo, halo_size, MPI_UNSIGNED_CHAR, process_rank + 1, 0,
+            MPI_COMM_WORLD, &status
+        );
+    }
+}
+
+void process_with_line_buffers(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    const char *in_file_name,       /* in */
+    const char *out_file_name       /* in */
+) {
+    double start_time = MPI_Wtime();
+
+    MPI_File in_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", in_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int height;
+    int width;
+    read_image_height_and_width_from_BMP_file(process_rank, number_of_processes, &in_file_handle, &height, &width);
+
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(&in_file_handle, &layout);
+
+    int height_per_process = height / number_of_processes;
+    int rest = height % number_of_processes;
+    int local_height = height_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
+
+    int padding = operation->kernel_size / 2;
+
+    if (padding > height_per_process) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The %d rows halo is deeper than the %d rows strips, use fewer processes\n", padding, height_per_process);
+            fflush(stdout);
+        }
+        MPI_File_close(&in_file_handle);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int chunk_rows = LINE_BUFFER_STAGING_SIZE / (width * 4 + 3);
+    if (chunk_rows < 1) {
+        chunk_rows = 1;
+    }
+
+    RGB *local_data = (RGB *)acquire_image_buffer(((size_t)local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+    RGB *halos = (RGB *)acquire_buffer(((size_t)2 * padding * width + 1) * sizeof(RGB));
+
+    read_strip_from_BMP_file_in_chunks(process_rank, number_of_processes, &in_file_handle, height, width, local_data, local_height, first_row, chunk_rows);
+    MPI_File_close(&in_file_handle);
+
+    double compute_start_time = MPI_Wtime();
+
+    exchange_halo_rows(process_rank, number_of_processes, local_data, halos, halos + padding * width, local_height, width, padding);
+
+    line_buffer_convolution(
+        number_of_threads,
+        local_data,
+        halos,
+        halos + padding * width,
+        local_height,
+        width,
+        operation->kernel,
+        operation->kernel_size,
+        &operation->epilogue
+    );
+
+    double compute_time = MPI_Wtime() - compute_start_time;
+
+    MPI_File out_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, out_file_name, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &out_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", out_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    write_strip_to_BMP_file_in_chunks(process_rank, number_of_processes, &out_file_handle, height, width, local_data, local_height, first_row, chunk_rows, &layout);
+    MPI_File_close(&out_file_handle);
+
+    release_buffer(local_data);
+    release_buffer(halos);
+
+    /* Strip, halos, staging rows, rings and saved rows of the busiest process */
+    double strip_size = (double)(height_per_process + ((rest > 0) ? 1 : 0)) * width * sizeof(RGB);
+    double other_size = (double)2 * padding * width * sizeof(RGB)
+        + (double)chunk_rows * ((width * 4 + 3) & (~3))
+        + (double)number_of_threads * (operation->kernel_size * (width + 2 * padding) + padding * width) * sizeof(RGB);
+
+    double elapsed_time = MPI_Wtime() - start_time;
+    MPI_Allreduce(MPI_IN_PLACE, &compute_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\nConvolved %dx%d image saved in file %s in %f seconds (%f in the convolution)\n", width, height, out_file_name, elapsed_time, compute_time);
+        fprintf(stdout, "Peak image memory per process: %.1f MiB, of which %.1f MiB for the strip\n", (strip_size + other_size) / (1 << 20), strip_size / (1 << 20));
+        fflush(stdout);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef LINE_BUFFER_CONVOLUTION_H
+#define LINE_BUFFER_CONVOLUTION_H
+
+#include "../bmp_image.h"
+#include "../operations/operations.h"
+
+/*
+ * Direct convolution of a strip in place. Every thread walks a block of rows
+ * with a ring of kernel_size zero padded input rows, so that no padded copy of
+ * the strip nor separate output strip is needed: the output row overwrites the
+ * input row once the ring holds a copy of it, the rows a thread shares with its
+ * neighbours being saved before any thread writes. top_halo and bottom_halo hold
+ * the kernel_size / 2 rows above and below the strip, zero at the image borders.
+ */
+void line_buffer_convolution(
+    int number_of_threads,
+    RGB *data,
+    const RGB *top_halo,
+    const RGB *bottom_halo,
+    int height,
+    int width,
+    const double *kernel,
+    int kernel_size,
+    const Epilogue *epilogue
+);
+
+/*
+ * Runs a convolution from in_file_name to out_file_name keeping about one strip
+ * per process in memory: the strip is read and written through small staging
+ * buffers, only its halo rows are exchanged, and it is convolved in place. The
+ * kernel must be smaller than fft_convolution_crossover_kernel_size(): larger
+ * ones are convolved through the FFT, which this mode does not offer.
+ */
+void process_with_line_buffers(
+    int process_rank,
+    int number_of_processes,
+    int number_of_threads,
+    const Operation *operation,
+    const char *in_file_name,
+    const char *out_file_name
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "luma.h"
+#include "../fft_convolution/fft_convolution.h"
+
+void convert_to_gray_luma(
+    int number_of_threads,          /* in */
+    RGB *data,                      /* in / out */
+    int number_of_pixels,           /* in */
+    unsigned char *chroma_blue,     /* out */
+    unsigned char *chroma_red       /* out */
+) {
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int i = 0; i < number_of_pixels; i++) {
+        if (chroma_blue) {
+            chroma_of_pixel(data[i], &chroma_blue[i], &chroma_red[i]);
+        }
+        unsigned char luma = luma_of_pixel(data[i]);
+        data[i] = (RGB){ luma, luma, luma };
+    }
+}
+
+void store_luma_result(
+    int number_of_threads,              /* in */
+    RGB *data,                          /* in / out */
+    int number_of_pixels,               /* in */
+    const unsigned char *chroma_blue,   /* in */
+    const unsigned char *chroma_red,    /* in */
+    unsigned char *new_luma,            /* out */
+    const Epilogue *epilogue            /* in */
+) {
+    int has_epilogue = epilogue && epilogue->number_of_stages > 0;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int i = 0; i < number_of_pixels; i++) {
+        unsigned char luma = luma_of_pixel(data[i]);
+
+        if (chroma_blue) {
+            pixel_of_luma_and_chroma((double)luma, chroma_blue[i], chroma_red[i], &data[i]);
+            if (has_epilogue) {
+                apply_epilogue(epilogue, &data[i]);
+            }
+            continue;
+        }
+
+        if (has_epilogue) {
+            RGB gray = { luma, luma, luma };
+            apply_epilogue(epilogue, &gray);
+            luma = luma_of_pixel(gray);
+        }
+        data[i] = (RGB){ luma, luma, luma };
+        if (new_luma) {
+            new_luma[i] = luma;
+        }
+    }
+}
+
+void exchange_luma_frontiers(
+    int process_rank,                   /* in */
+    int number_of_processes,            /* in */
+    unsigned char *luma_with_padding,   /* in / out */
+    int height_with_padding,            /* in */
+    int width_with_padding,             /* in */
+    int padding,                        /* in */
+    MPI_Comm communicator               /* in */
+) {
+    unsigned char *top_halo = luma_with_padding;
+    unsigned char *bottom_halo = luma_with_padding + (size_t)(height_with_padding - padding) * width_with_padding;
+
+    unsigned char *top_real = luma_with_padding + (size_t)padding * width_with_padding;
+    unsigned char *bottom_real = luma_with_padding + (size_t)(height_with_padding - 2 * padding) * width_with_padding;
+
+    MPI_Status status;
+
+    if (process_rank > 0) {
+        MPI_Sendrecv(
+            top_real,
+            padding * width_with_padding,
+            MPI_UNSIGNED_CHAR,
+            process_rank - 1,
+            0,
+            top_halo,
+            padding * width_with_padding,
+            MPI_UNSIGNED_CHAR,
+            process_rank - 1,
+            0,
+            communicator,
+            &status
+        );
+    }
+
+    if (process_rank < number_of_processes - 1) {
+        MPI_Sendrecv(
+            bottom_real,
+            padding * width_with_padding,
+            MPI_UNSIGNED_CHAR,
+            process_rank + 1,
+            0,
+            bottom_halo,
+            padding * width_with_padding,
+            MPI_UNSIGNED_CHAR,
+            process_rank + 1,
+            0,
+            communicator,
+            &status
+        );
+    }
+}
+
+void luma_convolution(
+    int number_of_threads,                  /* in */
+    const unsigned char *luma_with_padding, /* in */
+    int height_with_padding,                /* in */
+    int width_with_padding,                 /* in */
+    unsigned char *new_luma,                /* out */
+    int height,                             /* in */
+    int width,                              /* in */
+    const double *kernel,                   /* in */
+    int kernel_size,                        /* in */
+    int padding                             /* in */
+) {
+    if (kernel_size >= fft_convolution_crossover_kernel_size()) {
+        fft_plane_convolution(
+            number_of_threads,
+            luma_with_padding,
+            height_with_padding,
+            width_with_padding,
+            new_luma,
+            height,
+            width,
+            kernel,
+            kernel_size
+        );
+        return;
+    }
+
+    int offset = kernel_size / 2;
+
+    /*
+     * The nonzero taps in the order of direct_convolution(), as offsets from the centre pixel,
+     * so that gray pixels come out the same while zero taps cost nothing, like in the
+     * specialized kernels
+     */
+    long tap_offsets[kernel_size * kernel_size];
+    double tap_values[kernel_size * kernel_size];
+    int number_of_taps = 0;
+
+    for (int i = -offset; i <= offset; i++) {
+        for (int j = -offset; j <= offset; j++) {
+            double kernel_value = kernel[(i + offset) * kernel_size + (j + offset)];
+            if (kernel_value != 0.0) {
+                tap_offsets[number_of_taps] = (long)i * width_with_padding + j;
+                tap_values[number_of_taps] = kernel_value;
+                number_of_taps++;
+            }
+        }
+    }
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(runtime)
+    for (int y = padding; y < height_with_padding - padding; y++) {
+        const unsigned char *row = luma_with_padding + (size_t)y * width_with_padding;
+        unsigned char *new_row = new_luma + (size_t)(y - padding) * width - padding;
+
+        for (int x = padding; x < width_with_padding - padding; x++) {
+            double accumulator = 0.0;
+
+            for (int tap = 0; tap < number_of_taps; tap++) {
+                accumulator += (double)row[x + tap_offsets[tap]] * tap_values[tap];
+            }
+
+            new_row[x] = clamp_to_unsigned_char(accumulator);
+        }
+    }
+}
+
+void apply_epilogue_to_luma(
+    int number_of_threads,          /* in */
+    unsigned char *luma,            /* in / out */
+    int number_of_pixels,           /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    if (!epilogue || epilogue->number_of_stages == 0) {
+        return;
+    }
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int i = 0; i < number_of_pixels; i++) {
+        RGB gray = { luma[i], luma[i], luma[i] };
+        apply_epilogue(epilogue, &gray);
+        luma[i] = luma_of_pixel(gray);
+    }
+}
\ No newline at end of file
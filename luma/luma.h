@@ -0,0 +1,99 @@
+#ifndef LUMA_H
+#define LUMA_H
+
+#include "mpi.h"
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/* Full range BT.601 YCbCr, as used by JPEG */
+
+static inline unsigned char luma_of_pixel(RGB pixel) {
+    return clamp_to_unsigned_char(0.299 * pixel.r + 0.587 * pixel.g + 0.114 * pixel.b + 0.5);
+}
+
+static inline void chroma_of_pixel(
+    RGB pixel,
+    unsigned char *chroma_blue,
+    unsigned char *chroma_red
+) {
+    *chroma_blue = clamp_to_unsigned_char(128.0 - 0.168736 * pixel.r - 0.331264 * pixel.g + 0.5 * pixel.b + 0.5);
+    *chroma_red = clamp_to_unsigned_char(128.0 + 0.5 * pixel.r - 0.418688 * pixel.g - 0.081312 * pixel.b + 0.5);
+}
+
+static inline void pixel_of_luma_and_chroma(
+    double luma,
+    unsigned char chroma_blue,
+    unsigned char chroma_red,
+    RGB *pixel
+) {
+    double blue_difference = (double)chroma_blue - 128.0;
+    double red_difference = (double)chroma_red - 128.0;
+    pixel->r = clamp_to_unsigned_char(luma + 1.402 * red_difference + 0.5);
+    pixel->g = clamp_to_unsigned_char(luma - 0.344136 * blue_difference - 0.714136 * red_difference + 0.5);
+    pixel->b = clamp_to_unsigned_char(luma + 1.772 * blue_difference + 0.5);
+}
+
+/*
+ * Replaces every pixel by the gray of its luma, so that any operation then runs on
+ * the luma plane; the chroma planes are filled unless chroma_blue is NULL
+ */
+void convert_to_gray_luma(
+    int number_of_threads,
+    RGB *data,
+    int number_of_pixels,
+    unsigned char *chroma_blue,
+    unsigned char *chroma_red
+);
+
+/*
+ * Finishes an output computed on gray pixels without its point operations. With
+ * chroma planes the luma is recombined with them and the epilogue runs on the
+ * color pixel; without, the epilogue sees a gray pixel whose luma is kept, both
+ * as gray pixels in data and, unless new_luma is NULL, as a plane.
+ */
+void store_luma_result(
+    int number_of_threads,
+    RGB *data,
+    int number_of_pixels,
+    const unsigned char *chroma_blue,
+    const unsigned char *chroma_red,
+    unsigned char *new_luma,
+    const Epilogue *epilogue
+);
+
+/*
+ * Single plane versions of exchange_frontiers() and convolution() for operations that
+ * only need the luma, so that halos, kernels and stores move one byte per pixel
+ */
+void exchange_luma_frontiers(
+    int process_rank,
+    int number_of_processes,
+    unsigned char *luma_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    int padding,
+    MPI_Comm communicator
+);
+
+void luma_convolution(
+    int number_of_threads,
+    const unsigned char *luma_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    unsigned char *new_luma,
+    int height,
+    int width,
+    const double *kernel,
+    int kernel_size,
+    int padding
+);
+
+/* Runs the epilogue on the gray pixel of every luma value and keeps the luma of the result */
+void apply_epilogue_to_luma(
+    int number_of_threads,
+    unsigned char *luma,
+    int number_of_pixels,
+    const Epilogue *epilogue
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <string.h>
+#include "lz_codec.h"
+
+#define LZ_HASH_BITS 13
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+
+/* Lengths of 15 and more continue in bytes of 255 ended by a smaller one */
+#define LZ_LENGTH_ESCAPE 15
+
+static inline unsigned int read_four_bytes(const unsigned char *bytes) {
+    unsigned int value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline int hash_of_four_bytes(unsigned int value) {
+    return (int)((value * 2654435761u) >> (32 - LZ_HASH_BITS));
+}
+
+static unsigned char *write_length_extension(
+    unsigned char *destination,     /* out */
+    int length                      /* in */
+) {
+    while (length >= 255) {
+        *destination++ = 255;
+        length -= 255;
+    }
+    *destination++ = (unsigned char)length;
+    return destination;
+}
+
+/* Appends one sequence; a match length of 0 marks the last sequence, which has no match */
+static unsigned char *write_sequence(
+    unsigned char *destination,     /* out */
+    const unsigned char *literals,  /* in */
+    int literal_length,             /* in */
+    int match_length,               /* in */
+    int offset                      /* in */
+) {
+    int literal_code = (literal_length < LZ_LENGTH_ESCAPE) ? literal_length : LZ_LENGTH_ESCAPE;
+    int match_code = 0;
+    if (match_length > 0) {
+        match_code = (match_length - LZ_MIN_MATCH < LZ_LENGTH_ESCAPE) ? match_length - LZ_MIN_MATCH : LZ_LENGTH_ESCAPE;
+    }
+
+    *destination++ = (unsigned char)((literal_code << 4) | match_code);
+    if (literal_code == LZ_LENGTH_ESCAPE) {
+        destination = write_length_extension(destination, literal_length - LZ_LENGTH_ESCAPE);
+    }
+
+    memcpy(destination, literals, literal_length);
+    destination += literal_length;
+
+    if (match_length > 0) {
+        *destination++ = (unsigned char)(offset & 255);
+        *destination++ = (unsigned char)(offset >> 8);
+        if (match_code == LZ_LENGTH_ESCAPE) {
+            destination = write_length_extension(destination, match_length - LZ_MIN_MATCH - LZ_LENGTH_ESCAPE);
+        }
+    }
+
+    return destination;
+}
+
+/* Reads the bytes extending a length code of 15, returns 1 when the block ends first */
+static int read_length_extension(
+    const unsigned char **source,       /* in / out */
+    const unsigned char *source_end,    /* in */
+    int *length                         /* in / out */
+) {
+    unsigned char byte;
+    do {
+        if (*source >= source_end) {
+            return 1;
+        }
+        byte = *(*source)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+int lz_compress_bound(
+    int size    /* in */
+) {
+    return size + size / 255 + 16;
+}
+
+int lz_compress(
+    const unsigned char *source,    /* in */
+    int source_size,                /* in */
+    unsigned char *destination      /* out */
+) {
+    int table[1 << LZ_HASH_BITS];
+    for (int i = 0; i < (1 << LZ_HASH_BITS); i++) {
+        table[i] = -1;
+    }
+
+    unsigned char *output = destination;
+    int anchor = 0;
+    int position = 0;
+
+    while (position + LZ_MIN_MATCH <= source_size) {
+        unsigned int prefix = read_four_bytes(source + position);
+        int hash = hash_of_four_bytes(prefix);
+        int candidate = table[hash];
+        table[hash] = position;
+
+        if (candidate < 0 || position - candidate > LZ_MAX_OFFSET || read_four_bytes(source + candidate) != prefix) {
+            position++;
+            continue;
+        }
+
+        int match_length = LZ_MIN_MATCH;
+        while (position + match_length < source_size && source[candidate + match_length] == source[position + match_length]) {
+            match_length++;
+        }
+
+        output = write_sequence(output, source + anchor, position - anchor, match_length, position - candidate);
+        position += match_length;
+        anchor = position;
+    }
+
+    output = write_sequence(output, source + anchor, source_size - anchor, 0, 0);
+
+    return (int)(output - destination);
+}
+
+int lz_decompress(
+    const unsigned char *source,    /* in */
+    int source_size,                /* in */
+    unsigned char *destination,     /* out */
+    int destination_size            /* in */
+) {
+    const unsigned char *source_end = source + source_size;
+    unsigned char *output = destination;
+    unsigned char *output_end = destination + destination_size;
+
+    while (source < source_end) {
+        int token = *source++;
+
+        int literal_length = token >> 4;
+        if (literal_length == LZ_LENGTH_ESCAPE && read_length_extension(&source, source_end, &literal_length)) {
+            return 1;
+        }
+        if (literal_length > source_end - source || literal_length > output_end - output) {
+            return 1;
+        }
+        memcpy(output, source, literal_length);
+        source += literal_length;
+        output += literal_length;
+
+        if (source == source_end) {
+            break;
+        }
+
+        if (source_end - source < 2) {
+            return 1;
+        }
+        int offset = source[0] | (source[1] << 8);
+        source += 2;
+
+        int match_length = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == LZ_LENGTH_ESCAPE && read_length_extension(&source, source_end, &match_length)) {
+            return 1;
+        }
+        if (offset == 0 || offset > output - destination || match_length > output_end - output) {
+            return 1;
+        }
+
+        /* Matches may overlap their own output, which repeats the last offset bytes */
+        const unsigned char *match = output - offset;
+        if (offset >= match_length) {
+            memcpy(output, match, match_length);
+        } else {
+            for (int i = 0; i < match_length; i++) {
+                output[i] = match[i];
+            }
+        }
+        output += match_length;
+    }
+
+    return (output == output_end) ? 0 : 1;
+}
\ No newline at end of file
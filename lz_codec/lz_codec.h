@@ -0,0 +1,32 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+/*
+ * Byte-oriented LZ77 codec in the spirit of LZ4: the compressed block is a list of
+ * sequences, each a token holding two 4-bit lengths, the literals and the 16-bit
+ * offset of a match of at least 4 bytes, and the last sequence carries literals only.
+ * Matches are found through a hash table of 4-byte prefixes, so compressing costs
+ * one lookup per byte and decompressing is a series of copies.
+ */
+
+/* Largest compressed size of size bytes */
+int lz_compress_bound(
+    int size
+);
+
+/* Compresses source_size bytes into destination, which holds lz_compress_bound() bytes; returns the compressed size */
+int lz_compress(
+    const unsigned char *source,
+    int source_size,
+    unsigned char *destination
+);
+
+/* Returns 0 when the block decodes to exactly destination_size bytes, 1 when it is corrupt */
+int lz_decompress(
+    const unsigned char *source,
+    int source_size,
+    unsigned char *destination,
+    int destination_size
+);
+
+#endif
\ No newline at end of file
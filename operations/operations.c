@@ -1,30 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
 #include "mpi.h"
 #include "operations.h"
+#include "../fft_convolution/fft_convolution.h"
+#include "../rank_filters/rank_filters.h"
+#include "../point_operations/point_operations.h"
+#include "../histogram_operations/histogram_operations.h"
+#include "../bilateral_grid/bilateral_grid.h"
+#include "../specialized_kernels/specialized_kernels.h"
+#include "../kernels.h"
+#include "../buffer_pool/buffer_pool.h"
+
+/* Largest window of a fused convolution, i.e. the square of its largest kernel size */
+#define FUSED_CONVOLUTION_MAX_WINDOW (7 * 7)
+
+/* Number of interleaved channel values summed together by one thread in the vertical box blur passes, whole pixels only */
+#define BOX_BLUR_COLUMN_CHUNK 384
+
+/* Number of interleaved channel values combined together by one thread in the vertical morphology passes */
+#define MORPHOLOGY_COLUMN_CHUNK 256
 
 void allocate_local_data(
     int process_rank,           /* in */
     int number_of_processes,    /* in */
+    int number_of_threads,      /* in */
     RGB **initial_local_data,   /* out */
     RGB **new_local_data,       /* out */
     int local_height,           /* in */
     int width                   /* in */
 ) {
-    *initial_local_data = (RGB *)calloc(local_height * width, sizeof(RGB));
-    if (!(*initial_local_data)) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fflush(stderr);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
-
-    *new_local_data = (RGB *)calloc(local_height * width, sizeof(RGB));
-    if (!(*new_local_data)) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fflush(stderr);
-        free(*initial_local_data);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
+    /* The read and the operation overwrite every pixel, so pooled buffers need no zeroing */
+    *initial_local_data = (RGB *)acquire_image_buffer((local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+    *new_local_data = (RGB *)acquire_image_buffer((local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
 }
 
 void scatter_whole_data_into_local_data(
@@ -61,6 +71,7 @@ void scatter_whole_data_into_local_data(
 }
 
 void add_padding_to_data(
+    int number_of_threads,      /* in */
     const RGB *data,            /* in */
     int height,                 /* in */
     int width,                  /* in */
@@ -72,16 +83,55 @@ void add_padding_to_data(
     *height_with_padding = height + (2 * padding);
     *width_with_padding = width + (2 * padding);
 
-    *data_with_padding = (RGB *)calloc((*height_with_padding) * (*width_with_padding), sizeof(RGB));
-    if (!(*data_with_padding)) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fflush(stderr);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
+    *data_with_padding = (RGB *)acquire_image_buffer((*height_with_padding) * (*width_with_padding) * sizeof(RGB), (*width_with_padding) * sizeof(RGB), number_of_threads);
+
+    /* Pooled buffers come back dirty, so the zero padding frame is written explicitly */
+    memset(*data_with_padding, 0, padding * (*width_with_padding) * sizeof(RGB));
+    memset(*data_with_padding + (height + padding) * (*width_with_padding), 0, padding * (*width_with_padding) * sizeof(RGB));
 
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            (*data_with_padding)[(y + padding) * (*width_with_padding) + (x + padding)] = data[y * width + x];
+        RGB *row = *data_with_padding + (y + padding) * (*width_with_padding);
+        memset(row, 0, padding * sizeof(RGB));
+        memcpy(row + padding, data + y * width, width * sizeof(RGB));
+        memset(row + padding + width, 0, padding * sizeof(RGB));
+    }
+}
+
+void replicate_border_padding(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    RGB *data_with_padding,     /* in / out */
+    int height_with_padding,    /* in */
+    int width_with_padding,     /* in */
+    int padding                 /* in */
+) {
+    /* Left and right first, on every row, so that the rows copied upwards and downwards carry their corners */
+    for (int y = 0; y < height_with_padding; y++) {
+        RGB *row = data_with_padding + y * width_with_padding;
+        for (int x = 0; x < padding; x++) {
+            row[x] = row[padding];
+            row[width_with_padding - 1 - x] = row[width_with_padding - 1 - padding];
+        }
+    }
+
+    if (process_rank == 0) {
+        for (int y = 0; y < padding; y++) {
+            memcpy(
+                data_with_padding + y * width_with_padding,
+                data_with_padding + padding * width_with_padding,
+                width_with_padding * sizeof(RGB)
+            );
+        }
+    }
+
+    if (process_rank == number_of_processes - 1) {
+        for (int y = height_with_padding - padding; y < height_with_padding; y++) {
+            memcpy(
+                data_with_padding + y * width_with_padding,
+                data_with_padding + (height_with_padding - padding - 1) * width_with_padding,
+                width_with_padding * sizeof(RGB)
+            );
         }
     }
 }
@@ -92,7 +142,8 @@ void exchange_frontiers(
     RGB *initial_local_data_with_padding,   /* in / out */
     int local_height_with_padding,          /* in */
     int width_with_padding,                 /* in */
-    int padding                             /* in */
+    int padding,                            /* in */
+    MPI_Comm communicator                   /* in */
 ) {
     int top_halo = 0 * width_with_padding;
     int bottom_halo = (local_height_with_padding - padding) * width_with_padding;
@@ -114,7 +165,7 @@ void exchange_frontiers(
             MPI_UNSIGNED_CHAR,
             process_rank - 1,
             0,
-            MPI_COMM_WORLD,
+            communicator,
             &status
         );
     }
@@ -131,13 +182,13 @@ void exchange_frontiers(
             MPI_UNSIGNED_CHAR,
             process_rank + 1,
             0,
-            MPI_COMM_WORLD,
+            communicator,
             &status
         );
     }
 }
 
-void convolution(
+void direct_convolution(
     int number_of_threads,          /* in */
     const RGB *data_with_padding,   /* in */
     int height_with_padding,        /* in */
@@ -147,7 +198,8 @@ void convolution(
     int width,                      /* in */
     const double *kernel,           /* in */
     int kernel_size,                /* in */
-    int padding                     /* in */
+    int padding,                    /* in */
+    const Epilogue *epilogue        /* in */
 ) {
     double accumulator_b;
     double accumulator_g;
@@ -155,9 +207,10 @@ void convolution(
 
     int offset = kernel_size / 2;
 
+    /* The schedule is set by omp_set_schedule(), static unless a tuning profile chose otherwise */
     #pragma omp parallel for num_threads(number_of_threads) \
         private(accumulator_b, accumulator_g, accumulator_r) \
-        schedule(static)
+        schedule(runtime)
     for (int y = padding; y < height_with_padding - padding; y++) {
         for (int x = padding; x < width_with_padding - padding; x++) {
 
@@ -175,19 +228,883 @@ void convolution(
                 }
             }
 
-            if (accumulator_b < 0.0) accumulator_b = 0.0;
-            if (accumulator_b > 255.0) accumulator_b = 255.0;
-            if (accumulator_g < 0.0) accumulator_g = 0.0;
-            if (accumulator_g > 255.0) accumulator_g = 255.0;
-            if (accumulator_r < 0.0) accumulator_r = 0.0;
-            if (accumulator_r > 255.0) accumulator_r = 255.0;
+            store_pixel(
+                &new_data[(y - padding) * width + (x - padding)],
+                accumulator_b,
+                accumulator_g,
+                accumulator_r,
+                epilogue
+            );
+        }
+    }
+}
+
+void convolution(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    const double *kernel,           /* in */
+    int kernel_size,                /* in */
+    int padding,                    /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    SpecializedConvolution specialized_convolution = find_specialized_convolution(kernel, kernel_size);
+
+    if (kernel_size >= fft_convolution_crossover_kernel_size()) {
+        fft_convolution(
+            number_of_threads,
+            data_with_padding,
+            height_with_padding,
+            width_with_padding,
+            new_data,
+            height,
+            width,
+            kernel,
+            kernel_size,
+            padding,
+            epilogue
+        );
+    } else if (specialized_convolution) {
+        specialized_convolution(
+            number_of_threads,
+            data_with_padding,
+            width_with_padding,
+            new_data,
+            height,
+            width,
+            kernel,
+            padding,
+            epilogue
+        );
+    } else {
+        direct_convolution(
+            number_of_threads,
+            data_with_padding,
+            height_with_padding,
+            width_with_padding,
+            new_data,
+            height,
+            width,
+            kernel,
+            kernel_size,
+            padding,
+            epilogue
+        );
+    }
+}
+
+void fused_convolution(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB **new_data,                 /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    const FusedOutput *outputs,     /* in */
+    int number_of_outputs,          /* in */
+    int padding,                    /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    /* Every kernel is centred in a common window, a magnitude output contributing two terms */
+    double weights[2 * MAX_FUSED_OUTPUTS][FUSED_CONVOLUTION_MAX_WINDOW];
+    int number_of_terms = 0;
+    int window_size = 1;
+
+    for (int output = 0; output < number_of_outputs; output++) {
+        if (outputs[output].kernel_size > window_size) {
+            window_size = outputs[output].kernel_size;
+        }
+    }
+
+    for (int output = 0; output < number_of_outputs; output++) {
+        const double *kernels[2] = { outputs[output].kernel, outputs[output].second_kernel };
+        int kernel_size = outputs[output].kernel_size;
+        int shift = (window_size - kernel_size) / 2;
+
+        for (int k = 0; k < 2 && kernels[k]; k++) {
+            memset(weights[number_of_terms], 0, window_size * window_size * sizeof(double));
+            for (int i = 0; i < kernel_size; i++) {
+                for (int j = 0; j < kernel_size; j++) {
+                    weights[number_of_terms][(i + shift) * window_size + (j + shift)] = kernels[k][i * kernel_size + j];
+                }
+            }
+            number_of_terms++;
+        }
+    }
+
+    int offset = window_size / 2;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = padding; y < height_with_padding - padding; y++) {
+        double accumulators[2 * MAX_FUSED_OUTPUTS][3];
+
+        for (int x = padding; x < width_with_padding - padding; x++) {
+            memset(accumulators, 0, number_of_terms * sizeof(accumulators[0]));
+
+            for (int i = -offset; i <= offset; i++) {
+                for (int j = -offset; j <= offset; j++) {
+                    RGB pixel = data_with_padding[(y + i) * width_with_padding + (x + j)];
+                    int position = (i + offset) * window_size + (j + offset);
+                    for (int term = 0; term < number_of_terms; term++) {
+                        double kernel_value = weights[term][position];
+                        accumulators[term][0] += (double)pixel.b * kernel_value;
+                        accumulators[term][1] += (double)pixel.g * kernel_value;
+                        accumulators[term][2] += (double)pixel.r * kernel_value;
+                    }
+                }
+            }
+
+            int term = 0;
+            for (int output = 0; output < number_of_outputs; output++) {
+                double *first = accumulators[term++];
+                if (outputs[output].second_kernel) {
+                    double *second = accumulators[term++];
+                    first[0] = sqrt(first[0] * first[0] + second[0] * second[0]);
+                    first[1] = sqrt(first[1] * first[1] + second[1] * second[1]);
+                    first[2] = sqrt(first[2] * first[2] + second[2] * second[2]);
+                }
+                store_pixel(
+                    &new_data[output][(y - padding) * width + (x - padding)],
+                    first[0],
+                    first[1],
+                    first[2],
+                    epilogue
+                );
+            }
+        }
+    }
+}
+
+void gaussian_box_blur_radii(
+    int radius,     /* in */
+    int *radii      /* out */
+) {
+    /* Box widths whose successive application best matches a Gaussian of sigma = radius / 3 */
+    double sigma = (double)radius / 3.0;
+    double ideal_width = sqrt(12.0 * sigma * sigma / GAUSSIAN_BLUR_PASSES + 1.0);
+
+    int lower_width = (int)floor(ideal_width);
+    if (lower_width % 2 == 0) {
+        lower_width--;
+    }
+    int upper_width = lower_width + 2;
+
+    double ideal_lower_passes = (12.0 * sigma * sigma
+        - GAUSSIAN_BLUR_PASSES * lower_width * lower_width
+        - 4.0 * GAUSSIAN_BLUR_PASSES * lower_width
+        - 3.0 * GAUSSIAN_BLUR_PASSES) / (-4.0 * lower_width - 4.0);
+    int lower_passes = (int)round(ideal_lower_passes);
+
+    for (int i = 0; i < GAUSSIAN_BLUR_PASSES; i++) {
+        int box_width = (i < lower_passes) ? lower_width : upper_width;
+        radii[i] = box_width / 2;
+    }
+}
+
+void box_blur(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    const int *radii,               /* in */
+    int number_of_passes,           /* in */
+    int padding,                    /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    /*
+     * Every pass is a running sum, so the cost per pixel does not depend on the radii.
+     * The sums are kept unnormalized: they stay integers, exact in a double, and the
+     * single division at the end rounds like the direct kernel does.
+     */
+    int total_radius = 0;
+    double divisor = 1.0;
+    for (int pass = 0; pass < number_of_passes; pass++) {
+        total_radius += radii[pass];
+        divisor *= (double)(2 * radii[pass] + 1) * (double)(2 * radii[pass] + 1);
+    }
+
+    /* Padding rows and columns beyond the total radius are never read */
+    int margin = padding - total_radius;
+    int buffer_height = height_with_padding - 2 * margin;
+    int row_length = width * 3;
+
+    double *sums = (double *)malloc(buffer_height * row_length * sizeof(double));
+    double *other_sums = NULL;
+    if (number_of_passes > 1) {
+        other_sums = (double *)malloc(buffer_height * row_length * sizeof(double));
+    }
+    double *row_buffers = (double *)malloc(number_of_threads * 2 * width_with_padding * 3 * sizeof(double));
+    if (!sums || (number_of_passes > 1 && !other_sums) || !row_buffers) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < buffer_height; y++) {
+        double *current = row_buffers + omp_get_thread_num() * 2 * width_with_padding * 3;
+        double *next = current + width_with_padding * 3;
+
+        const unsigned char *row = (const unsigned char *)(data_with_padding + (y + margin) * width_with_padding);
+        for (int c = 3 * margin; c < 3 * (width_with_padding - margin); c++) {
+            current[c] = (double)row[c];
+        }
+
+        int low = margin;
+        int high = width_with_padding - margin;
+
+        for (int pass = 0; pass < number_of_passes; pass++) {
+            int radius = radii[pass];
+
+            double sum_b = 0.0;
+            double sum_g = 0.0;
+            double sum_r = 0.0;
+            for (int x = low; x <= low + 2 * radius; x++) {
+                sum_b += current[x * 3];
+                sum_g += current[x * 3 + 1];
+                sum_r += current[x * 3 + 2];
+            }
+
+            for (int x = low + radius; x < high - radius; x++) {
+                next[x * 3] = sum_b;
+                next[x * 3 + 1] = sum_g;
+                next[x * 3 + 2] = sum_r;
+                if (x + radius + 1 < high) {
+                    sum_b += current[(x + radius + 1) * 3] - current[(x - radius) * 3];
+                    sum_g += current[(x + radius + 1) * 3 + 1] - current[(x - radius) * 3 + 1];
+                    sum_r += current[(x + radius + 1) * 3 + 2] - current[(x - radius) * 3 + 2];
+                }
+            }
+
+            double *swap = current;
+            current = next;
+            next = swap;
+            low += radius;
+            high -= radius;
+        }
 
-            RGB *new_pixel = &new_data[(y - padding) * width + (x - padding)];
-            new_pixel->b = (unsigned char)accumulator_b;
-            new_pixel->g = (unsigned char)accumulator_g;
-            new_pixel->r = (unsigned char)accumulator_r;
+        for (int c = 0; c < row_length; c++) {
+            sums[y * row_length + c] = current[padding * 3 + c];
         }
     }
+
+    int low = 0;
+    int high = buffer_height;
+    int number_of_chunks = (row_length + BOX_BLUR_COLUMN_CHUNK - 1) / BOX_BLUR_COLUMN_CHUNK;
+
+    for (int pass = 0; pass < number_of_passes; pass++) {
+        int radius = radii[pass];
+        int last_pass = (pass == number_of_passes - 1);
+
+        #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+        for (int chunk = 0; chunk < number_of_chunks; chunk++) {
+            int c0 = chunk * BOX_BLUR_COLUMN_CHUNK;
+            int c1 = c0 + BOX_BLUR_COLUMN_CHUNK;
+            if (c1 > row_length) {
+                c1 = row_length;
+            }
+
+            double accumulator[BOX_BLUR_COLUMN_CHUNK];
+            for (int c = c0; c < c1; c++) {
+                accumulator[c - c0] = 0.0;
+            }
+            for (int y = low; y <= low + 2 * radius; y++) {
+                for (int c = c0; c < c1; c++) {
+                    accumulator[c - c0] += sums[y * row_length + c];
+                }
+            }
+
+            for (int y = low + radius; y < high - radius; y++) {
+                if (last_pass) {
+                    unsigned char *new_row = (unsigned char *)(new_data + (y - total_radius) * width);
+                    for (int c = c0; c < c1; c++) {
+                        new_row[c] = (unsigned char)(accumulator[c - c0] / divisor);
+                    }
+                    if (epilogue && epilogue->number_of_stages > 0) {
+                        for (int x = c0 / 3; x < c1 / 3; x++) {
+                            apply_epilogue(epilogue, (RGB *)new_row + x);
+                        }
+                    }
+                } else {
+                    for (int c = c0; c < c1; c++) {
+                        other_sums[y * row_length + c] = accumulator[c - c0];
+                    }
+                }
+                if (y + radius + 1 < high) {
+                    for (int c = c0; c < c1; c++) {
+                        accumulator[c - c0] += sums[(y + radius + 1) * row_length + c] - sums[(y - radius) * row_length + c];
+                    }
+                }
+            }
+        }
+
+        double *swap = sums;
+        sums = other_sums;
+        other_sums = swap;
+        low += radius;
+        high -= radius;
+    }
+
+    free(sums);
+    free(other_sums);
+    free(row_buffers);
+}
+
+/* Region of a padded plane whose values are valid, shrinking with every morphology pass */
+typedef struct {
+    int first_row;
+    int last_row;       /* exclusive */
+    int first_column;
+    int last_column;    /* exclusive */
+} PlaneRegion;
+
+static inline unsigned char morphology_combine(unsigned char a, unsigned char b, int dilate) {
+    if (dilate) {
+        return (a > b) ? a : b;
+    }
+    return (a < b) ? a : b;
+}
+
+/*
+ * One separable erosion or dilation pass with van Herk / Gil-Werman: the line is cut
+ * into blocks of the window length, running minima (maxima) are computed forwards and
+ * backwards within every block and each window is the combination of two of them,
+ * i.e. 3 comparisons per pixel whatever the window length.
+ */
+static void van_herk_gil_werman_pass(
+    int number_of_threads,      /* in */
+    const unsigned char *plane, /* in */
+    unsigned char *temporary,   /* in */
+    unsigned char *new_plane,   /* out */
+    int plane_width,            /* in */
+    PlaneRegion *region,        /* in / out */
+    int left,                   /* in */
+    int right,                  /* in */
+    int up,                     /* in */
+    int down,                   /* in */
+    int dilate,                 /* in */
+    unsigned char *forward,     /* in */
+    unsigned char *backward     /* in */
+) {
+    int row_length = plane_width * 3;
+    int window_width = left + right + 1;
+    int window_height = up + down + 1;
+
+    int first_column = region->first_column;
+    int last_column = region->last_column;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = region->first_row; y < region->last_row; y++) {
+        const unsigned char *row = plane + y * row_length;
+        unsigned char *new_row = temporary + y * row_length;
+        unsigned char *g = forward + omp_get_thread_num() * row_length;
+        unsigned char *h = backward + omp_get_thread_num() * row_length;
+
+        for (int x = first_column; x < last_column; x++) {
+            for (int c = 0; c < 3; c++) {
+                int i = x * 3 + c;
+                g[i] = ((x - first_column) % window_width == 0) ? row[i] : morphology_combine(g[i - 3], row[i], dilate);
+            }
+        }
+        for (int x = last_column - 1; x >= first_column; x--) {
+            for (int c = 0; c < 3; c++) {
+                int i = x * 3 + c;
+                h[i] = (x == last_column - 1 || (x - first_column + 1) % window_width == 0) ? row[i] : morphology_combine(h[i + 3], row[i], dilate);
+            }
+        }
+        for (int x = first_column + left; x < last_column - right; x++) {
+            for (int c = 0; c < 3; c++) {
+                int start = (x - left) * 3 + c;
+                new_row[x * 3 + c] = morphology_combine(h[start], g[start + (window_width - 1) * 3], dilate);
+            }
+        }
+    }
+
+    region->first_column += left;
+    region->last_column -= right;
+
+    int first_row = region->first_row;
+    int last_row = region->last_row;
+    int c0 = region->first_column * 3;
+    int c1 = region->last_column * 3;
+
+    /* Vertically every thread combines whole chunks of columns, row after row, with full-plane buffers */
+    unsigned char *g = forward;
+    unsigned char *h = backward;
+
+    int number_of_chunks = (c1 - c0 + MORPHOLOGY_COLUMN_CHUNK - 1) / MORPHOLOGY_COLUMN_CHUNK;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int chunk = 0; chunk < number_of_chunks; chunk++) {
+        int chunk_first = c0 + chunk * MORPHOLOGY_COLUMN_CHUNK;
+        int chunk_last = chunk_first + MORPHOLOGY_COLUMN_CHUNK;
+        if (chunk_last > c1) {
+            chunk_last = c1;
+        }
+
+        for (int y = first_row; y < last_row; y++) {
+            const unsigned char *row = temporary + y * row_length;
+            unsigned char *g_row = g + y * row_length;
+            if ((y - first_row) % window_height == 0) {
+                memcpy(g_row + chunk_first, row + chunk_first, chunk_last - chunk_first);
+            } else {
+                for (int c = chunk_first; c < chunk_last; c++) {
+                    g_row[c] = morphology_combine(g_row[c - row_length], row[c], dilate);
+                }
+            }
+        }
+
+        for (int y = last_row - 1; y >= first_row; y--) {
+            const unsigned char *row = temporary + y * row_length;
+            unsigned char *h_row = h + y * row_length;
+            if (y == last_row - 1 || (y - first_row + 1) % window_height == 0) {
+                memcpy(h_row + chunk_first, row + chunk_first, chunk_last - chunk_first);
+            } else {
+                for (int c = chunk_first; c < chunk_last; c++) {
+                    h_row[c] = morphology_combine(h_row[c + row_length], row[c], dilate);
+                }
+            }
+        }
+
+        for (int y = first_row + up; y < last_row - down; y++) {
+            const unsigned char *h_row = h + (y - up) * row_length;
+            const unsigned char *g_row = g + (y - up + window_height - 1) * row_length;
+            unsigned char *new_row = new_plane + y * row_length;
+            for (int c = chunk_first; c < chunk_last; c++) {
+                new_row[c] = morphology_combine(h_row[c], g_row[c], dilate);
+            }
+        }
+    }
+
+    region->first_row += up;
+    region->last_row -= down;
+}
+
+void morphology(
+    int number_of_threads,          /* in */
+    MorphologyType type,            /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    int element_width,              /* in */
+    int element_height,             /* in */
+    int padding,                    /* in */
+    int top_is_image_border,        /* in */
+    int bottom_is_image_border,     /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    /* Even sized elements are anchored like odd ones one pixel wider, and reflected for the second pass */
+    int left = (element_width - 1) / 2;
+    int right = element_width / 2;
+    int up = (element_height - 1) / 2;
+    int down = element_height / 2;
+
+    int plane_size = height_with_padding * width_with_padding * 3;
+
+    /* The horizontal passes borrow one row of each buffer per thread */
+    int buffer_rows = (height_with_padding > number_of_threads) ? height_with_padding : number_of_threads;
+
+    unsigned char *temporary = (unsigned char *)malloc(plane_size * sizeof(unsigned char));
+    unsigned char *first_result = (unsigned char *)malloc(plane_size * sizeof(unsigned char));
+    unsigned char *second_result = NULL;
+    unsigned char *forward = (unsigned char *)malloc(buffer_rows * width_with_padding * 3 * sizeof(unsigned char));
+    unsigned char *backward = (unsigned char *)malloc(buffer_rows * width_with_padding * 3 * sizeof(unsigned char));
+    if (type == OPEN_MORPHOLOGY || type == CLOSE_MORPHOLOGY || type == TOPHAT_MORPHOLOGY) {
+        second_result = (unsigned char *)malloc(plane_size * sizeof(unsigned char));
+    }
+    if (!temporary || !first_result || !forward || !backward || (!second_result && type > DILATE_MORPHOLOGY)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    PlaneRegion region = { 0, height_with_padding, 0, width_with_padding };
+
+    /* Opening (and top-hat) erode first, closing dilates first */
+    int dilate_first = (type == DILATE_MORPHOLOGY || type == CLOSE_MORPHOLOGY);
+
+    van_herk_gil_werman_pass(
+        number_of_threads,
+        (const unsigned char *)data_with_padding,
+        temporary,
+        first_result,
+        width_with_padding,
+        &region,
+        left,
+        right,
+        up,
+        down,
+        dilate_first,
+        forward,
+        backward
+    );
+
+    const unsigned char *result = first_result;
+
+    if (second_result) {
+        /* The second pass must see the first one's result replicated past the image borders, not computed there */
+        int row_length = width_with_padding * 3;
+        for (int y = region.first_row; y < region.last_row; y++) {
+            unsigned char *row = first_result + y * row_length;
+            for (int x = region.first_column; x < padding; x++) {
+                memcpy(row + x * 3, row + padding * 3, 3);
+            }
+            for (int x = padding + width; x < region.last_column; x++) {
+                memcpy(row + x * 3, row + (padding + width - 1) * 3, 3);
+            }
+        }
+        if (top_is_image_border) {
+            for (int y = region.first_row; y < padding; y++) {
+                memcpy(first_result + y * row_length, first_result + padding * row_length, row_length);
+            }
+        }
+        if (bottom_is_image_border) {
+            for (int y = padding + height; y < region.last_row; y++) {
+                memcpy(first_result + y * row_length, first_result + (padding + height - 1) * row_length, row_length);
+            }
+        }
+
+        van_herk_gil_werman_pass(
+            number_of_threads,
+            first_result,
+            temporary,
+            second_result,
+            width_with_padding,
+            &region,
+            right,
+            left,
+            down,
+            up,
+            !dilate_first,
+            forward,
+            backward
+        );
+        result = second_result;
+    }
+
+    const unsigned char *original = (const unsigned char *)data_with_padding;
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < height; y++) {
+        const unsigned char *result_row = result + ((y + padding) * width_with_padding + padding) * 3;
+        const unsigned char *original_row = original + ((y + padding) * width_with_padding + padding) * 3;
+        unsigned char *new_row = (unsigned char *)(new_data + y * width);
+        if (type == TOPHAT_MORPHOLOGY) {
+            for (int c = 0; c < width * 3; c++) {
+                new_row[c] = original_row[c] - result_row[c];
+            }
+        } else {
+            memcpy(new_row, result_row, width * 3);
+        }
+        if (epilogue && epilogue->number_of_stages > 0) {
+            for (int x = 0; x < width; x++) {
+                apply_epilogue(epilogue, new_data + y * width + x);
+            }
+        }
+    }
+
+    free(temporary);
+    free(first_result);
+    free(second_result);
+    free(forward);
+    free(backward);
+}
+
+int operation_padding(
+    const Operation *operation, /* in */
+    int image_height            /* in */
+) {
+    int radii[GAUSSIAN_BLUR_PASSES];
+    int reach;
+
+    switch (operation->type) {
+        case BOX_BLUR_OPERATION:
+            return operation->radius;
+        case GAUSSIAN_BLUR_OPERATION:
+            gaussian_box_blur_radii(operation->radius, radii);
+            return radii[0] + radii[1] + radii[2];
+        case RANK_FILTER_OPERATION:
+            return operation->radius;
+        case MORPHOLOGY_OPERATION:
+            reach = (operation->element_width > operation->element_height) ? operation->element_width / 2 : operation->element_height / 2;
+            return (operation->morphology > DILATE_MORPHOLOGY) ? 2 * reach : reach;
+        case BILATERAL_OPERATION:
+            return bilateral_grid_padding(operation->spatial_sigma);
+        case HISTOGRAM_EQUALIZATION_OPERATION:
+        case AUTO_LEVELS_OPERATION:
+        case CLAHE_OPERATION:
+            return 0;
+        case RESIZE_OPERATION:
+            return resampling_padding(operation->filter, image_height, operation->new_height);
+        case FUSED_CONVOLUTION_OPERATION:
+            reach = 0;
+            for (int output = 0; output < operation->number_of_fused_outputs; output++) {
+                if (operation->fused_outputs[output].kernel_size / 2 > reach) {
+                    reach = operation->fused_outputs[output].kernel_size / 2;
+                }
+            }
+            return reach;
+        case PYRAMID_OPERATION:
+            /* Only level 1 is resampled from the input, every further level being built from the one above */
+            return resampling_padding(operation->filter, image_height, pyramid_level_size(image_height, 1));
+        case CONVOLUTION_OPERATION:
+        default:
+            return operation->kernel_size / 2;
+    }
+}
+
+int operation_replicates_borders(
+    const Operation *operation  /* in */
+) {
+    /* Linear filters keep the zero borders the direct kernels have always used */
+    return operation->type == RANK_FILTER_OPERATION || operation->type == MORPHOLOGY_OPERATION;
+}
+
+int operation_resamples(
+    const Operation *operation  /* in */
+) {
+    return operation->type == RESIZE_OPERATION || operation->type == PYRAMID_OPERATION;
+}
+
+int operation_number_of_outputs(
+    const Operation *operation  /* in */
+) {
+    switch (operation->type) {
+        case PYRAMID_OPERATION:
+            return operation->levels;
+        case FUSED_CONVOLUTION_OPERATION:
+            return operation->number_of_fused_outputs;
+        default:
+            return 1;
+    }
+}
+
+void operation_output_file_name(
+    const Operation *operation,     /* in */
+    int output,                     /* in */
+    const char *file_name,          /* in */
+    char *output_file_name,         /* out */
+    size_t output_file_name_size    /* in */
+) {
+    if (operation->type == PYRAMID_OPERATION) {
+        pyramid_level_file_name(file_name, output + 1, output_file_name, output_file_name_size);
+    } else if (operation->type == FUSED_CONVOLUTION_OPERATION && operation->number_of_fused_outputs > 1) {
+        const char *extension = strrchr(file_name, '.');
+        if (!extension || strchr(extension, '/')) {
+            extension = file_name + strlen(file_name);
+        }
+        snprintf(output_file_name, output_file_name_size, "%.*s_%s%s",
+            (int)(extension - file_name), file_name, operation->fused_outputs[output].name, extension);
+    } else {
+        snprintf(output_file_name, output_file_name_size, "%s", file_name);
+    }
+}
+
+void operation_output_size(
+    const Operation *operation, /* in */
+    int output,                 /* in */
+    int image_height,           /* in */
+    int image_width,            /* in */
+    int *new_height,            /* out */
+    int *new_width              /* out */
+) {
+    switch (operation->type) {
+        case RESIZE_OPERATION:
+            *new_height = operation->new_height;
+            *new_width = operation->new_width;
+            break;
+        case PYRAMID_OPERATION:
+            /* Every level halves the one above, rounding up */
+            *new_height = pyramid_level_size(image_height, output + 1);
+            *new_width = pyramid_level_size(image_width, output + 1);
+            break;
+        default:
+            *new_height = image_height;
+            *new_width = image_width;
+            break;
+    }
+}
+
+void apply_operation(
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    int padding,                    /* in */
+    int first_row,                  /* in */
+    int image_height,               /* in */
+    MPI_Comm communicator           /* in */
+) {
+    int radii[GAUSSIAN_BLUR_PASSES];
+
+    switch (operation->type) {
+        case BOX_BLUR_OPERATION:
+            box_blur(
+                number_of_threads,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                new_data,
+                height,
+                width,
+                &operation->radius,
+                1,
+                padding,
+                &operation->epilogue
+            );
+            break;
+        case GAUSSIAN_BLUR_OPERATION:
+            gaussian_box_blur_radii(operation->radius, radii);
+            box_blur(
+                number_of_threads,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                new_data,
+                height,
+                width,
+                radii,
+                GAUSSIAN_BLUR_PASSES,
+                padding,
+                &operation->epilogue
+            );
+            break;
+        case RANK_FILTER_OPERATION:
+            rank_filter(
+                number_of_threads,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                new_data,
+                height,
+                width,
+                operation->radius,
+                operation->percentile,
+                padding,
+                &operation->epilogue
+            );
+            break;
+        case MORPHOLOGY_OPERATION:
+            morphology(
+                number_of_threads,
+                operation->morphology,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                new_data,
+                height,
+                width,
+                operation->element_width,
+                operation->element_height,
+                padding,
+                first_row == 0,
+                first_row + height == image_height,
+                &operation->epilogue
+            );
+            break;
+        case BILATERAL_OPERATION:
+            bilateral_grid_filter(
+                number_of_threads,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                new_data,
+                height,
+                width,
+                operation->spatial_sigma,
+                operation->range_sigma,
+                padding,
+                first_row,
+                image_height,
+                &operation->epilogue
+            );
+            break;
+        case HISTOGRAM_EQUALIZATION_OPERATION:
+            histogram_equalization(
+                number_of_threads,
+                communicator,
+                data_with_padding,
+                new_data,
+                height,
+                width,
+                &operation->epilogue
+            );
+            break;
+        case AUTO_LEVELS_OPERATION:
+            auto_levels(
+                number_of_threads,
+                communicator,
+                data_with_padding,
+                new_data,
+                height,
+                width,
+                operation->clip_limit,
+                &operation->epilogue
+            );
+            break;
+        case CLAHE_OPERATION:
+            contrast_limited_adaptive_histogram_equalization(
+                number_of_threads,
+                communicator,
+                data_with_padding,
+                new_data,
+                height,
+                width,
+                first_row,
+                image_height,
+                operation->tiles,
+                operation->clip_limit,
+                &operation->epilogue
+            );
+            break;
+        case FUSED_CONVOLUTION_OPERATION:
+            /* Only the first output fits in new_data */
+            fused_convolution(
+                number_of_threads,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                &new_data,
+                height,
+                width,
+                operation->fused_outputs,
+                1,
+                padding,
+                &operation->epilogue
+            );
+            break;
+        case CONVOLUTION_OPERATION:
+        default:
+            convolution(
+                number_of_threads,
+                data_with_padding,
+                height_with_padding,
+                width_with_padding,
+                new_data,
+                height,
+                width,
+                operation->kernel,
+                operation->kernel_size,
+                padding,
+                &operation->epilogue
+            );
+            break;
+    }
 }
 
 void gather_local_data_into_whole_data(
@@ -240,4 +1157,349 @@ int equal_results(
         }
     }
     return 1;
+}
+
+/* Allocates the (2 * radius + 1)^2 kernel of a Gaussian of sigma = radius / 3, normalized to a sum of 1 */
+static int sampled_gaussian_kernel(
+    int radius,             /* in */
+    double **kernel,        /* out */
+    int *kernel_size        /* out */
+) {
+    *kernel_size = 2 * radius + 1;
+    *kernel = (double *)malloc((*kernel_size) * (*kernel_size) * sizeof(double));
+    if (!(*kernel)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+
+    double sigma = (double)radius / 3.0;
+    double sum = 0.0;
+
+    for (int y = -radius; y <= radius; y++) {
+        for (int x = -radius; x <= radius; x++) {
+            double weight = exp(-(x * x + y * y) / (2.0 * sigma * sigma));
+            (*kernel)[(y + radius) * (*kernel_size) + (x + radius)] = weight;
+            sum += weight;
+        }
+    }
+
+    for (int i = 0; i < (*kernel_size) * (*kernel_size); i++) {
+        (*kernel)[i] /= sum;
+    }
+
+    return 0;
+}
+
+int load_kernel_from_file(
+    const char *file_name,  /* in */
+    double **kernel,        /* out */
+    int *kernel_size        /* out */
+) {
+    FILE *file = fopen(file_name, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open kernel file %s\n", file_name);
+        return 1;
+    }
+
+    if (fscanf(file, "%d", kernel_size) != 1 || *kernel_size < 1 || *kernel_size % 2 == 0) {
+        fprintf(stderr, "Error: The kernel size in %s must be a positive odd number\n", file_name);
+        fclose(file);
+        return 1;
+    }
+
+    *kernel = (double *)malloc((*kernel_size) * (*kernel_size) * sizeof(double));
+    if (!(*kernel)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fclose(file);
+        return 1;
+    }
+
+    for (int i = 0; i < (*kernel_size) * (*kernel_size); i++) {
+        if (fscanf(file, "%lf", &(*kernel)[i]) != 1) {
+            fprintf(stderr, "Error: Kernel file %s has fewer than %d values\n", file_name, (*kernel_size) * (*kernel_size));
+            fclose(file);
+            free(*kernel);
+            *kernel = NULL;
+            return 1;
+        }
+    }
+
+    fclose(file);
+
+    return 0;
+}
+
+/* Looks up a kernel of kernels.h by name; SOBEL pairs its two kernels into a gradient magnitude */
+static int find_named_kernel(
+    const char *name,       /* in */
+    FusedOutput *output     /* out */
+) {
+    static const FusedOutput named_kernels[] = {
+        { "RIDGE", RIDGE_KERNEL, NULL, 3 },
+        { "EDGE", EDGE_KERNEL, NULL, 3 },
+        { "SHARPEN", SHARPEN_KERNEL, NULL, 3 },
+        { "BOXBLUR", BOX_BLUR_KERNEL, NULL, 3 },
+        { "GAUSSIANBLUR3", GAUSSIAN_BLUR_3x3_KERNEL, NULL, 3 },
+        { "GAUSSIANBLUR5", GAUSSIAN_BLUR_5x5_KERNEL, NULL, 5 },
+        { "UNSHARP5", UNSHARP_MASKING_5x5_KERNEL, NULL, 5 },
+        { "SOBELX", SOBEL_X_KERNEL, NULL, 3 },
+        { "SOBELY", SOBEL_Y_KERNEL, NULL, 3 },
+        { "SOBEL", SOBEL_X_KERNEL, SOBEL_Y_KERNEL, 3 }
+    };
+
+    for (size_t i = 0; i < sizeof(named_kernels) / sizeof(named_kernels[0]); i++) {
+        if (strcmp(name, named_kernels[i].name) == 0) {
+            *output = named_kernels[i];
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int parse_operation(
+    int process_rank,                   /* in */
+    const char *operation_argument,     /* in */
+    Operation *operation,               /* out */
+    double **custom_kernel              /* out */
+) {
+    /* GRAY: and LUMA: run the operation on the luma plane only, e.g. GRAY:EDGE or LUMA:MEDIAN:2 */
+    LumaMode luma_mode = NO_LUMA_MODE;
+    if (strncmp(operation_argument, "GRAY:", 5) == 0) {
+        luma_mode = GRAYSCALE_LUMA_MODE;
+        operation_argument += 5;
+    } else if (strncmp(operation_argument, "LUMA:", 5) == 0) {
+        luma_mode = CHROMA_LUMA_MODE;
+        operation_argument += 5;
+    }
+
+    /* Point operations may follow the operation, e.g. SHARPEN+GAMMA:2.2+SEPIA */
+    char *operation_name = strdup(operation_argument);
+    char *point_operation = strchr(operation_name, '+');
+    if (point_operation) {
+        *point_operation++ = '\0';
+    }
+
+    *operation = (Operation){ .type = CONVOLUTION_OPERATION, .luma_mode = luma_mode };
+    *custom_kernel = NULL;
+
+    if (strchr(operation_name, ',')) {
+        /* Several named kernels evaluated in one pass, e.g. EDGE,SHARPEN,SOBEL */
+        operation->type = FUSED_CONVOLUTION_OPERATION;
+        for (char *kernel_name = strtok(operation_name, ","); kernel_name; kernel_name = strtok(NULL, ",")) {
+            if (operation->number_of_fused_outputs == MAX_FUSED_OUTPUTS
+                    || find_named_kernel(kernel_name, &operation->fused_outputs[operation->number_of_fused_outputs])) {
+                if (process_rank == 0) {
+                    fprintf(stdout, "Error: Fused passes take up to %d of the named kernels, %s is not one of them\n", MAX_FUSED_OUTPUTS, kernel_name);
+                    fflush(stdout);
+                }
+                free(operation_name);
+                return 1;
+            }
+            operation->number_of_fused_outputs++;
+        }
+    } else if (find_named_kernel(operation_name, &operation->fused_outputs[0]) == 0) {
+        if (operation->fused_outputs[0].second_kernel) {
+            operation->type = FUSED_CONVOLUTION_OPERATION;
+            operation->number_of_fused_outputs = 1;
+        } else {
+            operation->kernel = operation->fused_outputs[0].kernel;
+            operation->kernel_size = operation->fused_outputs[0].kernel_size;
+        }
+    } else if (strncmp(operation_name, "KERNEL:", 7) == 0) {
+        if (load_kernel_from_file(operation_name + 7, custom_kernel, &operation->kernel_size)) {
+            fflush(stderr);
+            free(operation_name);
+            return 1;
+        }
+        operation->kernel = *custom_kernel;
+    } else if (strncmp(operation_name, "BOXBLUR:", 8) == 0) {
+        operation->type = BOX_BLUR_OPERATION;
+        operation->radius = strtol(operation_name + 8, NULL, 10);
+    } else if (strncmp(operation_name, "GAUSSIANBLUR:", 13) == 0) {
+        operation->type = GAUSSIAN_BLUR_OPERATION;
+        operation->radius = strtol(operation_name + 13, NULL, 10);
+    } else if (strncmp(operation_name, "MEDIAN:", 7) == 0) {
+        operation->type = RANK_FILTER_OPERATION;
+        operation->radius = strtol(operation_name + 7, NULL, 10);
+        operation->percentile = 50.0;
+    } else if (strncmp(operation_name, "MIN:", 4) == 0) {
+        operation->type = RANK_FILTER_OPERATION;
+        operation->radius = strtol(operation_name + 4, NULL, 10);
+        operation->percentile = 0.0;
+    } else if (strncmp(operation_name, "MAX:", 4) == 0) {
+        operation->type = RANK_FILTER_OPERATION;
+        operation->radius = strtol(operation_name + 4, NULL, 10);
+        operation->percentile = 100.0;
+    } else if (strncmp(operation_name, "PERCENTILE:", 11) == 0) {
+        char *percentile_text;
+        operation->type = RANK_FILTER_OPERATION;
+        operation->radius = strtol(operation_name + 11, &percentile_text, 10);
+        operation->percentile = (*percentile_text == ':') ? strtod(percentile_text + 1, NULL) : -1.0;
+        if (operation->percentile < 0.0 || operation->percentile > 100.0) {
+            if (process_rank == 0) {
+                fprintf(stdout, "Error: Usage is PERCENTILE:<radius>:<percentile between 0 and 100>\n");
+                fflush(stdout);
+            }
+            free(operation_name);
+            return 1;
+        }
+    } else if (strncmp(operation_name, "BILATERAL:", 10) == 0) {
+        char *range_sigma_text;
+        operation->type = BILATERAL_OPERATION;
+        operation->spatial_sigma = strtod(operation_name + 10, &range_sigma_text);
+        operation->range_sigma = (*range_sigma_text == ':') ? strtod(range_sigma_text + 1, NULL) : 25.0;
+        if (operation->spatial_sigma < 1.0 || operation->range_sigma <= 0.0) {
+            if (process_rank == 0) {
+                fprintf(stdout, "Error: Usage is BILATERAL:<spatial sigma of at least 1>[:<range sigma above 0>]\n");
+                fflush(stdout);
+            }
+            free(operation_name);
+            return 1;
+        }
+    } else if (strncmp(operation_name, "ERODE:", 6) == 0 || strncmp(operation_name, "DILATE:", 7) == 0
+            || strncmp(operation_name, "OPEN:", 5) == 0 || strncmp(operation_name, "CLOSE:", 6) == 0
+            || strncmp(operation_name, "TOPHAT:", 7) == 0) {
+        const char *element_text = strchr(operation_name, ':') + 1;
+        char *height_text;
+        operation->type = MORPHOLOGY_OPERATION;
+        operation->morphology = (operation_name[0] == 'E') ? ERODE_MORPHOLOGY
+            : (operation_name[0] == 'D') ? DILATE_MORPHOLOGY
+            : (operation_name[0] == 'O') ? OPEN_MORPHOLOGY
+            : (operation_name[0] == 'C') ? CLOSE_MORPHOLOGY
+            : TOPHAT_MORPHOLOGY;
+        operation->element_width = strtol(element_text, &height_text, 10);
+        operation->element_height = (*height_text == 'x') ? strtol(height_text + 1, NULL, 10) : operation->element_width;
+    } else if (strcmp(operation_name, "HISTEQ") == 0) {
+        operation->type = HISTOGRAM_EQUALIZATION_OPERATION;
+    } else if (strncmp(operation_name, "AUTOLEVELS", 10) == 0 && (operation_name[10] == '\0' || operation_name[10] == ':')) {
+        operation->type = AUTO_LEVELS_OPERATION;
+        operation->clip_limit = (operation_name[10] == ':') ? strtod(operation_name + 11, NULL) : 0.5;
+        /* From half of the values clipped at each end on, the low and high cut-offs cross */
+        if (!(operation->clip_limit >= 0.0 && operation->clip_limit < 50.0)) {
+            if (process_rank == 0) {
+                fprintf(stdout, "Error: Usage is AUTOLEVELS[:<clip percent from 0 to less than 50>]\n");
+                fflush(stdout);
+            }
+            free(operation_name);
+            return 1;
+        }
+    } else if (strncmp(operation_name, "CLAHE", 5) == 0 && (operation_name[5] == '\0' || operation_name[5] == ':')) {
+        char *clip_limit_text = NULL;
+        operation->type = CLAHE_OPERATION;
+        operation->tiles = (operation_name[5] == ':') ? strtol(operation_name + 6, &clip_limit_text, 10) : 8;
+        operation->clip_limit = (clip_limit_text && *clip_limit_text == ':') ? strtod(clip_limit_text + 1, NULL) : 2.0;
+        if (operation->tiles < 1 || operation->tiles > MAX_CLAHE_TILES || operation->clip_limit < 1.0) {
+            if (process_rank == 0) {
+                fprintf(stdout, "Error: Usage is CLAHE[:<tiles per side from 1 to %d>[:<clip limit of at least 1>]]\n", MAX_CLAHE_TILES);
+                fflush(stdout);
+            }
+            free(operation_name);
+            return 1;
+        }
+    } else if (strncmp(operation_name, "RESIZE:", 7) == 0 || strncmp(operation_name, "PYRAMID:", 8) == 0) {
+        char *filter_text;
+        operation->filter = BILINEAR_FILTER;
+        if (operation_name[0] == 'R') {
+            operation->type = RESIZE_OPERATION;
+            operation->new_width = strtol(operation_name + 7, &filter_text, 10);
+            operation->new_height = (*filter_text == ':') ? strtol(filter_text + 1, &filter_text, 10) : 0;
+        } else {
+            operation->type = PYRAMID_OPERATION;
+            operation->levels = strtol(operation_name + 8, &filter_text, 10);
+        }
+        if (operation->new_width < 0 || operation->new_height < 0
+                || (operation->type == RESIZE_OPERATION && (operation->new_width < 1 || operation->new_height < 1))
+                || (operation->type == PYRAMID_OPERATION && (operation->levels < 1 || operation->levels > MAX_PYRAMID_LEVELS))
+                || (*filter_text == ':' && parse_resampling_filter(filter_text + 1, &operation->filter))
+                || (*filter_text != ':' && *filter_text != '\0')) {
+            if (process_rank == 0) {
+                fprintf(stdout, "Error: Usage is RESIZE:<width>:<height>[:<filter>] or PYRAMID:<levels from 1 to %d>[:<filter>], "
+                    "the filter being BILINEAR, BICUBIC or LANCZOS3\n", MAX_PYRAMID_LEVELS);
+                fflush(stdout);
+            }
+            free(operation_name);
+            return 1;
+        }
+    } else if (add_point_operation_to_epilogue(&operation->epilogue, operation_name) == 0) {
+        operation->kernel = IDENTITY_KERNEL;
+        operation->kernel_size = 1;
+    } else {
+        if (process_rank == 0) {
+            fprintf(stdout, "Unknown operation!\n");
+            fflush(stdout);
+        }
+        free(operation_name);
+        return 1;
+    }
+
+    while (point_operation) {
+        char *next_point_operation = strchr(point_operation, '+');
+        if (next_point_operation) {
+            *next_point_operation++ = '\0';
+        }
+        if (add_point_operation_to_epilogue(&operation->epilogue, point_operation)) {
+            if (process_rank == 0) {
+                fprintf(stdout, "Unknown point operation %s!\n", point_operation);
+                fflush(stdout);
+            }
+            free(operation_name);
+            return 1;
+        }
+        point_operation = next_point_operation;
+    }
+
+    if (operation->type == MORPHOLOGY_OPERATION && (operation->element_width < 1 || operation->element_height < 1)) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The structuring element must be at least 1x1\n");
+            fflush(stdout);
+        }
+        free(operation_name);
+        return 1;
+    }
+
+    if ((operation->type == BOX_BLUR_OPERATION || operation->type == GAUSSIAN_BLUR_OPERATION || operation->type == RANK_FILTER_OPERATION)
+            && operation->radius < 1) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The radius must be at least 1\n");
+            fflush(stdout);
+        }
+        free(operation_name);
+        return 1;
+    }
+
+    /* Boxes of width 1 do not blur, so radii too small for 3-wide boxes sample the Gaussian itself */
+    if (operation->type == GAUSSIAN_BLUR_OPERATION) {
+        int radii[GAUSSIAN_BLUR_PASSES];
+        gaussian_box_blur_radii(operation->radius, radii);
+
+        int narrowest_radius = radii[0];
+        for (int i = 1; i < GAUSSIAN_BLUR_PASSES; i++) {
+            narrowest_radius = (radii[i] < narrowest_radius) ? radii[i] : narrowest_radius;
+        }
+
+        if (narrowest_radius < 1) {
+            if (sampled_gaussian_kernel(operation->radius, custom_kernel, &operation->kernel_size)) {
+                fflush(stderr);
+                free(operation_name);
+                return 1;
+            }
+            operation->type = CONVOLUTION_OPERATION;
+            operation->kernel = *custom_kernel;
+        }
+    }
+
+    /* The chroma planes keep the size of the input */
+    if (operation->luma_mode == CHROMA_LUMA_MODE && operation_resamples(operation)) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: LUMA: does not apply to RESIZE and PYRAMID, GRAY: does\n");
+            fflush(stdout);
+        }
+        free(operation_name);
+        return 1;
+    }
+
+    free(operation_name);
+
+    return 0;
 }
\ No newline at end of file
@@ -1,11 +1,87 @@
 #ifndef OPERATIONS_H
 #define OPERATIONS_H
 
+#include "mpi.h"
 #include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+#include "../resampling/resampling.h"
+
+/* Most outputs a single fused convolution pass may produce */
+#define MAX_FUSED_OUTPUTS 8
+
+/* Most images a single run may write, whatever the operation */
+#define MAX_OPERATION_OUTPUTS ((MAX_FUSED_OUTPUTS > MAX_PYRAMID_LEVELS) ? MAX_FUSED_OUTPUTS : MAX_PYRAMID_LEVELS)
+
+/* Number of box passes used to approximate a Gaussian blur */
+#define GAUSSIAN_BLUR_PASSES 3
+
+typedef enum {
+    CONVOLUTION_OPERATION,
+    BOX_BLUR_OPERATION,
+    GAUSSIAN_BLUR_OPERATION,
+    RANK_FILTER_OPERATION,
+    MORPHOLOGY_OPERATION,
+    HISTOGRAM_EQUALIZATION_OPERATION,
+    AUTO_LEVELS_OPERATION,
+    CLAHE_OPERATION,
+    RESIZE_OPERATION,
+    PYRAMID_OPERATION,
+    FUSED_CONVOLUTION_OPERATION,
+    BILATERAL_OPERATION
+} OperationType;
+
+/* Two-pass morphology operations come after DILATE_MORPHOLOGY */
+typedef enum {
+    ERODE_MORPHOLOGY,
+    DILATE_MORPHOLOGY,
+    OPEN_MORPHOLOGY,
+    CLOSE_MORPHOLOGY,
+    TOPHAT_MORPHOLOGY
+} MorphologyType;
+
+/* Operations may run on the luma plane alone, writing it as gray or recombined with the chroma */
+typedef enum {
+    NO_LUMA_MODE,
+    GRAYSCALE_LUMA_MODE,
+    CHROMA_LUMA_MODE
+} LumaMode;
+
+/* One output of a fused convolution pass: a kernel, or the gradient magnitude of a pair of kernels */
+typedef struct {
+    const char *name;               /* suffix of the output file */
+    const double *kernel;
+    const double *second_kernel;    /* NULL unless the output is a gradient magnitude */
+    int kernel_size;
+} FusedOutput;
+
+/* An operation parsed from the command line, applied to every strip the same way */
+typedef struct {
+    OperationType type;
+    const double *kernel;   /* convolution kernel */
+    int kernel_size;        /* convolution kernel size */
+    int radius;             /* blur or rank filter radius */
+    double percentile;      /* rank filter percentile */
+    double spatial_sigma;   /* bilateral filter spatial sigma, in pixels */
+    double range_sigma;     /* bilateral filter range sigma, in luma levels */
+    MorphologyType morphology;
+    int element_width;      /* morphology structuring element width */
+    int element_height;     /* morphology structuring element height */
+    int tiles;              /* CLAHE tiles per image side */
+    double clip_limit;      /* CLAHE clip limit, or auto levels clip percent */
+    int new_width;          /* resize target width */
+    int new_height;         /* resize target height */
+    int levels;             /* pyramid levels below the input */
+    ResamplingFilter filter;
+    FusedOutput fused_outputs[MAX_FUSED_OUTPUTS];
+    int number_of_fused_outputs;
+    LumaMode luma_mode;
+    Epilogue epilogue;      /* point operations fused into the store */
+} Operation;
 
 void allocate_local_data(
     int process_rank,
     int number_of_processes,
+    int number_of_threads,
     RGB **initial_local_data,
     RGB **new_local_data,
     int local_height,
@@ -24,6 +100,7 @@ void scatter_whole_data_into_local_data(
 );
 
 void add_padding_to_data(
+    int number_of_threads,
     const RGB *data,
     int height,
     int width,
@@ -33,15 +110,42 @@ void add_padding_to_data(
     int *width_with_padding
 );
 
+/* Fills the padding on the image borders with copies of the nearest image pixels */
+void replicate_border_padding(
+    int process_rank,
+    int number_of_processes,
+    RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    int padding
+);
+
 void exchange_frontiers(
     int process_rank,
     int number_of_processes,
     RGB *initial_local_data_with_padding,
     int local_height_with_padding,
     int width_with_padding,
-    int padding
+    int padding,
+    MPI_Comm communicator
+);
+
+/* Convolves with the direct O(kernel_size^2) per pixel loop */
+void direct_convolution(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    const double *kernel,
+    int kernel_size,
+    int padding,
+    const Epilogue *epilogue
 );
 
+/* Picks the FFT engine for large kernels, otherwise the specialization of the direct one if there is one */
 void convolution(
     int number_of_threads,
     const RGB *data_with_padding,
@@ -52,7 +156,132 @@ void convolution(
     int width,
     const double *kernel,
     int kernel_size,
-    int padding
+    int padding,
+    const Epilogue *epilogue
+);
+
+/*
+ * Evaluates several kernels in one traversal, every neighborhood being loaded once
+ * for all of them; gradient magnitudes are combined in registers on store
+ */
+void fused_convolution(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB **new_data,
+    int height,
+    int width,
+    const FusedOutput *outputs,
+    int number_of_outputs,
+    int padding,
+    const Epilogue *epilogue
+);
+
+/*
+ * Computes the radii of the box passes approximating a Gaussian blur of the given radius;
+ * parse_operation() samples the Gaussian instead for the radii that give a box of width 1
+ */
+void gaussian_box_blur_radii(
+    int radius,
+    int *radii
+);
+
+/* Applies successive separable box blurs with running sums, in O(1) per pixel whatever the radii */
+void box_blur(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    const int *radii,
+    int number_of_passes,
+    int padding,
+    const Epilogue *epilogue
+);
+
+/* Applies grayscale morphology with a rectangular structuring element to every channel */
+void morphology(
+    int number_of_threads,
+    MorphologyType type,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    int element_width,
+    int element_height,
+    int padding,
+    int top_is_image_border,
+    int bottom_is_image_border,
+    const Epilogue *epilogue
+);
+
+/* Returns the halo depth the operation needs around every strip of an image of image_height rows */
+int operation_padding(
+    const Operation *operation,
+    int image_height
+);
+
+/* Tells whether the operation changes the image size, its outputs then being produced by resample() */
+int operation_resamples(
+    const Operation *operation
+);
+
+/* Returns the number of images the operation writes, one per pyramid level or fused kernel */
+int operation_number_of_outputs(
+    const Operation *operation
+);
+
+/* Computes the size of the given output of the operation for an image_height x image_width input */
+void operation_output_size(
+    const Operation *operation,
+    int output,
+    int image_height,
+    int image_width,
+    int *new_height,
+    int *new_width
+);
+
+/* Tells whether the operation expects replicated rather than zero borders */
+int operation_replicates_borders(
+    const Operation *operation
+);
+
+/*
+ * Builds the file name of the given output: file_name itself for single output operations,
+ * otherwise file_name suffixed with the pyramid level or the name of the fused kernel
+ */
+void operation_output_file_name(
+    const Operation *operation,
+    int output,
+    const char *file_name,
+    char *output_file_name,
+    size_t output_file_name_size
+);
+
+/*
+ * Applies the operation to a strip of height rows starting at row first_row of the image;
+ * operations that need the whole image combine the strips over the communicator.
+ * Resampling operations change the strip size and go through resample() instead,
+ * fused convolutions with several outputs go through fused_convolution().
+ */
+void apply_operation(
+    int number_of_threads,
+    const Operation *operation,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    int padding,
+    int first_row,
+    int image_height,
+    MPI_Comm communicator
 );
 
 void gather_local_data_into_whole_data(
@@ -73,4 +302,23 @@ int equal_results(
     int width
 );
 
+/* Reads a text kernel file: an odd size n followed by n * n row-major coefficients */
+int load_kernel_from_file(
+    const char *file_name,
+    double **kernel,
+    int *kernel_size
+);
+
+/*
+ * Parses an operation argument such as GAUSSIANBLUR:4+GAMMA:2.2 into operation; kernels read
+ * from a file are returned in custom_kernel, to be freed by the caller. Returns 0 on success,
+ * otherwise rank 0 has printed the error.
+ */
+int parse_operation(
+    int process_rank,
+    const char *operation_argument,
+    Operation *operation,
+    double **custom_kernel
+);
+
 #endif
\ No newline at end of file
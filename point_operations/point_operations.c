@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "point_operations.h"
+
+#define MAX_POINT_OPERATION_PARAMETERS 9
+
+typedef double (*ToneCurve)(double value, const double *parameters);
+
+static double gamma_curve(double value, const double *parameters) {
+    return 255.0 * pow(value / 255.0, 1.0 / parameters[0]);
+}
+
+static double brightness_curve(double value, const double *parameters) {
+    return value + parameters[0];
+}
+
+static double contrast_curve(double value, const double *parameters) {
+    return (value - 127.5) * parameters[0] + 127.5;
+}
+
+static double levels_curve(double value, const double *parameters) {
+    double t = (value - parameters[0]) / (parameters[1] - parameters[0]);
+    if (t < 0.0) t = 0.0;
+    if (t > 1.0) t = 1.0;
+    return 255.0 * pow(t, 1.0 / parameters[2]);
+}
+
+static double invert_curve(double value, const double *parameters) {
+    return 255.0 - value;
+}
+
+/* Reads the colon separated parameters following the operation name, returns how many were found */
+static int parse_point_operation_parameters(
+    const char *text,       /* in */
+    double *parameters      /* out */
+) {
+    int number_of_parameters = 0;
+
+    while (*text == ':' && number_of_parameters < MAX_POINT_OPERATION_PARAMETERS) {
+        char *end;
+        parameters[number_of_parameters] = strtod(text + 1, &end);
+        if (end == text + 1) {
+            return -1;
+        }
+        number_of_parameters++;
+        text = end;
+    }
+
+    return (*text == '\0') ? number_of_parameters : -1;
+}
+
+/* Returns the last stage if it has the given type, otherwise appends an identity stage of that type */
+static EpilogueStage *stage_to_extend(
+    Epilogue *epilogue,         /* in / out */
+    EpilogueStageType type      /* in */
+) {
+    if (epilogue->number_of_stages > 0 && epilogue->stages[epilogue->number_of_stages - 1].type == type) {
+        return &epilogue->stages[epilogue->number_of_stages - 1];
+    }
+
+    if (epilogue->number_of_stages == MAX_EPILOGUE_STAGES) {
+        fprintf(stderr, "Error: At most %d alternations of tone operations and color matrices are supported\n", MAX_EPILOGUE_STAGES);
+        return NULL;
+    }
+
+    EpilogueStage *stage = &epilogue->stages[epilogue->number_of_stages++];
+    stage->type = type;
+    for (int channel = 0; channel < 3; channel++) {
+        for (int value = 0; value < 256; value++) {
+            stage->lookup_table[channel][value] = (unsigned char)value;
+        }
+        for (int column = 0; column < 3; column++) {
+            stage->color_matrix[channel][column] = (channel == column) ? 1.0 : 0.0;
+        }
+    }
+
+    return stage;
+}
+
+static int add_tone_curve(
+    Epilogue *epilogue,         /* in / out */
+    ToneCurve curve,            /* in */
+    const double *parameters    /* in */
+) {
+    EpilogueStage *stage = stage_to_extend(epilogue, LOOKUP_TABLE_STAGE);
+    if (!stage) {
+        return 1;
+    }
+
+    for (int channel = 0; channel < 3; channel++) {
+        for (int value = 0; value < 256; value++) {
+            double mapped = curve((double)stage->lookup_table[channel][value], parameters);
+            stage->lookup_table[channel][value] = clamp_to_unsigned_char(mapped + 0.5);
+        }
+    }
+
+    return 0;
+}
+
+static int add_color_matrix(
+    Epilogue *epilogue,         /* in / out */
+    const double *matrix        /* in */
+) {
+    EpilogueStage *stage = stage_to_extend(epilogue, COLOR_MATRIX_STAGE);
+    if (!stage) {
+        return 1;
+    }
+
+    double product[3][3];
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            product[row][column] = 0.0;
+            for (int k = 0; k < 3; k++) {
+                product[row][column] += matrix[row * 3 + k] * stage->color_matrix[k][column];
+            }
+        }
+    }
+    memcpy(stage->color_matrix, product, sizeof(product));
+
+    return 0;
+}
+
+int add_point_operation_to_epilogue(
+    Epilogue *epilogue,             /* in / out */
+    const char *point_operation     /* in */
+) {
+    static const double grayscale_matrix[9] = {
+        0.299, 0.587, 0.114,
+        0.299, 0.587, 0.114,
+        0.299, 0.587, 0.114
+    };
+    static const double sepia_matrix[9] = {
+        0.393, 0.769, 0.189,
+        0.349, 0.686, 0.168,
+        0.272, 0.534, 0.131
+    };
+
+    double parameters[MAX_POINT_OPERATION_PARAMETERS];
+    const char *name_end = strchr(point_operation, ':');
+    size_t name_length = name_end ? (size_t)(name_end - point_operation) : strlen(point_operation);
+    int number_of_parameters = parse_point_operation_parameters(point_operation + name_length, parameters);
+
+    if (name_length == 5 && strncmp(point_operation, "GAMMA", 5) == 0 && number_of_parameters == 1 && parameters[0] > 0.0) {
+        return add_tone_curve(epilogue, gamma_curve, parameters);
+    }
+    if (name_length == 10 && strncmp(point_operation, "BRIGHTNESS", 10) == 0 && number_of_parameters == 1) {
+        return add_tone_curve(epilogue, brightness_curve, parameters);
+    }
+    if (name_length == 8 && strncmp(point_operation, "CONTRAST", 8) == 0 && number_of_parameters == 1) {
+        return add_tone_curve(epilogue, contrast_curve, parameters);
+    }
+    if (name_length == 6 && strncmp(point_operation, "LEVELS", 6) == 0 && (number_of_parameters == 2 || number_of_parameters == 3)) {
+        if (number_of_parameters == 2) {
+            parameters[2] = 1.0;
+        }
+        if (parameters[1] > parameters[0] && parameters[2] > 0.0) {
+            return add_tone_curve(epilogue, levels_curve, parameters);
+        }
+    }
+    if (name_length == 6 && strncmp(point_operation, "INVERT", 6) == 0 && number_of_parameters == 0) {
+        return add_tone_curve(epilogue, invert_curve, parameters);
+    }
+    if (name_length == 9 && strncmp(point_operation, "GRAYSCALE", 9) == 0 && number_of_parameters == 0) {
+        return add_color_matrix(epilogue, grayscale_matrix);
+    }
+    if (name_length == 5 && strncmp(point_operation, "SEPIA", 5) == 0 && number_of_parameters == 0) {
+        return add_color_matrix(epilogue, sepia_matrix);
+    }
+    if (name_length == 11 && strncmp(point_operation, "COLORMATRIX", 11) == 0 && number_of_parameters == 9) {
+        return add_color_matrix(epilogue, parameters);
+    }
+
+    return 1;
+}
\ No newline at end of file
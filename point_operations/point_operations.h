@@ -0,0 +1,83 @@
+#ifndef POINT_OPERATIONS_H
+#define POINT_OPERATIONS_H
+
+#include "../bmp_image.h"
+
+#define MAX_EPILOGUE_STAGES 8
+
+typedef enum {
+    LOOKUP_TABLE_STAGE,
+    COLOR_MATRIX_STAGE
+} EpilogueStageType;
+
+/*
+ * Consecutive tone operations are folded into one stage of per-channel
+ * 256-entry lookup tables and consecutive color matrices into one matrix.
+ */
+typedef struct {
+    EpilogueStageType type;
+    unsigned char lookup_table[3][256];     /* [r, g, b][value] */
+    double color_matrix[3][3];              /* rows give the new r, g, b from the old r, g, b */
+} EpilogueStage;
+
+/* Chain of point operations applied to every pixel as it is stored */
+typedef struct {
+    int number_of_stages;
+    EpilogueStage stages[MAX_EPILOGUE_STAGES];
+} Epilogue;
+
+/*
+ * Appends a point operation to the epilogue. Known operations are GAMMA:<gamma>,
+ * BRIGHTNESS:<offset>, CONTRAST:<factor>, LEVELS:<black>:<white>[:<gamma>], INVERT,
+ * GRAYSCALE, SEPIA and COLORMATRIX:<m00>:<m01>:...:<m22>. Returns 0 on success.
+ */
+int add_point_operation_to_epilogue(
+    Epilogue *epilogue,
+    const char *point_operation
+);
+
+static inline unsigned char clamp_to_unsigned_char(double value) {
+    if (value < 0.0) value = 0.0;
+    if (value > 255.0) value = 255.0;
+    return (unsigned char)value;
+}
+
+static inline void apply_epilogue(
+    const Epilogue *epilogue,
+    RGB *pixel
+) {
+    for (int i = 0; i < epilogue->number_of_stages; i++) {
+        const EpilogueStage *stage = &epilogue->stages[i];
+        if (stage->type == LOOKUP_TABLE_STAGE) {
+            pixel->r = stage->lookup_table[0][pixel->r];
+            pixel->g = stage->lookup_table[1][pixel->g];
+            pixel->b = stage->lookup_table[2][pixel->b];
+        } else {
+            double r = (double)pixel->r;
+            double g = (double)pixel->g;
+            double b = (double)pixel->b;
+            pixel->r = clamp_to_unsigned_char(stage->color_matrix[0][0] * r + stage->color_matrix[0][1] * g + stage->color_matrix[0][2] * b);
+            pixel->g = clamp_to_unsigned_char(stage->color_matrix[1][0] * r + stage->color_matrix[1][1] * g + stage->color_matrix[1][2] * b);
+            pixel->b = clamp_to_unsigned_char(stage->color_matrix[2][0] * r + stage->color_matrix[2][1] * g + stage->color_matrix[2][2] * b);
+        }
+    }
+}
+
+/* Clamps the accumulated channels, stores them and runs the epilogue on the stored pixel */
+static inline void store_pixel(
+    RGB *new_pixel,
+    double accumulator_b,
+    double accumulator_g,
+    double accumulator_r,
+    const Epilogue *epilogue
+) {
+    new_pixel->b = clamp_to_unsigned_char(accumulator_b);
+    new_pixel->g = clamp_to_unsigned_char(accumulator_g);
+    new_pixel->r = clamp_to_unsigned_char(accumulator_r);
+
+    if (epilogue && epilogue->number_of_stages > 0) {
+        apply_epilogue(epilogue, new_pixel);
+    }
+}
+
+#endif
\ No newline at end of file
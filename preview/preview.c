@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "preview.h"
+#include "../shared_file_system_bmp_io/shared_file_system_bmp_io.h"
+#include "../buffer_pool/buffer_pool.h"
+
+/* Divides a length in pixels by the factor, rounding to the nearest and keeping at least one pixel */
+static int scale_length(int length, int factor) {
+    int scaled_length = (length + factor / 2) / factor;
+    return (scaled_length > 0) ? scaled_length : 1;
+}
+
+/* Divides a non-negative tap offset by the factor, rounding to the nearest */
+static int scale_offset(int offset, int factor) {
+    return (offset + factor / 2) / factor;
+}
+
+int scale_operation_for_preview(
+    const Operation *operation,     /* in */
+    int factor,                     /* in */
+    Operation *preview_operation,   /* out */
+    double **scaled_kernel          /* out */
+) {
+    *preview_operation = *operation;
+    *scaled_kernel = NULL;
+
+    if (operation->luma_mode != NO_LUMA_MODE || operation_resamples(operation) || operation_number_of_outputs(operation) > 1) {
+        return 1;
+    }
+
+    switch (operation->type) {
+        case CONVOLUTION_OPERATION: {
+            int offset = operation->kernel_size / 2;
+            int scaled_offset = scale_offset(offset, factor);
+            if (scaled_offset < 1) {
+                break;
+            }
+
+            int scaled_size = 2 * scaled_offset + 1;
+            *scaled_kernel = (double *)calloc(scaled_size * scaled_size, sizeof(double));
+            if (!*scaled_kernel) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                fflush(stderr);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+
+            /* Every tap goes to the scaled tap its offset rounds to, halves away from the centre to keep the symmetry */
+            for (int i = -offset; i <= offset; i++) {
+                int scaled_i = (i < 0) ? -scale_offset(-i, factor) : scale_offset(i, factor);
+                for (int j = -offset; j <= offset; j++) {
+                    int scaled_j = (j < 0) ? -scale_offset(-j, factor) : scale_offset(j, factor);
+                    (*scaled_kernel)[(scaled_i + scaled_offset) * scaled_size + scaled_j + scaled_offset]
+                        += operation->kernel[(i + offset) * operation->kernel_size + j + offset];
+                }
+            }
+
+            preview_operation->kernel = *scaled_kernel;
+            preview_operation->kernel_size = scaled_size;
+            break;
+        }
+        case BOX_BLUR_OPERATION:
+        case GAUSSIAN_BLUR_OPERATION:
+        case RANK_FILTER_OPERATION:
+            preview_operation->radius = scale_length(operation->radius, factor);
+            break;
+        case MORPHOLOGY_OPERATION:
+            preview_operation->element_width = scale_length(operation->element_width, factor);
+            preview_operation->element_height = scale_length(operation->element_height, factor);
+            break;
+        case BILATERAL_OPERATION:
+            preview_operation->spatial_sigma = (operation->spatial_sigma / factor > 1.0) ? operation->spatial_sigma / factor : 1.0;
+            break;
+        default:
+            /* Histogram operations work on the whole image whatever its size */
+            break;
+    }
+
+    return 0;
+}
+
+double process_preview(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    int factor,                     /* in */
+    const char *in_file_name,       /* in */
+    const char *out_file_name       /* in */
+) {
+    double start_time = MPI_Wtime();
+
+    MPI_File in_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", in_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int image_height;
+    int image_width;
+    read_image_height_and_width_from_BMP_file(process_rank, number_of_processes, &in_file_handle, &image_height, &image_width);
+
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(&in_file_handle, &layout);
+
+    int height = (image_height + factor - 1) / factor;
+    int width = (image_width + factor - 1) / factor;
+
+    int height_per_process = height / number_of_processes;
+    int rest = height % number_of_processes;
+    int local_height = height_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
+
+    int padding = operation_padding(operation, height);
+
+    if (padding > height_per_process) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The %d rows halo is deeper than the %d rows strips of the preview, use fewer processes or a smaller factor\n", padding, height_per_process);
+            fflush(stdout);
+        }
+        MPI_File_close(&in_file_handle);
+        return -1.0;
+    }
+
+    RGB *initial_local_data;
+    RGB *new_local_data;
+    allocate_local_data(process_rank, number_of_processes, number_of_threads, &initial_local_data, &new_local_data, local_height, width);
+
+    read_decimated_strip_from_BMP_file(
+        process_rank,
+        number_of_processes,
+        &in_file_handle,
+        image_height,
+        image_width,
+        factor,
+        initial_local_data,
+        local_height,
+        first_row
+    );
+
+    MPI_File_close(&in_file_handle);
+
+    RGB *initial_local_data_with_padding;
+    int local_height_with_padding;
+    int width_with_padding;
+
+    add_padding_to_data(
+        number_of_threads,
+        initial_local_data,
+        local_height,
+        width,
+        padding,
+        &initial_local_data_with_padding,
+        &local_height_with_padding,
+        &width_with_padding
+    );
+
+    exchange_frontiers(
+        process_rank,
+        number_of_processes,
+        initial_local_data_with_padding,
+        local_height_with_padding,
+        width_with_padding,
+        padding,
+        MPI_COMM_WORLD
+    );
+
+    if (operation_replicates_borders(operation)) {
+        replicate_border_padding(
+            process_rank,
+            number_of_processes,
+            initial_local_data_with_padding,
+            local_height_with_padding,
+            width_with_padding,
+            padding
+        );
+    }
+
+    apply_operation(
+        number_of_threads,
+        operation,
+        initial_local_data_with_padding,
+        local_height_with_padding,
+        width_with_padding,
+        new_local_data,
+        local_height,
+        width,
+        padding,
+        first_row,
+        height,
+        MPI_COMM_WORLD
+    );
+
+    MPI_File out_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, out_file_name, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &out_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", out_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    write_strip_to_BMP_file(process_rank, number_of_processes, &out_file_handle, height, width, new_local_data, local_height, first_row, &layout);
+
+    MPI_File_close(&out_file_handle);
+
+    release_buffer(initial_local_data);
+    release_buffer(initial_local_data_with_padding);
+    release_buffer(new_local_data);
+
+    double elapsed_time = MPI_Wtime() - start_time;
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\n%dx%d preview of the %dx%d image saved in file %s in %f seconds\n", width, height, image_width, image_height, out_file_name, elapsed_time);
+        fflush(stdout);
+    }
+
+    return elapsed_time;
+}
\ No newline at end of file
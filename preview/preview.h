@@ -0,0 +1,38 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "../operations/operations.h"
+
+/*
+ * Scales the operation down to an image decimated by factor: radii, structuring
+ * elements and the bilateral spatial sigma shrink with the image, and kernels
+ * wider than three taps after scaling are box-summed into a kernel of the
+ * scaled size, keeping their gain; smaller kernels are kept as they are. The
+ * scaled kernel, if any, is returned in scaled_kernel for the caller to free.
+ * Returns 1 for operations the preview does not cover: luma modes, resampling
+ * operations and operations with several outputs.
+ */
+int scale_operation_for_preview(
+    const Operation *operation,
+    int factor,
+    Operation *preview_operation,
+    double **scaled_kernel
+);
+
+/*
+ * Writes to out_file_name a preview of the operation on the image decimated by
+ * factor, every process reading its decimated rows straight from the input
+ * through a strided file view; returns the elapsed time on rank 0, or a negative
+ * value when the decimated image cannot be split among the processes
+ */
+double process_preview(
+    int process_rank,
+    int number_of_processes,
+    int number_of_threads,
+    const Operation *operation,
+    int factor,
+    const char *in_file_name,
+    const char *out_file_name
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "rank_filters.h"
+
+/* Output columns of one work item; its column histograms then stay within the L2 cache */
+#define RANK_FILTER_TILE_WIDTH 256
+
+/* Minimum output rows of one work item, so that building its column histograms stays cheap */
+#define RANK_FILTER_MIN_BLOCK_ROWS 64
+
+#define FINE_BINS 256
+#define COARSE_BINS 16
+#define FINE_BINS_PER_COARSE_BIN (FINE_BINS / COARSE_BINS)
+
+/*
+ * Histograms of one work item, one set per channel. Every column keeps a fine
+ * 256-bin and a coarse 16-bin histogram, each of them contiguous. The kernel
+ * histogram is updated at coarse level for every pixel, while each of its fine
+ * segments is brought up to date only when a query lands in it (Perreault-Hebert).
+ */
+typedef struct {
+    unsigned short *column_fine;    /* [channel][column][FINE_BINS] */
+    unsigned short *column_coarse;  /* [channel][column][COARSE_BINS] */
+    unsigned int kernel_coarse[3][COARSE_BINS];
+    unsigned int kernel_fine[3][COARSE_BINS][FINE_BINS_PER_COARSE_BIN];
+    int fine_updated_at[3][COARSE_BINS];
+} RankFilterHistograms;
+
+static void update_column_histograms(
+    RankFilterHistograms *histograms,   /* in / out */
+    int number_of_columns,              /* in */
+    const RGB *row,                     /* in */
+    int increment                       /* in */
+) {
+    for (int channel = 0; channel < 3; channel++) {
+        unsigned short *fine = histograms->column_fine + channel * number_of_columns * FINE_BINS;
+        unsigned short *coarse = histograms->column_coarse + channel * number_of_columns * COARSE_BINS;
+        for (int column = 0; column < number_of_columns; column++) {
+            unsigned char value = ((const unsigned char *)&row[column])[channel];
+            fine[column * FINE_BINS + value] += increment;
+            coarse[column * COARSE_BINS + value / FINE_BINS_PER_COARSE_BIN] += increment;
+        }
+    }
+}
+
+/* Returns the value of the given rank in the kernel histogram of one channel, the window starting at column first_column */
+static unsigned char kernel_histogram_rank(
+    RankFilterHistograms *histograms,   /* in / out */
+    int channel,                        /* in */
+    int number_of_columns,              /* in */
+    int first_column,                   /* in */
+    int window_size,                    /* in */
+    unsigned int rank                   /* in */
+) {
+    const unsigned short *column_fine = histograms->column_fine + channel * number_of_columns * FINE_BINS;
+
+    int coarse_bin = 0;
+    unsigned int below = 0;
+    while (below + histograms->kernel_coarse[channel][coarse_bin] <= rank) {
+        below += histograms->kernel_coarse[channel][coarse_bin];
+        coarse_bin++;
+    }
+
+    unsigned int *fine = histograms->kernel_fine[channel][coarse_bin];
+    int updated_at = histograms->fine_updated_at[channel][coarse_bin];
+    int offset = coarse_bin * FINE_BINS_PER_COARSE_BIN;
+
+    if (updated_at < 0 || first_column - updated_at >= window_size) {
+        memset(fine, 0, FINE_BINS_PER_COARSE_BIN * sizeof(unsigned int));
+        for (int column = first_column; column < first_column + window_size; column++) {
+            for (int bin = 0; bin < FINE_BINS_PER_COARSE_BIN; bin++) {
+                fine[bin] += column_fine[column * FINE_BINS + offset + bin];
+            }
+        }
+    } else {
+        for (int start = updated_at + 1; start <= first_column; start++) {
+            const unsigned short *entering = column_fine + (start + window_size - 1) * FINE_BINS + offset;
+            const unsigned short *leaving = column_fine + (start - 1) * FINE_BINS + offset;
+            for (int bin = 0; bin < FINE_BINS_PER_COARSE_BIN; bin++) {
+                fine[bin] += entering[bin] - leaving[bin];
+            }
+        }
+    }
+    histograms->fine_updated_at[channel][coarse_bin] = first_column;
+
+    int bin = 0;
+    while (below + fine[bin] <= rank) {
+        below += fine[bin];
+        bin++;
+    }
+
+    return (unsigned char)(offset + bin);
+}
+
+void rank_filter(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int height_with_padding,        /* in */
+    int width_with_padding,         /* in */
+    RGB *new_data,                  /* in / out */
+    int height,                     /* in */
+    int width,                      /* in */
+    int radius,                     /* in */
+    double percentile,              /* in */
+    int padding,                    /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    int window_size = 2 * radius + 1;
+    unsigned int rank = (unsigned int)lround(percentile / 100.0 * (double)(window_size * window_size - 1));
+
+    int block_rows = 4 * window_size;
+    if (block_rows < RANK_FILTER_MIN_BLOCK_ROWS) {
+        block_rows = RANK_FILTER_MIN_BLOCK_ROWS;
+    }
+
+    int number_of_row_blocks = (height + block_rows - 1) / block_rows;
+    int number_of_column_tiles = (width + RANK_FILTER_TILE_WIDTH - 1) / RANK_FILTER_TILE_WIDTH;
+    int number_of_work_items = number_of_row_blocks * number_of_column_tiles;
+
+    int max_columns = RANK_FILTER_TILE_WIDTH + 2 * radius;
+
+    RankFilterHistograms *histograms = (RankFilterHistograms *)malloc(number_of_threads * sizeof(RankFilterHistograms));
+    unsigned short *column_fine = (unsigned short *)malloc(number_of_threads * 3 * max_columns * FINE_BINS * sizeof(unsigned short));
+    unsigned short *column_coarse = (unsigned short *)malloc(number_of_threads * 3 * max_columns * COARSE_BINS * sizeof(unsigned short));
+    if (!histograms || !column_fine || !column_coarse) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    for (int thread = 0; thread < number_of_threads; thread++) {
+        histograms[thread].column_fine = column_fine + thread * 3 * max_columns * FINE_BINS;
+        histograms[thread].column_coarse = column_coarse + thread * 3 * max_columns * COARSE_BINS;
+    }
+
+    /* The cost of a work item depends on the content, hence the dynamic schedule */
+    #pragma omp parallel for num_threads(number_of_threads) schedule(dynamic, 1)
+    for (int item = 0; item < number_of_work_items; item++) {
+        RankFilterHistograms *thread_histograms = &histograms[omp_get_thread_num()];
+
+        int y0 = (item / number_of_column_tiles) * block_rows;
+        int y1 = y0 + block_rows;
+        if (y1 > height) {
+            y1 = height;
+        }
+        int x0 = (item % number_of_column_tiles) * RANK_FILTER_TILE_WIDTH;
+        int x1 = x0 + RANK_FILTER_TILE_WIDTH;
+        if (x1 > width) {
+            x1 = width;
+        }
+
+        /* Column histograms cover padded columns x0 + padding - radius to x1 + padding + radius */
+        int number_of_columns = (x1 - x0) + 2 * radius;
+        int first_padded_column = x0 + padding - radius;
+
+        memset(thread_histograms->column_fine, 0, 3 * number_of_columns * FINE_BINS * sizeof(unsigned short));
+        memset(thread_histograms->column_coarse, 0, 3 * number_of_columns * COARSE_BINS * sizeof(unsigned short));
+
+        for (int y = y0 + padding - radius; y <= y0 + padding + radius; y++) {
+            update_column_histograms(thread_histograms, number_of_columns, data_with_padding + y * width_with_padding + first_padded_column, 1);
+        }
+
+        for (int y = y0; y < y1; y++) {
+            if (y > y0) {
+                update_column_histograms(thread_histograms, number_of_columns, data_with_padding + (y - 1 + padding - radius) * width_with_padding + first_padded_column, -1);
+                update_column_histograms(thread_histograms, number_of_columns, data_with_padding + (y + padding + radius) * width_with_padding + first_padded_column, 1);
+            }
+
+            for (int channel = 0; channel < 3; channel++) {
+                const unsigned short *coarse = thread_histograms->column_coarse + channel * number_of_columns * COARSE_BINS;
+                unsigned int *kernel_coarse = thread_histograms->kernel_coarse[channel];
+
+                memset(kernel_coarse, 0, COARSE_BINS * sizeof(unsigned int));
+                for (int column = 0; column < window_size; column++) {
+                    for (int bin = 0; bin < COARSE_BINS; bin++) {
+                        kernel_coarse[bin] += coarse[column * COARSE_BINS + bin];
+                    }
+                }
+                for (int bin = 0; bin < COARSE_BINS; bin++) {
+                    thread_histograms->fine_updated_at[channel][bin] = -1;
+                }
+            }
+
+            for (int x = x0; x < x1; x++) {
+                int first_column = x - x0;
+                unsigned char *new_pixel = (unsigned char *)&new_data[y * width + x];
+
+                for (int channel = 0; channel < 3; channel++) {
+                    if (first_column > 0) {
+                        const unsigned short *coarse = thread_histograms->column_coarse + channel * number_of_columns * COARSE_BINS;
+                        const unsigned short *entering = coarse + (first_column + window_size - 1) * COARSE_BINS;
+                        const unsigned short *leaving = coarse + (first_column - 1) * COARSE_BINS;
+                        unsigned int *kernel_coarse = thread_histograms->kernel_coarse[channel];
+                        for (int bin = 0; bin < COARSE_BINS; bin++) {
+                            kernel_coarse[bin] += entering[bin] - leaving[bin];
+                        }
+                    }
+
+                    new_pixel[channel] = kernel_histogram_rank(
+                        thread_histograms,
+                        channel,
+                        number_of_columns,
+                        first_column,
+                        window_size,
+                        rank
+                    );
+                }
+
+                if (epilogue && epilogue->number_of_stages > 0) {
+                    apply_epilogue(epilogue, (RGB *)new_pixel);
+                }
+            }
+        }
+    }
+
+    free(histograms);
+    free(column_fine);
+    free(column_coarse);
+}
\ No newline at end of file
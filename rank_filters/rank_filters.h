@@ -0,0 +1,26 @@
+#ifndef RANK_FILTERS_H
+#define RANK_FILTERS_H
+
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/*
+ * Replaces every channel of every pixel by the value of the given percentile
+ * (0 for minimum, 50 for median, 100 for maximum) of its (2 * radius + 1)^2
+ * neighbourhood, in constant time per pixel whatever the radius.
+ */
+void rank_filter(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int height_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    int radius,
+    double percentile,
+    int padding,
+    const Epilogue *epilogue
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "region_of_interest.h"
+#include "../shared_file_system_bmp_io/shared_file_system_bmp_io.h"
+#include "../buffer_pool/buffer_pool.h"
+
+/* Bytes every process moves per read and write when copying the input */
+#define COPY_CHUNK_SIZE (8 << 20)
+
+int parse_region_of_interest(
+    const char *text,               /* in */
+    RegionOfInterest *region        /* out */
+) {
+    int consumed = 0;
+    if (sscanf(text, "%d,%d,%d,%d%n", &region->x, &region->y, &region->width, &region->height, &consumed) != 4 || text[consumed] != '\0') {
+        return 1;
+    }
+    return (region->x < 0 || region->y < 0 || region->width < 1 || region->height < 1) ? 1 : 0;
+}
+
+/* Copies the input file into the output file, every process copying one contiguous share of the bytes */
+static void copy_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *in_file_handle,   /* in */
+    MPI_File *out_file_handle   /* in */
+) {
+    MPI_Offset file_size;
+    MPI_File_get_size(*in_file_handle, &file_size);
+    MPI_File_set_size(*out_file_handle, file_size);
+
+    MPI_Offset share = (file_size + number_of_processes - 1) / number_of_processes;
+    MPI_Offset start = process_rank * share;
+    MPI_Offset end = (start + share < file_size) ? start + share : file_size;
+
+    unsigned char *chunk = (unsigned char *)acquire_buffer(COPY_CHUNK_SIZE);
+
+    for (MPI_Offset offset = start; offset < end; offset += COPY_CHUNK_SIZE) {
+        int count = (end - offset < COPY_CHUNK_SIZE) ? (int)(end - offset) : COPY_CHUNK_SIZE;
+        MPI_Status status;
+        MPI_File_read_at(*in_file_handle, offset, chunk, count, MPI_UNSIGNED_CHAR, &status);
+        MPI_File_write_at(*out_file_handle, offset, chunk, count, MPI_UNSIGNED_CHAR, &status);
+    }
+
+    release_buffer(chunk);
+}
+
+void process_region_of_interest(
+    int process_rank,                   /* in */
+    int number_of_processes,            /* in */
+    int number_of_threads,              /* in */
+    const Operation *operation,         /* in */
+    const RegionOfInterest *region,     /* in */
+    const char *in_file_name,           /* in */
+    const char *out_file_name,          /* in */
+    int patch                           /* in */
+) {
+    double start_time = MPI_Wtime();
+
+    MPI_File in_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", in_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int height;
+    int width;
+    read_image_height_and_width_from_BMP_file(process_rank, number_of_processes, &in_file_handle, &height, &width);
+
+    if (region->x + region->width > width || region->y + region->height > height || region->height < number_of_processes) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: The region must lie within the %dx%d image and have at least one row per process\n", width, height);
+            fflush(stdout);
+        }
+        MPI_File_close(&in_file_handle);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int height_per_process = region->height / number_of_processes;
+    int rest = region->height % number_of_processes;
+    int local_height = height_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_local_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
+    int first_row = region->y + first_local_row;
+
+    int padding = operation_padding(operation, height);
+    int replicate = operation_replicates_borders(operation);
+
+    /* The strip and its halo, clipped to the image */
+    int window_first_row = (first_row - padding > 0) ? first_row - padding : 0;
+    int window_last_row = (first_row + local_height + padding < height) ? first_row + local_height + padding : height;
+    int window_first_column = (region->x - padding > 0) ? region->x - padding : 0;
+    int window_last_column = (region->x + region->width + padding < width) ? region->x + region->width + padding : width;
+    int window_rows = window_last_row - window_first_row;
+    int window_columns = window_last_column - window_first_column;
+
+    RGB *window = (RGB *)acquire_buffer((window_rows * window_columns + 1) * sizeof(RGB));
+
+    read_window_from_BMP_file(
+        process_rank,
+        number_of_processes,
+        &in_file_handle,
+        height,
+        width,
+        window,
+        window_first_row,
+        window_first_column,
+        window_rows,
+        window_columns
+    );
+
+    int local_height_with_padding = local_height + 2 * padding;
+    int width_with_padding = region->width + 2 * padding;
+    RGB *data_with_padding = (RGB *)acquire_image_buffer(
+        local_height_with_padding * width_with_padding * sizeof(RGB),
+        width_with_padding * sizeof(RGB),
+        number_of_threads
+    );
+
+    /* Halo pixels outside the image take the nearest image pixel, or zero */
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < local_height_with_padding; y++) {
+        int image_row = first_row - padding + y;
+        int row_inside = (image_row >= 0 && image_row < height);
+        if (image_row < 0) image_row = 0;
+        if (image_row > height - 1) image_row = height - 1;
+
+        for (int x = 0; x < width_with_padding; x++) {
+            int image_column = region->x - padding + x;
+            int column_inside = (image_column >= 0 && image_column < width);
+            if (image_column < 0) image_column = 0;
+            if (image_column > width - 1) image_column = width - 1;
+
+            RGB *pixel = &data_with_padding[y * width_with_padding + x];
+            if ((row_inside && column_inside) || replicate) {
+                *pixel = window[(image_row - window_first_row) * window_columns + (image_column - window_first_column)];
+            } else {
+                memset(pixel, 0, sizeof(RGB));
+            }
+        }
+    }
+
+    release_buffer(window);
+
+    RGB *new_local_data = (RGB *)acquire_image_buffer((local_height * region->width + 1) * sizeof(RGB), region->width * sizeof(RGB), number_of_threads);
+
+    apply_operation(
+        number_of_threads,
+        operation,
+        data_with_padding,
+        local_height_with_padding,
+        width_with_padding,
+        new_local_data,
+        local_height,
+        region->width,
+        padding,
+        first_row,
+        height,
+        MPI_COMM_WORLD
+    );
+
+    release_buffer(data_with_padding);
+
+    MPI_File out_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, out_file_name, MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &out_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", out_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (patch) {
+        copy_file(process_rank, number_of_processes, &in_file_handle, &out_file_handle);
+
+        /* The copy of every byte must land before any region row overwrites it */
+        MPI_File_sync(out_file_handle);
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_File_sync(out_file_handle);
+
+        /* The copy keeps the input's pixel layout */
+        BMPLayout layout;
+        read_BMP_layout_from_BMP_file(&in_file_handle, &layout);
+
+        write_tile_to_BMP_file(&out_file_handle, height, width, new_local_data, local_height, region->width, first_row, region->x, &layout);
+    } else {
+        int row_with_padding_size = (region->width * 3 + 3) & (~3);
+        MPI_File_set_size(out_file_handle, 54 + (MPI_Offset)region->height * row_with_padding_size);
+
+        write_strip_to_BMP_file(
+            process_rank,
+            number_of_processes,
+            &out_file_handle,
+            region->height,
+            region->width,
+            new_local_data,
+            local_height,
+            first_local_row,
+            NULL
+        );
+    }
+
+    MPI_File_close(&out_file_handle);
+    MPI_File_close(&in_file_handle);
+
+    release_buffer(new_local_data);
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\n%dx%d region at (%d, %d) of the %dx%d image %s %s in %f seconds\n",
+            region->width,
+            region->height,
+            region->x,
+            region->y,
+            width,
+            height,
+            patch ? "patched into" : "saved in",
+            out_file_name,
+            MPI_Wtime() - start_time
+        );
+        fflush(stdout);
+    }
+}
\ No newline at end of file
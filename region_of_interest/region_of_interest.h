@@ -0,0 +1,40 @@
+#ifndef REGION_OF_INTEREST_H
+#define REGION_OF_INTEREST_H
+
+#include "../operations/operations.h"
+
+/* A crop window of the input image, in pixels from its top left corner */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} RegionOfInterest;
+
+/* Parses x,y,width,height; returns 0 on success */
+int parse_region_of_interest(
+    const char *text,
+    RegionOfInterest *region
+);
+
+/*
+ * Applies the operation to the region only. The region's rows are split evenly
+ * among the processes, and every process reads its rows and columns plus the
+ * halo of the operation through a subarray view, so that no halo exchange is
+ * needed. Pixels of the halo outside the image are zero, or replicated from the
+ * image border for operations that replicate borders, as in a full-image run.
+ * The result is written as a cropped BMP, or, when patch is set, into a copy of
+ * the input whose region is replaced. The operation must be tile local.
+ */
+void process_region_of_interest(
+    int process_rank,
+    int number_of_processes,
+    int number_of_threads,
+    const Operation *operation,
+    const RegionOfInterest *region,
+    const char *in_file_name,
+    const char *out_file_name,
+    int patch
+);
+
+#endif
\ No newline at end of file
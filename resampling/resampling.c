@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "mpi.h"
+#include "resampling.h"
+
+static double filter_support(ResamplingFilter filter) {
+    switch (filter) {
+        case BICUBIC_FILTER:
+            return 2.0;
+        case LANCZOS3_FILTER:
+            return 3.0;
+        case BILINEAR_FILTER:
+        default:
+            return 1.0;
+    }
+}
+
+static double filter_value(ResamplingFilter filter, double x) {
+    x = fabs(x);
+
+    switch (filter) {
+        case BICUBIC_FILTER: {
+            /* Keys cubic convolution with a = -0.5 */
+            const double a = -0.5;
+            if (x < 1.0) {
+                return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+            }
+            if (x < 2.0) {
+                return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+            }
+            return 0.0;
+        }
+        case LANCZOS3_FILTER:
+            if (x < 1e-12) {
+                return 1.0;
+            }
+            if (x < 3.0) {
+                return 3.0 * sin(M_PI * x) * sin(M_PI * x / 3.0) / (M_PI * M_PI * x * x);
+            }
+            return 0.0;
+        case BILINEAR_FILTER:
+        default:
+            return (x < 1.0) ? 1.0 - x : 0.0;
+    }
+}
+
+/* Most taps a single output sample can use along a dimension scaled from input_size to output_size */
+static int maximum_number_of_taps(ResamplingFilter filter, int input_size, int output_size) {
+    double scale = (double)input_size / (double)output_size;
+    if (scale < 1.0) {
+        scale = 1.0;
+    }
+    return 2 * (int)ceil(filter_support(filter) * scale) + 2;
+}
+
+/*
+ * Computes, for every output sample, the input samples it blends and their normalized
+ * weights; input indices are clamped to the image, which replicates its borders
+ */
+static void compute_resampling_taps(
+    ResamplingFilter filter,    /* in */
+    int input_size,             /* in */
+    int output_size,            /* in */
+    int first_output,           /* in */
+    int number_of_outputs,      /* in */
+    int max_taps,               /* in */
+    int *counts,                /* out */
+    int *indices,               /* out */
+    double *weights             /* out */
+) {
+    double scale = (double)input_size / (double)output_size;
+    double filter_scale = (scale > 1.0) ? scale : 1.0;
+    double support = filter_support(filter) * filter_scale;
+
+    for (int i = 0; i < number_of_outputs; i++) {
+        double center = ((double)(first_output + i) + 0.5) * scale - 0.5;
+        int first_input = (int)floor(center - support) + 1;
+        int last_input = (int)floor(center + support);
+
+        int *output_indices = indices + i * max_taps;
+        double *output_weights = weights + i * max_taps;
+
+        int count = 0;
+        double sum = 0.0;
+        for (int input = first_input; input <= last_input && count < max_taps; input++) {
+            double weight = filter_value(filter, ((double)input - center) / filter_scale);
+            if (weight == 0.0) {
+                continue;
+            }
+            int clamped = input;
+            if (clamped < 0) clamped = 0;
+            if (clamped > input_size - 1) clamped = input_size - 1;
+            output_indices[count] = clamped;
+            output_weights[count] = weight;
+            sum += weight;
+            count++;
+        }
+
+        for (int k = 0; k < count; k++) {
+            output_weights[k] /= sum;
+        }
+        counts[i] = count;
+    }
+}
+
+int parse_resampling_filter(
+    const char *name,           /* in */
+    ResamplingFilter *filter    /* out */
+) {
+    if (strcmp(name, "BILINEAR") == 0) {
+        *filter = BILINEAR_FILTER;
+    } else if (strcmp(name, "BICUBIC") == 0) {
+        *filter = BICUBIC_FILTER;
+    } else if (strcmp(name, "LANCZOS3") == 0) {
+        *filter = LANCZOS3_FILTER;
+    } else {
+        return 1;
+    }
+    return 0;
+}
+
+int pyramid_level_size(
+    int size,       /* in */
+    int level       /* in */
+) {
+    int level_size = (int)(((long long)size + (1LL << level) - 1) >> level);
+    return (level_size > 0) ? level_size : 1;
+}
+
+void pyramid_level_file_name(
+    const char *file_name,          /* in */
+    int level,                      /* in */
+    char *level_file_name,          /* out */
+    size_t level_file_name_size     /* in */
+) {
+    const char *extension = strrchr(file_name, '.');
+    if (!extension || strchr(extension, '/')) {
+        extension = file_name + strlen(file_name);
+    }
+    snprintf(level_file_name, level_file_name_size, "%.*s_%d%s", (int)(extension - file_name), file_name, level, extension);
+}
+
+int resampling_padding(
+    ResamplingFilter filter,    /* in */
+    int image_height,           /* in */
+    int new_image_height        /* in */
+) {
+    return maximum_number_of_taps(filter, image_height, new_image_height) / 2 + 1;
+}
+
+void resampled_strip_rows(
+    int first_row,              /* in */
+    int local_height,           /* in */
+    int image_height,           /* in */
+    int new_image_height,       /* in */
+    int *new_first_row,         /* out */
+    int *new_local_height       /* out */
+) {
+    double scale = (double)image_height / (double)new_image_height;
+
+    int first = 0;
+    while (first < new_image_height && (int)floor((first + 0.5) * scale) < first_row) {
+        first++;
+    }
+    int last = first;
+    while (last < new_image_height && (int)floor((last + 0.5) * scale) < first_row + local_height) {
+        last++;
+    }
+
+    *new_first_row = first;
+    *new_local_height = last - first;
+}
+
+void resample(
+    int number_of_threads,          /* in */
+    const RGB *data_with_padding,   /* in */
+    int width_with_padding,         /* in */
+    int padding,                    /* in */
+    int first_row,                  /* in */
+    int image_height,               /* in */
+    int width,                      /* in */
+    RGB *new_data,                  /* out */
+    int new_first_row,              /* in */
+    int new_local_height,           /* in */
+    int new_image_height,           /* in */
+    int new_width,                  /* in */
+    ResamplingFilter filter,        /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    if (new_local_height == 0) {
+        return;
+    }
+
+    int max_row_taps = maximum_number_of_taps(filter, image_height, new_image_height);
+    int max_column_taps = maximum_number_of_taps(filter, width, new_width);
+
+    int *row_counts = (int *)malloc(new_local_height * sizeof(int));
+    int *row_indices = (int *)malloc(new_local_height * max_row_taps * sizeof(int));
+    double *row_weights = (double *)malloc(new_local_height * max_row_taps * sizeof(double));
+    int *column_counts = (int *)malloc(new_width * sizeof(int));
+    int *column_indices = (int *)malloc(new_width * max_column_taps * sizeof(int));
+    double *column_weights = (double *)malloc(new_width * max_column_taps * sizeof(double));
+    double *intermediate_rows = (double *)malloc(number_of_threads * width * 3 * sizeof(double));
+    if (!row_counts || !row_indices || !row_weights || !column_counts || !column_indices || !column_weights || !intermediate_rows) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    compute_resampling_taps(filter, image_height, new_image_height, new_first_row, new_local_height, max_row_taps, row_counts, row_indices, row_weights);
+    compute_resampling_taps(filter, width, new_width, 0, new_width, max_column_taps, column_counts, column_indices, column_weights);
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int y = 0; y < new_local_height; y++) {
+        double *intermediate = intermediate_rows + omp_get_thread_num() * width * 3;
+
+        /* Vertical taps first, only for this output row, then horizontal taps on the blended row */
+        for (int c = 0; c < width * 3; c++) {
+            intermediate[c] = 0.0;
+        }
+        for (int k = 0; k < row_counts[y]; k++) {
+            int local_row = row_indices[y * max_row_taps + k] - first_row + padding;
+            const unsigned char *row = (const unsigned char *)(data_with_padding + local_row * width_with_padding + padding);
+            double weight = row_weights[y * max_row_taps + k];
+            for (int c = 0; c < width * 3; c++) {
+                intermediate[c] += weight * (double)row[c];
+            }
+        }
+
+        for (int x = 0; x < new_width; x++) {
+            double accumulator[3] = { 0.0, 0.0, 0.0 };
+            for (int k = 0; k < column_counts[x]; k++) {
+                const double *source = intermediate + column_indices[x * max_column_taps + k] * 3;
+                double weight = column_weights[x * max_column_taps + k];
+                accumulator[0] += weight * source[0];
+                accumulator[1] += weight * source[1];
+                accumulator[2] += weight * source[2];
+            }
+
+            unsigned char *new_pixel = (unsigned char *)&new_data[y * new_width + x];
+            new_pixel[0] = clamp_to_unsigned_char(accumulator[0] + 0.5);
+            new_pixel[1] = clamp_to_unsigned_char(accumulator[1] + 0.5);
+            new_pixel[2] = clamp_to_unsigned_char(accumulator[2] + 0.5);
+
+            if (epilogue && epilogue->number_of_stages > 0) {
+                apply_epilogue(epilogue, &new_data[y * new_width + x]);
+            }
+        }
+    }
+
+    free(row_counts);
+    free(row_indices);
+    free(row_weights);
+    free(column_counts);
+    free(column_indices);
+    free(column_weights);
+    free(intermediate_rows);
+}
+
+void pyramid_level_strip_rows(
+    int first_row,              /* in */
+    int local_height,           /* in */
+    int image_height,           /* in */
+    int number_of_levels,       /* in */
+    int *level_first_rows,      /* out */
+    int *level_local_heights    /* out */
+) {
+    int level_height = image_height;
+
+    for (int level = 0; level < number_of_levels; level++) {
+        int new_level_height = pyramid_level_size(image_height, level + 1);
+        resampled_strip_rows(first_row, local_height, level_height, new_level_height, &level_first_rows[level], &level_local_heights[level]);
+
+        first_row = level_first_rows[level];
+        local_height = level_local_heights[level];
+        level_height = new_level_height;
+    }
+}
+
+void downsample_pyramid_level(
+    int number_of_threads,      /* in */
+    MPI_Comm communicator,      /* in */
+    const RGB *data,            /* in */
+    int first_row,              /* in */
+    int local_height,           /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *new_data,              /* out */
+    int new_first_row,          /* in */
+    int new_local_height,       /* in */
+    int new_height,             /* in */
+    int new_width,              /* in */
+    ResamplingFilter filter     /* in */
+) {
+    int process_rank;
+    int number_of_processes;
+    MPI_Comm_rank(communicator, &process_rank);
+    MPI_Comm_size(communicator, &number_of_processes);
+
+    int padding = resampling_padding(filter, height, new_height);
+
+    int strip[2] = { first_row, local_height };
+    int *strips = (int *)malloc(2 * number_of_processes * sizeof(int));
+    int *send_counts = (int *)malloc(4 * number_of_processes * sizeof(int));
+    RGB *data_with_padding = (RGB *)malloc(((size_t)(local_height + 2 * padding) * width + 1) * sizeof(RGB));
+    if (!strips || !send_counts || !data_with_padding) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    int *send_displacements = send_counts + number_of_processes;
+    int *receive_counts = send_counts + 2 * number_of_processes;
+    int *receive_displacements = send_counts + 3 * number_of_processes;
+
+    MPI_Allgather(strip, 2, MPI_INT, strips, 2, MPI_INT, communicator);
+
+    /*
+     * Strips of deep levels may be thinner than the halo, or empty, so the halo rows
+     * are fetched from whichever processes own them rather than from the neighbours
+     */
+    for (int i = 0; i < number_of_processes; i++) {
+        int other_first_row = strips[2 * i];
+        int other_local_height = strips[2 * i + 1];
+        int other_first_needed = (other_first_row - padding > 0) ? other_first_row - padding : 0;
+        int other_last_needed = (other_first_row + other_local_height + padding < height) ? other_first_row + other_local_height + padding : height;
+        if (other_local_height == 0) {
+            other_last_needed = other_first_needed;
+        }
+
+        int first_sent = (other_first_needed > first_row) ? other_first_needed : first_row;
+        int last_sent = (other_last_needed < first_row + local_height) ? other_last_needed : first_row + local_height;
+        send_counts[i] = (last_sent > first_sent) ? (last_sent - first_sent) * width * 3 : 0;
+        send_displacements[i] = (last_sent > first_sent) ? (first_sent - first_row) * width * 3 : 0;
+
+        int first_needed = (first_row - padding > 0) ? first_row - padding : 0;
+        int last_needed = (first_row + local_height + padding < height) ? first_row + local_height + padding : height;
+        if (local_height == 0) {
+            last_needed = first_needed;
+        }
+
+        int first_received = (first_needed > other_first_row) ? first_needed : other_first_row;
+        int last_received = (last_needed < other_first_row + other_local_height) ? last_needed : other_first_row + other_local_height;
+        receive_counts[i] = (last_received > first_received) ? (last_received - first_received) * width * 3 : 0;
+        receive_displacements[i] = (last_received > first_received) ? (first_received - first_row + padding) * width * 3 : 0;
+    }
+
+    MPI_Alltoallv(
+        data,
+        send_counts,
+        send_displacements,
+        MPI_UNSIGNED_CHAR,
+        data_with_padding,
+        receive_counts,
+        receive_displacements,
+        MPI_UNSIGNED_CHAR,
+        communicator
+    );
+
+    /* Rows above the first one of the buffer are never reached, since resample() clamps its taps to the level */
+    resample(
+        number_of_threads,
+        data_with_padding,
+        width,
+        0,
+        first_row - padding,
+        height,
+        width,
+        new_data,
+        new_first_row,
+        new_local_height,
+        new_height,
+        new_width,
+        filter,
+        NULL
+    );
+
+    free(strips);
+    free(send_counts);
+    free(data_with_padding);
+}
+
+/* Runs the epilogue on every pixel of a strip */
+static void apply_epilogue_to_strip(
+    int number_of_threads,      /* in */
+    RGB *data,                  /* in / out */
+    int number_of_pixels,       /* in */
+    const Epilogue *epilogue    /* in */
+) {
+    if (!epilogue || epilogue->number_of_stages == 0) {
+        return;
+    }
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(static)
+    for (int i = 0; i < number_of_pixels; i++) {
+        apply_epilogue(epilogue, &data[i]);
+    }
+}
+
+void build_pyramid(
+    int number_of_threads,              /* in */
+    MPI_Comm communicator,              /* in */
+    const RGB *data_with_padding,       /* in */
+    int width_with_padding,             /* in */
+    int padding,                        /* in */
+    int first_row,                      /* in */
+    int local_height,                   /* in */
+    int image_height,                   /* in */
+    int width,                          /* in */
+    RGB **level_data,                   /* out */
+    int number_of_levels,               /* in */
+    ResamplingFilter filter,            /* in */
+    const Epilogue *epilogue            /* in */
+) {
+    int level_first_rows[MAX_PYRAMID_LEVELS] = { 0 };
+    int level_local_heights[MAX_PYRAMID_LEVELS] = { 0 };
+    pyramid_level_strip_rows(first_row, local_height, image_height, number_of_levels, level_first_rows, level_local_heights);
+
+    resample(
+        number_of_threads,
+        data_with_padding,
+        width_with_padding,
+        padding,
+        first_row,
+        image_height,
+        width,
+        level_data[0],
+        level_first_rows[0],
+        level_local_heights[0],
+        pyramid_level_size(image_height, 1),
+        pyramid_level_size(width, 1),
+        filter,
+        NULL
+    );
+
+    /* A level gets its point operations only once the level below has been built from it */
+    for (int level = 1; level < number_of_levels; level++) {
+        downsample_pyramid_level(
+            number_of_threads,
+            communicator,
+            level_data[level - 1],
+            level_first_rows[level - 1],
+            level_local_heights[level - 1],
+            pyramid_level_size(image_height, level),
+            pyramid_level_size(width, level),
+            level_data[level],
+            level_first_rows[level],
+            level_local_heights[level],
+            pyramid_level_size(image_height, level + 1),
+            pyramid_level_size(width, level + 1),
+            filter
+        );
+
+        apply_epilogue_to_strip(number_of_threads, level_data[level - 1], level_local_heights[level - 1] * pyramid_level_size(width, level), epilogue);
+    }
+
+    apply_epilogue_to_strip(number_of_threads, level_data[number_of_levels - 1], level_local_heights[number_of_levels - 1] * pyramid_level_size(width, number_of_levels), epilogue);
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#ifndef RESAMPLING_H
+#define RESAMPLING_H
+
+#include <stddef.h>
+#include "mpi.h"
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/* Most levels a single pyramid run may write */
+#define MAX_PYRAMID_LEVELS 16
+
+typedef enum {
+    BILINEAR_FILTER,
+    BICUBIC_FILTER,
+    LANCZOS3_FILTER
+} ResamplingFilter;
+
+/* Parses BILINEAR, BICUBIC or LANCZOS3, returns 0 on success */
+int parse_resampling_filter(
+    const char *name,
+    ResamplingFilter *filter
+);
+
+/* Returns the side of pyramid level level for a level 0 side of size, rounded up and at least 1 */
+int pyramid_level_size(
+    int size,
+    int level
+);
+
+/* Builds the file name of a pyramid level, e.g. out_2.bmp for level 2 of out.bmp */
+void pyramid_level_file_name(
+    const char *file_name,
+    int level,
+    char *level_file_name,
+    size_t level_file_name_size
+);
+
+/* Returns the halo depth needed to resample image_height rows to new_image_height rows */
+int resampling_padding(
+    ResamplingFilter filter,
+    int image_height,
+    int new_image_height
+);
+
+/*
+ * Finds the output rows a strip produces: those whose centre maps into the strip,
+ * so that every output row is computed by exactly one rank
+ */
+void resampled_strip_rows(
+    int first_row,
+    int local_height,
+    int image_height,
+    int new_image_height,
+    int *new_first_row,
+    int *new_local_height
+);
+
+/*
+ * Resamples a padded strip to new_local_height rows of new_width pixels, starting at
+ * row new_first_row of the new image. The filter is widened by the scale factor when
+ * shrinking, so anti-aliasing and decimation happen in the same pass, and only the
+ * output rows are ever computed.
+ */
+void resample(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int width_with_padding,
+    int padding,
+    int first_row,
+    int image_height,
+    int width,
+    RGB *new_data,
+    int new_first_row,
+    int new_local_height,
+    int new_image_height,
+    int new_width,
+    ResamplingFilter filter,
+    const Epilogue *epilogue
+);
+
+/*
+ * Finds the rows of every pyramid level a strip produces, each level following the
+ * strips of the level above it, from which it is built
+ */
+void pyramid_level_strip_rows(
+    int first_row,
+    int local_height,
+    int image_height,
+    int number_of_levels,
+    int *level_first_rows,
+    int *level_local_heights
+);
+
+/*
+ * Builds the strip of a pyramid level from the strips of the level above, which the
+ * processes of the communicator hold in rank order; the halo only spans the filter
+ * support of a 2x reduction, whatever the depth of the level. Collective.
+ */
+void downsample_pyramid_level(
+    int number_of_threads,
+    MPI_Comm communicator,
+    const RGB *data,
+    int first_row,
+    int local_height,
+    int height,
+    int width,
+    RGB *new_data,
+    int new_first_row,
+    int new_local_height,
+    int new_height,
+    int new_width,
+    ResamplingFilter filter
+);
+
+/*
+ * Builds the strips of pyramid levels 1 to number_of_levels, given by
+ * pyramid_level_strip_rows(), from a padded strip of the input: level 1 with
+ * resample(), every further one from the level above with a 2x reduction, so that
+ * the input halo is the one of level 1 alone. Collective.
+ */
+void build_pyramid(
+    int number_of_threads,
+    MPI_Comm communicator,
+    const RGB *data_with_padding,
+    int width_with_padding,
+    int padding,
+    int first_row,
+    int local_height,
+    int image_height,
+    int width,
+    RGB **level_data,
+    int number_of_levels,
+    ResamplingFilter filter,
+    const Epilogue *epilogue
+);
+
+#endif
\ No newline at end of file
@@ -1,6 +1,279 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include "shared_file_system_bmp_io.h"
+#include "../buffer_pool/buffer_pool.h"
+#include "../luma/luma.h"
+
+/* The file header, the 40-byte DIB header and the channel masks that follow it in bit field BMPs */
+#define BMP_HEADER_SIZE 54
+#define BMP_HEADER_WITH_MASKS_SIZE 66
+
+static const BMPLayout default_layout = { BMP_HEADER_SIZE, 3, 0 };
+
+/*
+ * Returns 0 when the header describes uncompressed 24-bit pixels, or 32-bit ones with
+ * blue, green and red in the low three bytes, and fills in their layout
+ */
+static int parse_BMP_header(
+    const unsigned char *header,    /* in */
+    int *image_height,              /* out */
+    int *image_width,               /* out */
+    BMPLayout *layout               /* out */
+) {
+    if (header[0] != 'B' || header[1] != 'M') {
+        return 1;
+    }
+
+    int bits_per_pixel = *(short *)&header[28];
+    int compression = *(int *)&header[30];
+
+    /* Bit field masks only describe the usual BGRX order when they are the ones of BI_RGB */
+    int usual_masks = (*(unsigned int *)&header[54] == 0x00ff0000 && *(unsigned int *)&header[58] == 0x0000ff00 && *(unsigned int *)&header[62] == 0x000000ff);
+
+    if (!(bits_per_pixel == 24 && compression == 0) && !(bits_per_pixel == 32 && (compression == 0 || (compression == 3 && usual_masks)))) {
+        return 1;
+    }
+
+    *image_width = *(int *)&header[18];
+    *image_height = *(int *)&header[22];
+
+    layout->data_offset = *(int *)&header[10];
+    layout->bytes_per_pixel = bits_per_pixel / 8;
+    layout->top_down = (*image_height < 0);
+
+    if (*image_height < 0) {
+        *image_height = -*image_height;
+    }
+
+    return 0;
+}
+
+static int BMP_row_with_padding_size(
+    int width,                  /* in */
+    const BMPLayout *layout     /* in */
+) {
+    return (width * layout->bytes_per_pixel + 3) & (~3);
+}
+
+/* File offset of the first stored row of the strip, the strip's last row in a bottom-up file */
+static MPI_Offset BMP_strip_offset(
+    int height,                 /* in */
+    int width,                  /* in */
+    int first_row,              /* in */
+    int local_height,           /* in */
+    const BMPLayout *layout     /* in */
+) {
+    int start_row = layout->top_down ? first_row : height - (first_row + local_height);
+    return layout->data_offset + (MPI_Offset)start_row * BMP_row_with_padding_size(width, layout);
+}
+
+/* Returns 1 when an MPI-IO call failed or moved fewer than size bytes */
+static int BMP_transfer_failed(
+    int error,              /* in */
+    MPI_Status *status,     /* in */
+    int size                /* in */
+) {
+    if (error != MPI_SUCCESS) {
+        return 1;
+    }
+
+    int count = 0;
+    MPI_Get_count(status, MPI_UNSIGNED_CHAR, &count);
+
+    return count != size;
+}
+
+/* Converts one row of 3 or 4-byte BMP pixels, blue first, to RGB pixels */
+static void decode_BMP_row(
+    const unsigned char *row,   /* in */
+    int bytes_per_pixel,        /* in */
+    RGB *pixels,                /* out */
+    int width                   /* in */
+) {
+    if (bytes_per_pixel == 4) {
+        /* 4-byte pixels are word aligned, one load each and no shuffling across pixels */
+        for (int x = 0; x < width; x++) {
+            unsigned int word;
+            memcpy(&word, row + x * 4, sizeof(word));
+            pixels[x].b = (unsigned char)word;
+            pixels[x].g = (unsigned char)(word >> 8);
+            pixels[x].r = (unsigned char)(word >> 16);
+        }
+        return;
+    }
+
+    for (int x = 0; x < width; x++) {
+        pixels[x].b = row[x * 3];
+        pixels[x].g = row[x * 3 + 1];
+        pixels[x].r = row[x * 3 + 2];
+    }
+}
+
+/* Converts one row of 3 or 4-byte BMP pixels to their luma and, unless chroma_blue is NULL, their chroma */
+static void decode_BMP_row_to_luma(
+    const unsigned char *row,       /* in */
+    int bytes_per_pixel,            /* in */
+    unsigned char *luma,            /* out */
+    unsigned char *chroma_blue,     /* out */
+    unsigned char *chroma_red,      /* out */
+    int width                       /* in */
+) {
+    for (int x = 0; x < width; x++) {
+        const unsigned char *bytes = row + x * bytes_per_pixel;
+        RGB pixel = { bytes[2], bytes[1], bytes[0] };
+        luma[x] = luma_of_pixel(pixel);
+        if (chroma_blue) {
+            chroma_of_pixel(pixel, &chroma_blue[x], &chroma_red[x]);
+        }
+    }
+}
+
+/* Converts RGB pixels to one row of 3 or 4-byte BMP pixels, the fourth byte being opaque */
+static void encode_BMP_row(
+    const RGB *pixels,          /* in */
+    int bytes_per_pixel,        /* in */
+    unsigned char *row,         /* out */
+    int width                   /* in */
+) {
+    if (bytes_per_pixel == 4) {
+        for (int x = 0; x < width; x++) {
+            unsigned int word = pixels[x].b | (pixels[x].g << 8) | (pixels[x].r << 16) | 0xff000000u;
+            memcpy(row + x * 4, &word, sizeof(word));
+        }
+        return;
+    }
+
+    for (int x = 0; x < width; x++) {
+        row[x * 3] = pixels[x].b;
+        row[x * 3 + 1] = pixels[x].g;
+        row[x * 3 + 2] = pixels[x].r;
+    }
+}
+
+/*
+ * Reads and decodes rows first_row to first_row + rows - 1 through the staging buffer,
+ * collectively or not; returns 1 when the file does not hold them all
+ */
+static int read_BMP_rows(
+    MPI_File *file_handle,              /* in */
+    const BMPLayout *layout,            /* in */
+    int height,                         /* in */
+    int width,                          /* in */
+    RGB *data,                          /* out */
+    int rows,                           /* in */
+    int first_row,                      /* in */
+    unsigned char *rows_with_padding,   /* in */
+    int collective                      /* in */
+) {
+    int row_with_padding_size = BMP_row_with_padding_size(width, layout);
+
+    MPI_Status status;
+
+    MPI_Offset file_offset = BMP_strip_offset(height, width, first_row, rows, layout);
+
+    int error = (collective ? MPI_File_read_at_all : MPI_File_read_at)(
+        *file_handle,                   /* the file handle */
+        file_offset,                    /* the file offset */
+        rows_with_padding,              /* the initial address of the buffer */
+        rows * row_with_padding_size,   /* the number of elements in the buffer */
+        MPI_UNSIGNED_CHAR,              /* the datatype of each buffer element */
+        &status                         /* the status object */
+    );
+
+    /* Bottom-up files store the last row first, top-down ones map straight onto the rows */
+    for (int y = 0; y < rows; y++) {
+        int row = layout->top_down ? y : rows - 1 - y;
+        decode_BMP_row(rows_with_padding + y * row_with_padding_size, layout->bytes_per_pixel, data + row * width, width);
+    }
+
+    return BMP_transfer_failed(error, &status, rows * row_with_padding_size);
+}
+
+/*
+ * Encodes rows first_row to first_row + rows - 1 into the staging buffer and writes them,
+ * collectively or not; returns 1 when the write fails
+ */
+static int write_BMP_rows(
+    MPI_File *file_handle,              /* in */
+    const BMPLayout *layout,            /* in */
+    int height,                         /* in */
+    int width,                          /* in */
+    const RGB *data,                    /* in */
+    int rows,                           /* in */
+    int first_row,                      /* in */
+    unsigned char *rows_with_padding,   /* in */
+    int collective                      /* in */
+) {
+    int row_with_padding_size = BMP_row_with_padding_size(width, layout);
+    int row_size = width * layout->bytes_per_pixel;
+
+    for (int y = 0; y < rows; y++) {
+        int row = layout->top_down ? y : rows - 1 - y;
+        encode_BMP_row(data + row * width, layout->bytes_per_pixel, rows_with_padding + y * row_with_padding_size, width);
+        memset(rows_with_padding + y * row_with_padding_size + row_size, 0, row_with_padding_size - row_size);
+    }
+
+    MPI_Status status;
+
+    MPI_Offset file_offset = BMP_strip_offset(height, width, first_row, rows, layout);
+
+    int error = (collective ? MPI_File_write_at_all : MPI_File_write_at)(
+        *file_handle,                   /* the file handle */
+        file_offset,                    /* the file offset */
+        rows_with_padding,              /* the initial address of the buffer */
+        rows * row_with_padding_size,   /* the number of elements in the buffer */
+        MPI_UNSIGNED_CHAR,              /* the datatype of each buffer element */
+        &status                         /* the status object */
+    );
+
+    return BMP_transfer_failed(error, &status, rows * row_with_padding_size);
+}
+
+/* Writes the 54-byte header of a BMP file of the given size and layout; returns 1 when the write fails */
+static int write_BMP_header(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const BMPLayout *layout     /* in */
+) {
+    unsigned char header[54] = {
+        'B', 'M',       // Signature
+        0, 0, 0, 0,     // File Size
+        0, 0, 0, 0,     // Reserved
+        54, 0, 0, 0,    // File Offset to Image Data
+        40, 0, 0, 0,    // DIB Header Size
+        0, 0, 0, 0,     // Image Width
+        0, 0, 0, 0,     // Image Height
+        1, 0,           // Color Planes
+        24, 0,          // Bits per Pixel
+        0, 0, 0, 0,     // Compression (none)
+        0, 0, 0, 0,     // Image Size
+        0, 0, 0, 0,     // X Pixels per Meter
+        0, 0, 0, 0,     // Y Pixels per Meter
+        0, 0, 0, 0,     // Colors in Color Palette
+        0, 0, 0, 0      // Important Colors Count
+    };
+
+    *(int *)&header[2] = BMP_HEADER_SIZE + height * BMP_row_with_padding_size(width, layout);
+    *(int *)&header[18] = width;
+    *(int *)&header[22] = layout->top_down ? -height : height;
+    *(short *)&header[28] = layout->bytes_per_pixel * 8;
+
+    MPI_Status status;
+
+    int error = MPI_File_write_at(
+        *file_handle,       /* the file handle */
+        0,                  /* the file offset */
+        header,             /* the initial address of the buffer */
+        BMP_HEADER_SIZE,    /* the number of elements in the buffer */
+        MPI_UNSIGNED_CHAR,  /* the datatype of each buffer element */
+        &status             /* the status object */
+    );
+
+    return BMP_transfer_failed(error, &status, BMP_HEADER_SIZE);
+}
 
 void read_image_height_and_width_from_BMP_file(
     int process_rank,           /* in */
@@ -9,20 +282,21 @@ void read_image_height_and_width_from_BMP_file(
     int *image_height,          /* out */
     int *image_width            /* out */
 ) {
-    int header_size = 54;
-    unsigned char header[header_size];
+    unsigned char header[BMP_HEADER_WITH_MASKS_SIZE] = { 0 };
 
     MPI_Status status;
 
     MPI_File_read_at_all(
-        *file_handle,       /* the file handle */
-        0,                  /* the file offset */
-        header,             /* the initial address of the buffer */
-        header_size,        /* the number of elements in the buffer */
-        MPI_UNSIGNED_CHAR,  /* the datatype of each buffer element */
-        &status             /* the status object */
+        *file_handle,               /* the file handle */
+        0,                          /* the file offset */
+        header,                     /* the initial address of the buffer */
+        BMP_HEADER_WITH_MASKS_SIZE, /* the number of elements in the buffer */
+        MPI_UNSIGNED_CHAR,          /* the datatype of each buffer element */
+        &status                     /* the status object */
     );
 
+    BMPLayout layout;
+
     if (header[0] != 'B' || header[1] != 'M') {
         if (process_rank == 0) {
             fprintf(stderr, "Error: Not a valid BMP file\n");
@@ -32,13 +306,9 @@ void read_image_height_and_width_from_BMP_file(
         MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
     }
 
-    *image_width = *(int *)&header[18];
-    *image_height = *(int *)&header[22];
-    int bits_per_pixel = *(short *)&header[28];
-
-    if (bits_per_pixel != 24) {
+    if (parse_BMP_header(header, image_height, image_width, &layout)) {
         if (process_rank == 0) {
-            fprintf(stderr, "Error: Only 24-bit BMPs are supported\n");
+            fprintf(stderr, "Error: Only uncompressed 24-bit and 32-bit BMPs are supported\n");
             fflush(stderr);
         }
         MPI_File_close(file_handle);
@@ -46,6 +316,57 @@ void read_image_height_and_width_from_BMP_file(
     }
 }
 
+void read_BMP_layout_from_BMP_file(
+    MPI_File *file_handle,      /* in */
+    BMPLayout *layout           /* out */
+) {
+    unsigned char header[BMP_HEADER_WITH_MASKS_SIZE] = { 0 };
+    int height;
+    int width;
+
+    MPI_Status status;
+    MPI_File_read_at(*file_handle, 0, header, BMP_HEADER_WITH_MASKS_SIZE, MPI_UNSIGNED_CHAR, &status);
+
+    /* The header was checked by read_image_height_and_width_from_BMP_file() */
+    if (parse_BMP_header(header, &height, &width, layout)) {
+        *layout = default_layout;
+    }
+}
+
+int read_BMP_header_from_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int *image_height,          /* out */
+    int *image_width,           /* out */
+    BMPLayout *layout           /* out */
+) {
+    unsigned char header[BMP_HEADER_WITH_MASKS_SIZE] = { 0 };
+
+    MPI_Status status;
+    int error = MPI_File_read_at(*file_handle, 0, header, BMP_HEADER_WITH_MASKS_SIZE, MPI_UNSIGNED_CHAR, &status);
+
+    /* 24-bit files without masks may be shorter than the header with them, but never than the plain one */
+    int count = 0;
+    if (error != MPI_SUCCESS || MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &count) != MPI_SUCCESS || count < BMP_HEADER_SIZE) {
+        return 1;
+    }
+
+    if (parse_BMP_header(header, image_height, image_width, layout)) {
+        return 1;
+    }
+
+    if (*image_height <= 0 || *image_width <= 0 || *image_width > (INT_MAX - 3) / layout->bytes_per_pixel || layout->data_offset < BMP_HEADER_SIZE) {
+        return 1;
+    }
+
+    /* The rows must all be in the file, so that no later read comes up short */
+    MPI_Offset file_size;
+    if (MPI_File_get_size(*file_handle, &file_size) != MPI_SUCCESS) {
+        return 1;
+    }
+
+    return layout->data_offset + (MPI_Offset)*image_height * BMP_row_with_padding_size(*image_width, layout) > file_size;
+}
+
 void read_local_data_from_BMP_file(
     int process_rank,           /* in */
     int number_of_processes,    /* in */
@@ -57,45 +378,299 @@ void read_local_data_from_BMP_file(
     int height_per_process,     /* in */
     int rest                    /* in */
 ) {
-    int row_with_padding_size = (width * 3 + 3) & (~3);
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
 
-    unsigned char *rows_with_padding = (unsigned char *)malloc(local_height * row_with_padding_size * sizeof(unsigned char));
-    if (!rows_with_padding) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fflush(stderr);
-        MPI_File_close(file_handle);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    read_strip_from_BMP_file(
+        process_rank,
+        number_of_processes,
+        file_handle,
+        height,
+        width,
+        initial_local_data,
+        local_height,
+        first_row
+    );
+}
+
+void read_strip_from_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row               /* in */
+) {
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(file_handle, &layout);
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(local_height * BMP_row_with_padding_size(width, &layout) * sizeof(unsigned char) + 1);
+
+    read_BMP_rows(file_handle, &layout, height, width, initial_local_data, local_height, first_row, rows_with_padding, 1);
+
+    release_buffer(rows_with_padding);
+}
+
+void read_strip_from_BMP_file_in_chunks(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row,              /* in */
+    int chunk_rows              /* in */
+) {
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(file_handle, &layout);
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(chunk_rows * BMP_row_with_padding_size(width, &layout) * sizeof(unsigned char) + 1);
+
+    /* Every process takes part in as many collective reads as the one with the most chunks */
+    int number_of_chunks = (local_height + chunk_rows - 1) / chunk_rows;
+    MPI_Allreduce(MPI_IN_PLACE, &number_of_chunks, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    for (int chunk = 0; chunk < number_of_chunks; chunk++) {
+        int first = chunk * chunk_rows;
+        int rows = (local_height - first < chunk_rows) ? local_height - first : chunk_rows;
+        if (rows < 0) {
+            rows = 0;
+        }
+        read_BMP_rows(file_handle, &layout, height, width, initial_local_data + first * width, rows, first_row + first, rows_with_padding, 1);
     }
 
-    int start_row = 0;
-    if (process_rank < rest) {
-        start_row = height - (process_rank + 1) * (height_per_process + 1);
-    } else {
-        start_row = height - (process_rank + 1) * height_per_process - rest;
+    release_buffer(rows_with_padding);
+}
+
+void read_luma_strip_from_BMP_file(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    MPI_File *file_handle,          /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    unsigned char *local_luma,      /* out */
+    int luma_row_pitch,             /* in */
+    unsigned char *chroma_blue,     /* out */
+    unsigned char *chroma_red,      /* out */
+    int local_height,               /* in */
+    int first_row,                  /* in */
+    int chunk_rows                  /* in */
+) {
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(file_handle, &layout);
+
+    int row_with_padding_size = BMP_row_with_padding_size(width, &layout);
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(chunk_rows * row_with_padding_size * sizeof(unsigned char) + 1);
+
+    /* Every process takes part in as many collective reads as the one with the most chunks */
+    int number_of_chunks = (local_height + chunk_rows - 1) / chunk_rows;
+    MPI_Allreduce(MPI_IN_PLACE, &number_of_chunks, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    for (int chunk = 0; chunk < number_of_chunks; chunk++) {
+        int first = chunk * chunk_rows;
+        int rows = (local_height - first < chunk_rows) ? local_height - first : chunk_rows;
+        if (rows < 0) {
+            rows = 0;
+        }
+
+        MPI_Status status;
+
+        MPI_File_read_at_all(
+            *file_handle,                                                       /* the file handle */
+            BMP_strip_offset(height, width, first_row + first, rows, &layout),  /* the file offset */
+            rows_with_padding,                                                  /* the initial address of the buffer */
+            rows * row_with_padding_size,                                       /* the number of elements in the buffer */
+            MPI_UNSIGNED_CHAR,                                                  /* the datatype of each buffer element */
+            &status                                                             /* the status object */
+        );
+
+        for (int y = 0; y < rows; y++) {
+            int row = first + (layout.top_down ? y : rows - 1 - y);
+            decode_BMP_row_to_luma(
+                rows_with_padding + y * row_with_padding_size,
+                layout.bytes_per_pixel,
+                local_luma + (size_t)row * luma_row_pitch,
+                chroma_blue ? chroma_blue + (size_t)row * width : NULL,
+                chroma_red ? chroma_red + (size_t)row * width : NULL,
+                width
+            );
+        }
     }
 
-    MPI_Status status;
+    release_buffer(rows_with_padding);
+}
 
-    MPI_Offset file_offset = 54 + start_row * row_with_padding_size;
+void read_decimated_strip_from_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    int factor,                 /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row               /* in */
+) {
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(file_handle, &layout);
 
-    MPI_File_read_at_all(
-        *file_handle,                           /* the file handle */
-        file_offset,                            /* the file offset */
-        rows_with_padding,                      /* the initial address of the buffer */
-        local_height * row_with_padding_size,   /* the number of elements in the buffer */
-        MPI_UNSIGNED_CHAR,                      /* the datatype of each buffer element */
-        &status                                 /* the status object */
+    int bytes_per_pixel = layout.bytes_per_pixel;
+    int row_with_padding_size = BMP_row_with_padding_size(width, &layout);
+    int decimated_width = (width + factor - 1) / factor;
+
+    /* The decimated rows in file order, the topmost one last in bottom-up files */
+    int first_file_row = layout.top_down ? first_row * factor : height - 1 - (first_row + local_height - 1) * factor;
+    if (local_height == 0) {
+        first_file_row = 0;
+    }
+
+    /* Every factor-th pixel of a row, then every factor-th row */
+    MPI_Datatype row_type;
+    MPI_Datatype strip_type;
+    MPI_Type_create_hvector(decimated_width, bytes_per_pixel, (MPI_Aint)factor * bytes_per_pixel, MPI_UNSIGNED_CHAR, &row_type);
+    MPI_Type_create_hvector(local_height, 1, (MPI_Aint)factor * row_with_padding_size, row_type, &strip_type);
+    MPI_Type_commit(&strip_type);
+
+    MPI_File_set_view(
+        *file_handle,
+        layout.data_offset + (MPI_Offset)first_file_row * row_with_padding_size,
+        MPI_UNSIGNED_CHAR,
+        strip_type,
+        "native",
+        MPI_INFO_NULL
+    );
+
+    int row_size = decimated_width * bytes_per_pixel;
+    unsigned char *rows = (unsigned char *)acquire_buffer(local_height * row_size * sizeof(unsigned char) + 1);
+
+    MPI_Status status;
+
+    MPI_File_read_all(
+        *file_handle,               /* the file handle */
+        rows,                       /* the initial address of the buffer */
+        local_height * row_size,    /* the number of elements in the buffer */
+        MPI_UNSIGNED_CHAR,          /* the datatype of each buffer element */
+        &status                     /* the status object */
     );
 
+    MPI_File_set_view(*file_handle, 0, MPI_UNSIGNED_CHAR, MPI_UNSIGNED_CHAR, "native", MPI_INFO_NULL);
+    MPI_Type_free(&strip_type);
+    MPI_Type_free(&row_type);
+
     for (int y = 0; y < local_height; y++) {
-        for (int x = 0; x < width; x++) {
-            initial_local_data[(local_height - 1 - y) * width + x].b = rows_with_padding[y * row_with_padding_size + x * 3];
-            initial_local_data[(local_height - 1 - y) * width + x].g = rows_with_padding[y * row_with_padding_size + x * 3 + 1];
-            initial_local_data[(local_height - 1 - y) * width + x].r = rows_with_padding[y * row_with_padding_size + x * 3 + 2];
-        }
+        int row = layout.top_down ? y : local_height - 1 - y;
+        decode_BMP_row(rows + y * row_size, bytes_per_pixel, initial_local_data + row * decimated_width, decimated_width);
+    }
+
+    release_buffer(rows);
+}
+
+void read_window_from_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *window,                /* out */
+    int first_row,              /* in */
+    int first_column,           /* in */
+    int rows,                   /* in */
+    int columns                 /* in */
+) {
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(file_handle, &layout);
+
+    int bytes_per_pixel = layout.bytes_per_pixel;
+    int row_with_padding_size = BMP_row_with_padding_size(width, &layout);
+
+    /* The pixel data is seen as a height x row size array of bytes, in the file's row order */
+    int sizes[2] = { height, row_with_padding_size };
+    int subsizes[2] = { rows, columns * bytes_per_pixel };
+    int starts[2] = { layout.top_down ? first_row : height - (first_row + rows), first_column * bytes_per_pixel };
+
+    MPI_Datatype window_type;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &window_type);
+    MPI_Type_commit(&window_type);
+
+    MPI_File_set_view(*file_handle, layout.data_offset, MPI_UNSIGNED_CHAR, window_type, "native", MPI_INFO_NULL);
+
+    unsigned char *window_rows = (unsigned char *)acquire_buffer(rows * columns * bytes_per_pixel * sizeof(unsigned char) + 1);
+
+    MPI_Status status;
+
+    MPI_File_read_all(
+        *file_handle,           /* the file handle */
+        window_rows,            /* the initial address of the buffer */
+        rows * columns * bytes_per_pixel,   /* the number of elements in the buffer */
+        MPI_UNSIGNED_CHAR,      /* the datatype of each buffer element */
+        &status                 /* the status object */
+    );
+
+    MPI_File_set_view(*file_handle, 0, MPI_UNSIGNED_CHAR, MPI_UNSIGNED_CHAR, "native", MPI_INFO_NULL);
+    MPI_Type_free(&window_type);
+
+    for (int y = 0; y < rows; y++) {
+        int row = layout.top_down ? y : rows - 1 - y;
+        decode_BMP_row(window_rows + y * columns * bytes_per_pixel, bytes_per_pixel, window + row * columns, columns);
     }
 
-    free(rows_with_padding);
+    release_buffer(window_rows);
+}
+
+int read_rows_from_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *data,                  /* out */
+    int rows,                   /* in */
+    int first_row               /* in */
+) {
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(file_handle, &layout);
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(rows * BMP_row_with_padding_size(width, &layout) * sizeof(unsigned char) + 1);
+
+    int failed = read_BMP_rows(file_handle, &layout, height, width, data, rows, first_row, rows_with_padding, 0);
+
+    release_buffer(rows_with_padding);
+
+    return failed;
+}
+
+int write_BMP_header_to_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const BMPLayout *layout     /* in */
+) {
+    BMPLayout written_layout = layout ? *layout : default_layout;
+    written_layout.data_offset = BMP_HEADER_SIZE;
+
+    return write_BMP_header(file_handle, height, width, &written_layout);
+}
+
+int write_rows_to_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const RGB *data,            /* in */
+    int rows,                   /* in */
+    int first_row,              /* in */
+    const BMPLayout *layout     /* in */
+) {
+    BMPLayout written_layout = layout ? *layout : default_layout;
+    written_layout.data_offset = BMP_HEADER_SIZE;
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(rows * BMP_row_with_padding_size(width, &written_layout) * sizeof(unsigned char) + 1);
+
+    int failed = write_BMP_rows(file_handle, &written_layout, height, width, data, rows, first_row, rows_with_padding, 0);
+
+    release_buffer(rows_with_padding);
+
+    return failed;
 }
 
 void write_local_data_to_BMP_file(
@@ -107,74 +682,252 @@ void write_local_data_to_BMP_file(
     RGB *new_local_data,        /* in */
     int local_height,           /* in */
     int height_per_process,     /* in */
-    int rest                    /* in */
+    int rest,                   /* in */
+    const BMPLayout *layout     /* in */
 ) {
+    int first_row = process_rank * height_per_process + ((process_rank < rest) ? process_rank : rest);
+
+    write_strip_to_BMP_file(
+        process_rank,
+        number_of_processes,
+        file_handle,
+        height,
+        width,
+        new_local_data,
+        local_height,
+        first_row,
+        layout
+    );
+}
+
+void write_strip_to_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *new_local_data,        /* in */
+    int local_height,           /* in */
+    int first_row,              /* in */
+    const BMPLayout *layout     /* in */
+) {
+    /* The pixels follow the 54-byte header whatever the offset of the layout */
+    BMPLayout written_layout = layout ? *layout : default_layout;
+    written_layout.data_offset = BMP_HEADER_SIZE;
+
+    if (process_rank == 0) {
+        write_BMP_header(file_handle, height, width, &written_layout);
+    }
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(local_height * BMP_row_with_padding_size(width, &written_layout) * sizeof(unsigned char) + 1);
+
+    write_BMP_rows(file_handle, &written_layout, height, width, new_local_data, local_height, first_row, rows_with_padding, 1);
+
+    release_buffer(rows_with_padding);
+}
+
+void write_strip_to_BMP_file_in_chunks(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *new_local_data,        /* in */
+    int local_height,           /* in */
+    int first_row,              /* in */
+    int chunk_rows,             /* in */
+    const BMPLayout *layout     /* in */
+) {
+    BMPLayout written_layout = layout ? *layout : default_layout;
+    written_layout.data_offset = BMP_HEADER_SIZE;
+
+    if (process_rank == 0) {
+        write_BMP_header(file_handle, height, width, &written_layout);
+    }
+
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(chunk_rows * BMP_row_with_padding_size(width, &written_layout) * sizeof(unsigned char) + 1);
+
+    int number_of_chunks = (local_height + chunk_rows - 1) / chunk_rows;
+    MPI_Allreduce(MPI_IN_PLACE, &number_of_chunks, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    for (int chunk = 0; chunk < number_of_chunks; chunk++) {
+        int first = chunk * chunk_rows;
+        int rows = (local_height - first < chunk_rows) ? local_height - first : chunk_rows;
+        if (rows < 0) {
+            rows = 0;
+        }
+        write_BMP_rows(file_handle, &written_layout, height, width, new_local_data + first * width, rows, first_row + first, rows_with_padding, 1);
+    }
+
+    release_buffer(rows_with_padding);
+}
+
+void write_luma_and_chroma_strip_to_BMP_file(
+    int process_rank,                       /* in */
+    int number_of_processes,                /* in */
+    MPI_File *file_handle,                  /* in */
+    int height,                             /* in */
+    int width,                              /* in */
+    const unsigned char *new_local_luma,    /* in */
+    const unsigned char *chroma_blue,       /* in */
+    const unsigned char *chroma_red,        /* in */
+    const Epilogue *epilogue,               /* in */
+    int local_height,                       /* in */
+    int first_row,                          /* in */
+    int chunk_rows,                         /* in */
+    const BMPLayout *layout                 /* in */
+) {
+    BMPLayout written_layout = layout ? *layout : default_layout;
+    written_layout.data_offset = BMP_HEADER_SIZE;
+
+    if (process_rank == 0) {
+        write_BMP_header(file_handle, height, width, &written_layout);
+    }
+
+    int has_epilogue = epilogue && epilogue->number_of_stages > 0;
+
+    /* Only one chunk of pixels is ever recombined, the strip staying in its three planes */
+    RGB *pixels = (RGB *)acquire_buffer(chunk_rows * width * sizeof(RGB) + 1);
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(chunk_rows * BMP_row_with_padding_size(width, &written_layout) * sizeof(unsigned char) + 1);
+
+    int number_of_chunks = (local_height + chunk_rows - 1) / chunk_rows;
+    MPI_Allreduce(MPI_IN_PLACE, &number_of_chunks, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    for (int chunk = 0; chunk < number_of_chunks; chunk++) {
+        int first = chunk * chunk_rows;
+        int rows = (local_height - first < chunk_rows) ? local_height - first : chunk_rows;
+        if (rows < 0) {
+            rows = 0;
+        }
+
+        size_t first_pixel = (size_t)first * width;
+        for (int i = 0; i < rows * width; i++) {
+            pixel_of_luma_and_chroma((double)new_local_luma[first_pixel + i], chroma_blue[first_pixel + i], chroma_red[first_pixel + i], &pixels[i]);
+            if (has_epilogue) {
+                apply_epilogue(epilogue, &pixels[i]);
+            }
+        }
+
+        write_BMP_rows(file_handle, &written_layout, height, width, pixels, rows, first_row + first, rows_with_padding, 1);
+    }
+
+    release_buffer(pixels);
+    release_buffer(rows_with_padding);
+}
+
+void write_tile_to_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const RGB *tile,            /* in */
+    int tile_height,            /* in */
+    int tile_width,             /* in */
+    int first_row,              /* in */
+    int first_column,           /* in */
+    const BMPLayout *layout     /* in */
+) {
+    if (!layout) {
+        layout = &default_layout;
+    }
+
+    int bytes_per_pixel = layout->bytes_per_pixel;
+    int row_size = tile_width * bytes_per_pixel;
+
+    unsigned char *rows = (unsigned char *)acquire_buffer(tile_height * row_size * sizeof(unsigned char) + 1);
+
+    for (int y = 0; y < tile_height; y++) {
+        encode_BMP_row(tile + y * tile_width, bytes_per_pixel, rows + y * row_size, tile_width);
+    }
+
+    /* Every tile row is a separate run of bytes in the file, written independently of the other processes */
+    for (int y = 0; y < tile_height; y++) {
+        MPI_Status status;
+
+        MPI_Offset file_offset = BMP_strip_offset(height, width, first_row + y, 1, layout) + first_column * bytes_per_pixel;
+
+        MPI_File_write_at(
+            *file_handle,               /* the file handle */
+            file_offset,                /* the file offset */
+            rows + y * row_size,        /* the initial address of the buffer */
+            row_size,                   /* the number of elements in the buffer */
+            MPI_UNSIGNED_CHAR,          /* the datatype of each buffer element */
+            &status                     /* the status object */
+        );
+    }
+
+    release_buffer(rows);
+}
+
+void write_luma_strip_to_BMP_file(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    MPI_File *file_handle,          /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    unsigned char *new_local_luma,  /* in */
+    int local_height,               /* in */
+    int first_row                   /* in */
+) {
+    /* The 8-bit format needs a palette, here the 256 grays, between the headers and the pixels */
     int header_size = 54;
-    int row_with_padding_size = (width * 3 + 3) & (~3);
-    int file_size = header_size + height * row_with_padding_size;
+    int palette_size = 256 * 4;
+    int row_with_padding_size = (width + 3) & (~3);
+    int file_size = header_size + palette_size + height * row_with_padding_size;
 
     if (process_rank == 0) {
-        unsigned char header[54] = {
+        unsigned char header[54 + 256 * 4] = {
             'B', 'M',       // Signature
             0, 0, 0, 0,     // File Size
             0, 0, 0, 0,     // Reserved
-            54, 0, 0, 0,    // File Offset to Image Data
+            0, 0, 0, 0,     // File Offset to Image Data
             40, 0, 0, 0,    // DIB Header Size
             0, 0, 0, 0,     // Image Width
             0, 0, 0, 0,     // Image Height
             1, 0,           // Color Planes
-            24, 0,          // Bits per Pixel
+            8, 0,           // Bits per Pixel
             0, 0, 0, 0,     // Compression (none)
             0, 0, 0, 0,     // Image Size
             0, 0, 0, 0,     // X Pixels per Meter
             0, 0, 0, 0,     // Y Pixels per Meter
-            0, 0, 0, 0,     // Colors in Color Palette
+            0, 1, 0, 0,     // Colors in Color Palette
             0, 0, 0, 0      // Important Colors Count
         };
 
         *(int *)&header[2] = file_size;
+        *(int *)&header[10] = header_size + palette_size;
         *(int *)&header[18] = width;
         *(int *)&header[22] = height;
 
+        for (int value = 0; value < 256; value++) {
+            header[header_size + value * 4] = (unsigned char)value;
+            header[header_size + value * 4 + 1] = (unsigned char)value;
+            header[header_size + value * 4 + 2] = (unsigned char)value;
+        }
+
         MPI_Status status;
 
         MPI_File_write_at(
-            *file_handle,       /* the file handle */
-            0,                  /* the file offset */
-            header,             /* the initial address of the buffer */
-            header_size,        /* the number of elements in the buffer */
-            MPI_UNSIGNED_CHAR,  /* the datatype of each buffer element */
-            &status             /* the status object */
+            *file_handle,                   /* the file handle */
+            0,                              /* the file offset */
+            header,                         /* the initial address of the buffer */
+            header_size + palette_size,     /* the number of elements in the buffer */
+            MPI_UNSIGNED_CHAR,              /* the datatype of each buffer element */
+            &status                         /* the status object */
         );
     }
 
-    unsigned char *rows_with_padding = (unsigned char *)calloc(local_height * row_with_padding_size, sizeof(unsigned char));
-    if (!rows_with_padding) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fflush(stderr);
-        MPI_File_close(file_handle);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
+    unsigned char *rows_with_padding = (unsigned char *)acquire_buffer(local_height * row_with_padding_size * sizeof(unsigned char) + 1);
 
     for (int y = 0; y < local_height; y++) {
-        for (int x = 0; x < width; x++) {
-            RGB pixel = new_local_data[(local_height - 1 - y) * width + x];
-            rows_with_padding[y * row_with_padding_size + x * 3] = pixel.b;
-            rows_with_padding[y * row_with_padding_size + x * 3 + 1] = pixel.g;
-            rows_with_padding[y * row_with_padding_size + x * 3 + 2] = pixel.r;
-        }
+        memcpy(rows_with_padding + y * row_with_padding_size, new_local_luma + (local_height - 1 - y) * width, width);
+        memset(rows_with_padding + y * row_with_padding_size + width, 0, row_with_padding_size - width);
     }
 
-    int start_row = 0;
-    if (process_rank < rest) {
-        start_row = height - (process_rank + 1) * (height_per_process + 1);
-    } else {
-        start_row = height - (process_rank + 1) * height_per_process - rest;
-    }
+    int start_row = height - (first_row + local_height);
 
     MPI_Status status;
 
-    MPI_Offset file_offset = header_size + start_row * row_with_padding_size;
+    MPI_Offset file_offset = header_size + palette_size + (MPI_Offset)start_row * row_with_padding_size;
 
     MPI_File_write_at_all(
         *file_handle,                           /* the file handle */
@@ -185,5 +938,5 @@ void write_local_data_to_BMP_file(
         &status                                 /* the status object */
     );
 
-    free(rows_with_padding);
+    release_buffer(rows_with_padding);
 }
\ No newline at end of file
@@ -3,6 +3,17 @@
 
 #include "mpi.h"
 #include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/*
+ * Where the pixels of a BMP file start, their size, 3 bytes or 4 with the fourth
+ * one unused, and whether the first stored row is the top one (negative height)
+ */
+typedef struct {
+    int data_offset;
+    int bytes_per_pixel;
+    int top_down;
+} BMPLayout;
 
 void read_image_height_and_width_from_BMP_file(
     int process_rank,           /* in */
@@ -12,6 +23,23 @@ void read_image_height_and_width_from_BMP_file(
     int *image_width            /* out */
 );
 
+/* Reads the pixel layout of a BMP file whose header has been checked; not collective */
+void read_BMP_layout_from_BMP_file(
+    MPI_File *file_handle,      /* in */
+    BMPLayout *layout           /* out */
+);
+
+/*
+ * Reads and checks the header of a BMP file, which must hold all the pixels it describes,
+ * returning 1 instead of aborting when it is not one that can be read; not collective
+ */
+int read_BMP_header_from_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int *image_height,          /* out */
+    int *image_width,           /* out */
+    BMPLayout *layout           /* out */
+);
+
 void read_local_data_from_BMP_file(
     int process_rank,           /* in */
     int number_of_processes,    /* in */
@@ -24,6 +52,124 @@ void read_local_data_from_BMP_file(
     int rest                    /* in */
 );
 
+/* Reads local_height rows starting at row first_row of the image, which may be partitioned in any way */
+void read_strip_from_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row               /* in */
+);
+
+/*
+ * Same as read_strip_from_BMP_file() through a staging buffer of chunk_rows rows
+ * instead of one of the whole strip, for callers short of memory
+ */
+void read_strip_from_BMP_file_in_chunks(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row,              /* in */
+    int chunk_rows              /* in */
+);
+
+/*
+ * Same as read_strip_from_BMP_file_in_chunks() decoding every pixel straight to its luma,
+ * stored luma_row_pitch bytes apart from row to row, and, unless chroma_blue is NULL,
+ * to its chroma, stored width bytes apart, so that no RGB strip is ever held
+ */
+void read_luma_strip_from_BMP_file(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    MPI_File *file_handle,          /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    unsigned char *local_luma,      /* out */
+    int luma_row_pitch,             /* in */
+    unsigned char *chroma_blue,     /* out */
+    unsigned char *chroma_red,      /* out */
+    int local_height,               /* in */
+    int first_row,                  /* in */
+    int chunk_rows                  /* in */
+);
+
+/*
+ * Reads rows first_row to first_row + local_height - 1 of the image decimated by factor,
+ * made of every factor-th pixel of every factor-th row from the top left one, through
+ * a strided file view, so that no other pixel is read; collective
+ */
+void read_decimated_strip_from_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    int factor,                 /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row               /* in */
+);
+
+/*
+ * Reads a window of rows x columns pixels whose top left pixel is at (first_row, first_column)
+ * through a subarray file view, so that no pixel outside the window is read; collective
+ */
+void read_window_from_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *window,                /* out */
+    int first_row,              /* in */
+    int first_column,           /* in */
+    int rows,                   /* in */
+    int columns                 /* in */
+);
+
+/*
+ * Reads rows first_row to first_row + rows - 1 of the image, returning 1 when the file
+ * does not hold them all; not collective, every process reads its own rows
+ */
+int read_rows_from_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *data,                  /* out */
+    int rows,                   /* in */
+    int first_row               /* in */
+);
+
+/* Writes the header of a BMP file of the given size and layout, NULL for 24-bit bottom-up, returning 1 when it fails; not collective */
+int write_BMP_header_to_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const BMPLayout *layout     /* in */
+);
+
+/*
+ * Writes rows first_row to first_row + rows - 1 of the image with the pixel size and row order
+ * of the layout, NULL for 24-bit bottom-up, returning 1 when the write fails; not collective,
+ * the header is written separately
+ */
+int write_rows_to_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const RGB *data,            /* in */
+    int rows,                   /* in */
+    int first_row,              /* in */
+    const BMPLayout *layout     /* in */
+);
+
 void write_local_data_to_BMP_file(
     int process_rank,           /* in */
     int number_of_processes,    /* in */
@@ -33,7 +179,87 @@ void write_local_data_to_BMP_file(
     RGB *new_local_data,        /* in */
     int local_height,           /* in */
     int height_per_process,     /* in */
-    int rest                    /* in */
+    int rest,                   /* in */
+    const BMPLayout *layout     /* in */
+);
+
+/*
+ * Writes local_height rows starting at row first_row of the image, which may be partitioned
+ * in any way, with the pixel size and row order of the layout, 24-bit bottom-up when it is NULL
+ */
+void write_strip_to_BMP_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *new_local_data,        /* in */
+    int local_height,           /* in */
+    int first_row,              /* in */
+    const BMPLayout *layout     /* in */
+);
+
+/* Same as write_strip_to_BMP_file() through a staging buffer of chunk_rows rows */
+void write_strip_to_BMP_file_in_chunks(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *new_local_data,        /* in */
+    int local_height,           /* in */
+    int first_row,              /* in */
+    int chunk_rows,             /* in */
+    const BMPLayout *layout     /* in */
+);
+
+/*
+ * Overwrites the pixels of one tile of an existing BMP file of the given size and layout,
+ * NULL for 24-bit bottom-up, leaving the rest of the file untouched; not collective,
+ * every process patches its own tiles
+ */
+void write_tile_to_BMP_file(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const RGB *tile,            /* in */
+    int tile_height,            /* in */
+    int tile_width,             /* in */
+    int first_row,              /* in */
+    int first_column,           /* in */
+    const BMPLayout *layout     /* in */
+);
+
+/*
+ * Same as write_strip_to_BMP_file_in_chunks() for a strip held as luma and chroma planes,
+ * recombined and finished by the epilogue one chunk at a time
+ */
+void write_luma_and_chroma_strip_to_BMP_file(
+    int process_rank,                       /* in */
+    int number_of_processes,                /* in */
+    MPI_File *file_handle,                  /* in */
+    int height,                             /* in */
+    int width,                              /* in */
+    const unsigned char *new_local_luma,    /* in */
+    const unsigned char *chroma_blue,       /* in */
+    const unsigned char *chroma_red,        /* in */
+    const Epilogue *epilogue,               /* in */
+    int local_height,                       /* in */
+    int first_row,                          /* in */
+    int chunk_rows,                         /* in */
+    const BMPLayout *layout                 /* in */
+);
+
+/* Writes a luma strip like write_strip_to_BMP_file(), as an 8-bit grayscale BMP */
+void write_luma_strip_to_BMP_file(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    MPI_File *file_handle,          /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    unsigned char *new_local_luma,  /* in */
+    int local_height,               /* in */
+    int first_row                   /* in */
 );
 
 #endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "specialized_kernels.h"
+#include "../kernels.h"
+
+/*
+ * Convolves one row. With constant kernel and kernel_size, the loops are unrolled
+ * and every coefficient is folded in, so that the tests on the coefficients vanish.
+ * pair_taps drops the zero taps and adds the pixels of mirrored taps sharing a
+ * coefficient before multiplying; it changes the order of the additions, which is
+ * only harmless for coefficients that keep every partial sum exact.
+ */
+static inline __attribute__((always_inline)) void convolve_row(
+    const RGB *row_with_padding,    /* in */
+    int width_with_padding,         /* in */
+    RGB *new_row,                   /* out */
+    int width,                      /* in */
+    const double *kernel,           /* in */
+    int kernel_size,                /* in */
+    int pair_taps,                  /* in */
+    const Epilogue *epilogue        /* in */
+) {
+    int offset = kernel_size / 2;
+
+    for (int x = 0; x < width; x++) {
+        const RGB *centre = row_with_padding + x;
+
+        double accumulator_b = 0.0;
+        double accumulator_g = 0.0;
+        double accumulator_r = 0.0;
+
+        #pragma GCC unroll 8
+        for (int i = -offset; i <= offset; i++) {
+            const RGB *row = centre + i * width_with_padding;
+            const double *kernel_row = kernel + (i + offset) * kernel_size + offset;
+
+            #pragma GCC unroll 8
+            for (int j = -offset; j <= offset; j++) {
+                double kernel_value = kernel_row[j];
+
+                if (!pair_taps) {
+                    accumulator_b += (double)row[j].b * kernel_value;
+                    accumulator_g += (double)row[j].g * kernel_value;
+                    accumulator_r += (double)row[j].r * kernel_value;
+                } else if (kernel_value == 0.0 || (j > 0 && kernel_row[-j] == kernel_value)) {
+                    continue;
+                } else if (j < 0 && kernel_row[-j] == kernel_value) {
+                    accumulator_b += (double)(row[j].b + row[-j].b) * kernel_value;
+                    accumulator_g += (double)(row[j].g + row[-j].g) * kernel_value;
+                    accumulator_r += (double)(row[j].r + row[-j].r) * kernel_value;
+                } else {
+                    accumulator_b += (double)row[j].b * kernel_value;
+                    accumulator_g += (double)row[j].g * kernel_value;
+                    accumulator_r += (double)row[j].r * kernel_value;
+                }
+            }
+        }
+
+        store_pixel(&new_row[x], accumulator_b, accumulator_g, accumulator_r, epilogue);
+    }
+}
+
+/*
+ * Defines a convolution for the given kernel expression and size. The parallel loop
+ * lives in the generated function, so that a built-in kernel stays a constant in
+ * the outlined loop body rather than a shared variable.
+ */
+#define DEFINE_SPECIALIZED_CONVOLUTION(function_name, kernel_expression, kernel_size, pair_taps)               \
+    static void function_name(                                                                                  \
+        int number_of_threads,                                                                                  \
+        const RGB *data_with_padding,                                                                           \
+        int width_with_padding,                                                                                 \
+        RGB *new_data,                                                                                          \
+        int height,                                                                                             \
+        int width,                                                                                              \
+        const double *kernel,                                                                                   \
+        int padding,                                                                                            \
+        const Epilogue *epilogue                                                                                \
+    ) {                                                                                                         \
+        (void)kernel;                                                                                           \
+        _Pragma("omp parallel for num_threads(number_of_threads) schedule(runtime)")                           \
+        for (int y = 0; y < height; y++) {                                                                      \
+            convolve_row(                                                                                       \
+                data_with_padding + (y + padding) * width_with_padding + padding,                               \
+                width_with_padding,                                                                             \
+                new_data + y * width,                                                                           \
+                width,                                                                                          \
+                kernel_expression,                                                                              \
+                kernel_size,                                                                                    \
+                pair_taps,                                                                                      \
+                epilogue                                                                                        \
+            );                                                                                                  \
+        }                                                                                                       \
+    }
+
+/* Integer and dyadic coefficients keep the sums exact; the ninths of BOX_BLUR_KERNEL do not, so its taps are not paired */
+DEFINE_SPECIALIZED_CONVOLUTION(identity_convolution, IDENTITY_KERNEL, 1, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(ridge_convolution, RIDGE_KERNEL, 3, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(edge_convolution, EDGE_KERNEL, 3, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(sharpen_convolution, SHARPEN_KERNEL, 3, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(sobel_x_convolution, SOBEL_X_KERNEL, 3, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(sobel_y_convolution, SOBEL_Y_KERNEL, 3, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(box_blur_convolution, BOX_BLUR_KERNEL, 3, 0)
+DEFINE_SPECIALIZED_CONVOLUTION(gaussian_blur_3x3_convolution, GAUSSIAN_BLUR_3x3_KERNEL, 3, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(gaussian_blur_5x5_convolution, GAUSSIAN_BLUR_5x5_KERNEL, 5, 1)
+DEFINE_SPECIALIZED_CONVOLUTION(unsharp_masking_5x5_convolution, UNSHARP_MASKING_5x5_KERNEL, 5, 1)
+
+/* Any coefficients, in the order of direct_convolution() */
+DEFINE_SPECIALIZED_CONVOLUTION(convolution_3x3, kernel, 3, 0)
+DEFINE_SPECIALIZED_CONVOLUTION(convolution_5x5, kernel, 5, 0)
+DEFINE_SPECIALIZED_CONVOLUTION(convolution_7x7, kernel, 7, 0)
+
+SpecializedConvolution find_specialized_convolution(
+    const double *kernel,   /* in */
+    int kernel_size         /* in */
+) {
+    static const struct {
+        const double *kernel;
+        int kernel_size;
+        SpecializedConvolution convolution;
+    } built_in_convolutions[] = {
+        { IDENTITY_KERNEL, 1, identity_convolution },
+        { RIDGE_KERNEL, 3, ridge_convolution },
+        { EDGE_KERNEL, 3, edge_convolution },
+        { SHARPEN_KERNEL, 3, sharpen_convolution },
+        { SOBEL_X_KERNEL, 3, sobel_x_convolution },
+        { SOBEL_Y_KERNEL, 3, sobel_y_convolution },
+        { BOX_BLUR_KERNEL, 3, box_blur_convolution },
+        { GAUSSIAN_BLUR_3x3_KERNEL, 3, gaussian_blur_3x3_convolution },
+        { GAUSSIAN_BLUR_5x5_KERNEL, 5, gaussian_blur_5x5_convolution },
+        { UNSHARP_MASKING_5x5_KERNEL, 5, unsharp_masking_5x5_convolution }
+    };
+
+    for (size_t i = 0; i < sizeof(built_in_convolutions) / sizeof(built_in_convolutions[0]); i++) {
+        if (built_in_convolutions[i].kernel_size == kernel_size
+                && memcmp(built_in_convolutions[i].kernel, kernel, kernel_size * kernel_size * sizeof(double)) == 0) {
+            return built_in_convolutions[i].convolution;
+        }
+    }
+
+    switch (kernel_size) {
+        case 3:
+            return convolution_3x3;
+        case 5:
+            return convolution_5x5;
+        case 7:
+            return convolution_7x7;
+        default:
+            return NULL;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef SPECIALIZED_KERNELS_H
+#define SPECIALIZED_KERNELS_H
+
+#include "../bmp_image.h"
+#include "../point_operations/point_operations.h"
+
+/* Direct convolution compiled for one kernel, or for one kernel size whatever the coefficients */
+typedef void (*SpecializedConvolution)(
+    int number_of_threads,
+    const RGB *data_with_padding,
+    int width_with_padding,
+    RGB *new_data,
+    int height,
+    int width,
+    const double *kernel,
+    int padding,
+    const Epilogue *epilogue
+);
+
+/*
+ * Returns the specialization of direct_convolution() for the kernel, or NULL when
+ * there is none. The built-in kernels of kernels.h, recognised by their
+ * coefficients, among them the identity of point operations, get fully unrolled
+ * taps without the zero ones, symmetric taps being added before the
+ * multiplication; 3x3, 5x5 and 7x7 kernels read from files get fully unrolled
+ * taps. Both give the same pixels as direct_convolution().
+ */
+SpecializedConvolution find_specialized_convolution(
+    const double *kernel,
+    int kernel_size
+);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "mpi.h"
+#include "tile_cache.h"
+#include "../shared_file_system_bmp_io/shared_file_system_bmp_io.h"
+#include "../fft_convolution/fft_convolution.h"
+#include "../buffer_pool/buffer_pool.h"
+
+#define MAX_CACHE_FILE_NAME_LENGTH 1024
+
+/* First bytes of a manifest, followed by the image width, height and tile size, then one key per tile */
+#define MANIFEST_MAGIC 0x534c4954
+
+typedef unsigned long long TileKey;
+
+/* Word at a time multiply-rotate hash, finished with the splitmix64 mixer */
+static TileKey hash_bytes(
+    TileKey seed,           /* in */
+    const void *data,       /* in */
+    size_t size             /* in */
+) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    TileKey hash = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        TileKey word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ (word * 0xbf58476d1ce4e5b9ULL)) * 0x94d049bb133111ebULL;
+        hash = (hash << 31) | (hash >> 33);
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+
+    return hash;
+}
+
+static TileKey hash_int(TileKey seed, int value) {
+    return hash_bytes(seed, &value, sizeof(value));
+}
+
+static TileKey hash_double(TileKey seed, double value) {
+    return hash_bytes(seed, &value, sizeof(value));
+}
+
+/* Hashes the fields the operation uses, never the padding bytes of the structure */
+static TileKey hash_operation(
+    const Operation *operation  /* in */
+) {
+    TileKey hash = hash_int(0, (int)operation->type);
+
+    switch (operation->type) {
+        case CONVOLUTION_OPERATION:
+            hash = hash_int(hash, operation->kernel_size);
+            hash = hash_bytes(hash, operation->kernel, operation->kernel_size * operation->kernel_size * sizeof(double));
+            /* The FFT engine may round some pixels the other way */
+            hash = hash_int(hash, operation->kernel_size >= fft_convolution_crossover_kernel_size());
+            break;
+        case BOX_BLUR_OPERATION:
+        case GAUSSIAN_BLUR_OPERATION:
+            hash = hash_int(hash, operation->radius);
+            break;
+        case RANK_FILTER_OPERATION:
+            hash = hash_int(hash, operation->radius);
+            hash = hash_double(hash, operation->percentile);
+            break;
+        case MORPHOLOGY_OPERATION:
+            hash = hash_int(hash, (int)operation->morphology);
+            hash = hash_int(hash, operation->element_width);
+            hash = hash_int(hash, operation->element_height);
+            break;
+        default:
+            break;
+    }
+
+    hash = hash_int(hash, operation->epilogue.number_of_stages);
+    for (int stage = 0; stage < operation->epilogue.number_of_stages; stage++) {
+        const EpilogueStage *epilogue_stage = &operation->epilogue.stages[stage];
+        hash = hash_int(hash, (int)epilogue_stage->type);
+        hash = hash_bytes(hash, epilogue_stage->lookup_table, sizeof(epilogue_stage->lookup_table));
+        hash = hash_bytes(hash, epilogue_stage->color_matrix, sizeof(epilogue_stage->color_matrix));
+    }
+
+    return hash;
+}
+
+int operation_is_tile_local(
+    const Operation *operation  /* in */
+) {
+    switch (operation->type) {
+        case CONVOLUTION_OPERATION:
+        case BOX_BLUR_OPERATION:
+        case GAUSSIAN_BLUR_OPERATION:
+        case RANK_FILTER_OPERATION:
+            return operation->luma_mode == NO_LUMA_MODE;
+        case MORPHOLOGY_OPERATION:
+            /* The second pass of the compound ones replicates its input at the buffer edges, as if they were image borders */
+            return operation->luma_mode == NO_LUMA_MODE && operation->morphology <= DILATE_MORPHOLOGY;
+        default:
+            return 0;
+    }
+}
+
+static void cache_file_name(
+    const char *cache_directory,    /* in */
+    TileKey key,                    /* in */
+    char *file_name,                /* out */
+    size_t file_name_size           /* in */
+) {
+    snprintf(file_name, file_name_size, "%s/%016llx.tile", cache_directory, key);
+}
+
+/* Returns 0 when the cache holds the tile */
+static int load_cached_tile(
+    const char *cache_directory,    /* in */
+    TileKey key,                    /* in */
+    RGB *tile,                      /* out */
+    int number_of_pixels            /* in */
+) {
+    char file_name[MAX_CACHE_FILE_NAME_LENGTH];
+    cache_file_name(cache_directory, key, file_name, sizeof(file_name));
+
+    FILE *file = fopen(file_name, "rb");
+    if (!file) {
+        return 1;
+    }
+
+    size_t read = fread(tile, sizeof(RGB), number_of_pixels, file);
+    int extra = fgetc(file);
+    fclose(file);
+
+    return (read == (size_t)number_of_pixels && extra == EOF) ? 0 : 1;
+}
+
+/* Writes to a file of its own first, so that a reader never sees a partial tile */
+static void store_cached_tile(
+    int process_rank,               /* in */
+    const char *cache_directory,    /* in */
+    TileKey key,                    /* in */
+    const RGB *tile,                /* in */
+    int number_of_pixels            /* in */
+) {
+    char file_name[MAX_CACHE_FILE_NAME_LENGTH];
+    char temporary_file_name[MAX_CACHE_FILE_NAME_LENGTH + 16];
+    cache_file_name(cache_directory, key, file_name, sizeof(file_name));
+    snprintf(temporary_file_name, sizeof(temporary_file_name), "%s.%d", file_name, process_rank);
+
+    FILE *file = fopen(temporary_file_name, "wb");
+    if (!file) {
+        return;
+    }
+
+    size_t written = fwrite(tile, sizeof(RGB), number_of_pixels, file);
+    if (fclose(file) != 0 || written != (size_t)number_of_pixels || rename(temporary_file_name, file_name) != 0) {
+        remove(temporary_file_name);
+    }
+}
+
+/* Returns the tile keys of the manifest if it describes an image of this size, NULL otherwise */
+static TileKey *load_manifest(
+    const char *manifest_file_name, /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    int number_of_tiles             /* in */
+) {
+    FILE *file = fopen(manifest_file_name, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    int header[4];
+    TileKey *keys = (TileKey *)malloc(number_of_tiles * sizeof(TileKey));
+    if (!keys
+            || fread(header, sizeof(int), 4, file) != 4
+            || header[0] != MANIFEST_MAGIC || header[1] != width || header[2] != height || header[3] != CACHE_TILE_SIZE
+            || fread(keys, sizeof(TileKey), number_of_tiles, file) != (size_t)number_of_tiles) {
+        free(keys);
+        keys = NULL;
+    }
+    fclose(file);
+
+    return keys;
+}
+
+static void save_manifest(
+    const char *manifest_file_name, /* in */
+    int height,                     /* in */
+    int width,                      /* in */
+    const TileKey *keys,            /* in */
+    int number_of_tiles             /* in */
+) {
+    int header[4] = { MANIFEST_MAGIC, width, height, CACHE_TILE_SIZE };
+
+    FILE *file = fopen(manifest_file_name, "wb");
+    if (!file
+            || fwrite(header, sizeof(int), 4, file) != 4
+            || fwrite(keys, sizeof(TileKey), number_of_tiles, file) != (size_t)number_of_tiles
+            || fclose(file) != 0) {
+        fprintf(stderr, "Error: Cannot write the tile manifest %s\n", manifest_file_name);
+        fflush(stderr);
+    }
+}
+
+/* Returns 1 when the file is a 24-bit BMP of the given size */
+static int output_matches(
+    const char *file_name,  /* in */
+    int height,             /* in */
+    int width               /* in */
+) {
+    unsigned char header[54];
+
+    FILE *file = fopen(file_name, "rb");
+    if (!file) {
+        return 0;
+    }
+    size_t read = fread(header, 1, sizeof(header), file);
+    fclose(file);
+
+    return read == sizeof(header) && header[0] == 'B' && header[1] == 'M'
+        && *(int *)&header[18] == width && *(int *)&header[22] == height && *(short *)&header[28] == 24;
+}
+
+void process_incrementally(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    const char *in_file_name,       /* in */
+    const char *out_file_name,      /* in */
+    const char *cache_directory     /* in */
+) {
+    double start_time = MPI_Wtime();
+
+    MPI_File in_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", in_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int height;
+    int width;
+    read_image_height_and_width_from_BMP_file(process_rank, number_of_processes, &in_file_handle, &height, &width);
+
+    /* Strips are made of whole tile rows */
+    int tile_rows = (height + CACHE_TILE_SIZE - 1) / CACHE_TILE_SIZE;
+    int tile_columns = (width + CACHE_TILE_SIZE - 1) / CACHE_TILE_SIZE;
+    int number_of_tiles = tile_rows * tile_columns;
+
+    int tile_rows_per_process = tile_rows / number_of_processes;
+    int rest = tile_rows % number_of_processes;
+    int local_tile_rows = tile_rows_per_process + ((process_rank < rest) ? 1 : 0);
+    int first_tile_row = process_rank * tile_rows_per_process + ((process_rank < rest) ? process_rank : rest);
+
+    int first_row = first_tile_row * CACHE_TILE_SIZE;
+    int last_row = (first_tile_row + local_tile_rows) * CACHE_TILE_SIZE;
+    if (last_row > height) {
+        last_row = height;
+    }
+    int local_height = last_row - first_row;
+
+    int padding = operation_padding(operation, height);
+
+    int shortest_strip = local_height;
+    MPI_Allreduce(MPI_IN_PLACE, &shortest_strip, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (shortest_strip < 1 || padding > shortest_strip) {
+        if (process_rank == 0) {
+            fprintf(stdout, "Error: Every process needs a strip of %d-row tiles at least as high as the %d rows halo, use fewer processes\n", CACHE_TILE_SIZE, padding);
+            fflush(stdout);
+        }
+        MPI_File_close(&in_file_handle);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    RGB *local_data = (RGB *)acquire_image_buffer((local_height * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+    read_strip_from_BMP_file(process_rank, number_of_processes, &in_file_handle, height, width, local_data, local_height, first_row);
+    MPI_File_close(&in_file_handle);
+
+    RGB *local_data_with_padding;
+    int local_height_with_padding;
+    int width_with_padding;
+
+    add_padding_to_data(number_of_threads, local_data, local_height, width, padding, &local_data_with_padding, &local_height_with_padding, &width_with_padding);
+    release_buffer(local_data);
+
+    exchange_frontiers(process_rank, number_of_processes, local_data_with_padding, local_height_with_padding, width_with_padding, padding, MPI_COMM_WORLD);
+
+    if (operation_replicates_borders(operation)) {
+        replicate_border_padding(process_rank, number_of_processes, local_data_with_padding, local_height_with_padding, width_with_padding, padding);
+    }
+
+    if (process_rank == 0) {
+        if (mkdir(cache_directory, 0777) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Error: Cannot create the tile cache %s\n", cache_directory);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+
+    /* Rank 0 decides whether the output can be patched and shares the keys of its tiles */
+    char manifest_file_name[MAX_CACHE_FILE_NAME_LENGTH];
+    snprintf(manifest_file_name, sizeof(manifest_file_name), "%s.tiles", out_file_name);
+
+    TileKey *keys = (TileKey *)malloc(number_of_tiles * sizeof(TileKey));
+    TileKey *previous_keys = NULL;
+    int patch = 0;
+    if (!keys) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (process_rank == 0 && output_matches(out_file_name, height, width)) {
+        previous_keys = load_manifest(manifest_file_name, height, width, number_of_tiles);
+        patch = (previous_keys != NULL);
+    }
+
+    MPI_Bcast(&patch, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (patch) {
+        if (process_rank != 0) {
+            previous_keys = (TileKey *)malloc(number_of_tiles * sizeof(TileKey));
+            if (!previous_keys) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                fflush(stderr);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+        }
+        MPI_Bcast(previous_keys, number_of_tiles, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    }
+
+    MPI_File out_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, out_file_name, patch ? MPI_MODE_WRONLY : (MPI_MODE_CREATE | MPI_MODE_WRONLY), MPI_INFO_NULL, &out_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", out_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    TileKey operation_key = hash_operation(operation);
+
+    int tile_size_with_padding = CACHE_TILE_SIZE + 2 * padding;
+    RGB *tile_with_padding = (RGB *)acquire_buffer((tile_size_with_padding * tile_size_with_padding + 1) * sizeof(RGB));
+    RGB *tile = (RGB *)acquire_buffer((CACHE_TILE_SIZE * CACHE_TILE_SIZE + 1) * sizeof(RGB));
+    RGB *new_local_data = patch ? NULL : (RGB *)acquire_buffer((local_height * width + 1) * sizeof(RGB));
+
+    /* Unchanged, cached and computed tiles */
+    int counts[3] = { 0, 0, 0 };
+
+    for (int tile_row = first_tile_row; tile_row < first_tile_row + local_tile_rows; tile_row++) {
+        for (int tile_column = 0; tile_column < tile_columns; tile_column++) {
+            int tile_first_row = tile_row * CACHE_TILE_SIZE;
+            int tile_first_column = tile_column * CACHE_TILE_SIZE;
+            int tile_height = (height - tile_first_row < CACHE_TILE_SIZE) ? height - tile_first_row : CACHE_TILE_SIZE;
+            int tile_width = (width - tile_first_column < CACHE_TILE_SIZE) ? width - tile_first_column : CACHE_TILE_SIZE;
+            int tile_height_with_padding = tile_height + 2 * padding;
+            int tile_width_with_padding = tile_width + 2 * padding;
+
+            /* The halo comes along, so that the key covers every pixel the tile's output depends on */
+            for (int y = 0; y < tile_height_with_padding; y++) {
+                memcpy(
+                    tile_with_padding + y * tile_width_with_padding,
+                    local_data_with_padding + (tile_first_row - first_row + y) * width_with_padding + tile_first_column,
+                    tile_width_with_padding * sizeof(RGB)
+                );
+            }
+
+            TileKey key = hash_int(hash_int(operation_key, tile_height), tile_width);
+            key = hash_bytes(key, tile_with_padding, tile_height_with_padding * tile_width_with_padding * sizeof(RGB));
+
+            int index = tile_row * tile_columns + tile_column;
+            keys[index] = key;
+
+            if (patch && previous_keys[index] == key) {
+                counts[0]++;
+                continue;
+            }
+
+            if (load_cached_tile(cache_directory, key, tile, tile_height * tile_width) == 0) {
+                counts[1]++;
+            } else {
+                apply_operation(
+                    number_of_threads,
+                    operation,
+                    tile_with_padding,
+                    tile_height_with_padding,
+                    tile_width_with_padding,
+                    tile,
+                    tile_height,
+                    tile_width,
+                    padding,
+                    tile_first_row,
+                    height,
+                    MPI_COMM_SELF
+                );
+                store_cached_tile(process_rank, cache_directory, key, tile, tile_height * tile_width);
+                counts[2]++;
+            }
+
+            if (patch) {
+                write_tile_to_BMP_file(&out_file_handle, height, width, tile, tile_height, tile_width, tile_first_row, tile_first_column, NULL);
+            } else {
+                for (int y = 0; y < tile_height; y++) {
+                    memcpy(
+                        new_local_data + (tile_first_row - first_row + y) * width + tile_first_column,
+                        tile + y * tile_width,
+                        tile_width * sizeof(RGB)
+                    );
+                }
+            }
+        }
+    }
+
+    if (!patch) {
+        int row_with_padding_size = (width * 3 + 3) & (~3);
+        MPI_File_set_size(out_file_handle, 54 + (MPI_Offset)height * row_with_padding_size);
+        write_strip_to_BMP_file(process_rank, number_of_processes, &out_file_handle, height, width, new_local_data, local_height, first_row, NULL);
+    }
+
+    MPI_File_close(&out_file_handle);
+
+    /* Every process filled in the keys of its own tile rows */
+    int *receive_counts = (int *)malloc(number_of_processes * sizeof(int));
+    int *displacements = (int *)malloc(number_of_processes * sizeof(int));
+    if (!receive_counts || !displacements) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (int i = 0; i < number_of_processes; i++) {
+        receive_counts[i] = (tile_rows_per_process + ((i < rest) ? 1 : 0)) * tile_columns;
+        displacements[i] = (i * tile_rows_per_process + ((i < rest) ? i : rest)) * tile_columns;
+    }
+
+    MPI_Gatherv(
+        (process_rank == 0) ? MPI_IN_PLACE : keys + first_tile_row * tile_columns,
+        local_tile_rows * tile_columns,
+        MPI_UNSIGNED_LONG_LONG,
+        keys,
+        receive_counts,
+        displacements,
+        MPI_UNSIGNED_LONG_LONG,
+        0,
+        MPI_COMM_WORLD
+    );
+
+    MPI_Reduce((process_rank == 0) ? MPI_IN_PLACE : counts, counts, 3, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (process_rank == 0) {
+        save_manifest(manifest_file_name, height, width, keys, number_of_tiles);
+
+        fprintf(stdout, "\n%d tiles of %dx%d pixels: %d unchanged, %d from the cache, %d computed\n", number_of_tiles, CACHE_TILE_SIZE, CACHE_TILE_SIZE, counts[0], counts[1], counts[2]);
+        fprintf(stdout, "%s %s in %f seconds\n", patch ? "Patched" : "Wrote", out_file_name, MPI_Wtime() - start_time);
+        fflush(stdout);
+    }
+
+    free(receive_counts);
+    free(displacements);
+    free(keys);
+    free(previous_keys);
+    release_buffer(local_data_with_padding);
+    release_buffer(tile_with_padding);
+    release_buffer(tile);
+    release_buffer(new_local_data);
+}
\ No newline at end of file
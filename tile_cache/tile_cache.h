@@ -0,0 +1,34 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <stddef.h>
+#include "../operations/operations.h"
+
+/* Side of the square tiles the incremental mode caches, in pixels */
+#define CACHE_TILE_SIZE 128
+
+/* Returns 1 when every output pixel of the operation only depends on its padding neighbourhood */
+int operation_is_tile_local(
+    const Operation *operation
+);
+
+/*
+ * Applies the operation tile by tile. Every tile is keyed by a hash of its input
+ * pixels, its halo and the operation, and its output is looked up in the cache
+ * directory before being computed. A manifest next to the output file, output
+ * file name plus ".tiles", records the key of every tile written; when the output
+ * already matches the input's size, only the tiles whose key changed are patched
+ * into it, otherwise the whole output is rewritten. Tile rows are shared among
+ * the processes, and the caller has checked operation_is_tile_local().
+ */
+void process_incrementally(
+    int process_rank,
+    int number_of_processes,
+    int number_of_threads,
+    const Operation *operation,
+    const char *in_file_name,
+    const char *out_file_name,
+    const char *cache_directory
+);
+
+#endif
\ No newline at end of file
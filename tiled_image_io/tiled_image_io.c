@@ -0,0 +1,702 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <omp.h>
+#include "tiled_image_io.h"
+#include "../lz_codec/lz_codec.h"
+#include "../buffer_pool/buffer_pool.h"
+
+#define TILED_IMAGE_HEADER_SIZE 16
+
+/* Largest tile side a file may declare, so that the bytes of a tile always fit an int */
+#define MAX_TILE_SIZE 4096
+
+/* Bands of tiles are read and written in calls of at most this many bytes, MPI-IO counts being ints */
+#define MAX_TRANSFER_SIZE ((long long)1 << 30)
+
+int is_tiled_image_file_name(
+    const char *file_name   /* in */
+) {
+    size_t length = strlen(file_name);
+    size_t extension_length = strlen(TILED_IMAGE_FILE_EXTENSION);
+    return length > extension_length && strcmp(file_name + length - extension_length, TILED_IMAGE_FILE_EXTENSION) == 0;
+}
+
+static void encode_header(
+    unsigned char *header,  /* out */
+    int height,             /* in */
+    int width,              /* in */
+    int tile_size           /* in */
+) {
+    memcpy(header, "TLZ1", 4);
+    memcpy(header + 4, &width, sizeof(int));
+    memcpy(header + 8, &height, sizeof(int));
+    memcpy(header + 12, &tile_size, sizeof(int));
+}
+
+/* Returns 1 when the header is not the one of a tiled image file */
+static int decode_header(
+    const unsigned char *header,    /* in */
+    int *height,                    /* out */
+    int *width,                     /* out */
+    int *tile_size                  /* out */
+) {
+    if (memcmp(header, "TLZ1", 4) != 0) {
+        return 1;
+    }
+    memcpy(width, header + 4, sizeof(int));
+    memcpy(height, header + 8, sizeof(int));
+    memcpy(tile_size, header + 12, sizeof(int));
+    if (*width < 1 || *height < 1 || *tile_size < 1 || *tile_size > MAX_TILE_SIZE) {
+        return 1;
+    }
+
+    /* The offsets of every tile and of the end must fit an int count of long longs */
+    long long number_of_tiles = (long long)((*height - 1) / *tile_size + 1) * ((*width - 1) / *tile_size + 1);
+    return (number_of_tiles >= INT_MAX / (int)sizeof(long long)) ? 1 : 0;
+}
+
+/* File offset of the first tile, right after the header and the offsets of every tile and of the end */
+static MPI_Offset first_tile_offset(
+    int number_of_tiles     /* in */
+) {
+    return TILED_IMAGE_HEADER_SIZE + ((MPI_Offset)number_of_tiles + 1) * sizeof(long long);
+}
+
+/* Tile rows shared among the processes like the rows of the strips */
+static void tile_row_band(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int tile_rows,              /* in */
+    int *first_tile_row,        /* out */
+    int *number_of_tile_rows    /* out */
+) {
+    int tile_rows_per_process = tile_rows / number_of_processes;
+    int rest = tile_rows % number_of_processes;
+    *number_of_tile_rows = tile_rows_per_process + ((process_rank < rest) ? 1 : 0);
+    *first_tile_row = process_rank * tile_rows_per_process + ((process_rank < rest) ? process_rank : rest);
+}
+
+/* Image rows covered by a band of tile rows, the last tile row being cut by the bottom of the image */
+static void tile_row_band_rows(
+    int first_tile_row,         /* in */
+    int number_of_tile_rows,    /* in */
+    int tile_size,              /* in */
+    int height,                 /* in */
+    int *band_first_row,        /* out */
+    int *band_rows              /* out */
+) {
+    int last_row = (first_tile_row + number_of_tile_rows) * tile_size;
+    if (last_row > height) {
+        last_row = height;
+    }
+    *band_first_row = first_tile_row * tile_size;
+    *band_rows = (last_row > *band_first_row) ? last_row - *band_first_row : 0;
+}
+
+/*
+ * Compresses the tiles of number_of_rows whole image rows, which start on a tile row,
+ * each into its own slot of lz_compress_bound() of a full tile bytes; a tile that does
+ * not shrink is stored raw, which its size tells apart
+ */
+static void compress_tiles(
+    int number_of_threads,      /* in */
+    const RGB *rows,            /* in */
+    int number_of_rows,         /* in */
+    int width,                  /* in */
+    int tile_size,              /* in */
+    unsigned char *slots,       /* out */
+    long long *sizes            /* out */
+) {
+    int tile_columns = (width + tile_size - 1) / tile_size;
+    int tile_rows = (number_of_rows + tile_size - 1) / tile_size;
+    int slot_size = lz_compress_bound(tile_size * tile_size * 3);
+
+    unsigned char *tiles = (unsigned char *)acquire_buffer((size_t)number_of_threads * tile_size * tile_size * 3);
+
+    #pragma omp parallel for num_threads(number_of_threads) schedule(dynamic, 1)
+    for (int tile = 0; tile < tile_rows * tile_columns; tile++) {
+        unsigned char *tile_bytes = tiles + (size_t)omp_get_thread_num() * tile_size * tile_size * 3;
+        unsigned char *slot = slots + (size_t)tile * slot_size;
+
+        int first_row = (tile / tile_columns) * tile_size;
+        int first_column = (tile % tile_columns) * tile_size;
+        int tile_height = (number_of_rows - first_row < tile_size) ? number_of_rows - first_row : tile_size;
+        int tile_width = (width - first_column < tile_size) ? width - first_column : tile_size;
+        int tile_bytes_size = tile_height * tile_width * 3;
+
+        for (int y = 0; y < tile_height; y++) {
+            memcpy(tile_bytes + y * tile_width * 3, rows + (size_t)(first_row + y) * width + first_column, tile_width * 3);
+        }
+
+        int size = lz_compress(tile_bytes, tile_bytes_size, slot);
+        if (size >= tile_bytes_size) {
+            memcpy(slot, tile_bytes, tile_bytes_size);
+            size = tile_bytes_size;
+        }
+        sizes[tile] = size;
+    }
+
+    release_buffer(tiles);
+}
+
+/*
+ * Returns 0 when the offsets of the tiles of number_of_rows whole image rows, and of the end,
+ * go from first_offset or later up to end_offset at most, every tile taking more than no
+ * bytes and no more than its decoded size, so that decompress_tiles() stays within the data
+ */
+static int check_tile_offsets(
+    const long long *offsets,   /* in */
+    int number_of_rows,         /* in */
+    int width,                  /* in */
+    int tile_size,              /* in */
+    long long first_offset,     /* in */
+    long long end_offset        /* in */
+) {
+    int tile_columns = (width + tile_size - 1) / tile_size;
+    int tile_rows = (number_of_rows + tile_size - 1) / tile_size;
+
+    if (offsets[0] < first_offset || offsets[0] > end_offset) {
+        return 1;
+    }
+
+    for (int tile = 0; tile < tile_rows * tile_columns; tile++) {
+        int first_row = (tile / tile_columns) * tile_size;
+        int first_column = (tile % tile_columns) * tile_size;
+        int tile_height = (number_of_rows - first_row < tile_size) ? number_of_rows - first_row : tile_size;
+        int tile_width = (width - first_column < tile_size) ? width - first_column : tile_size;
+
+        /* Both offsets are between first_offset and end_offset, so their difference cannot overflow */
+        if (offsets[tile + 1] <= offsets[tile] || offsets[tile + 1] > end_offset || offsets[tile + 1] - offsets[tile] > tile_height * tile_width * 3) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Decodes the tiles of number_of_rows whole image rows, tile t found at offsets[t] - offsets[0] in data; returns the number of corrupt tiles */
+static int decompress_tiles(
+    int number_of_threads,      /* in */
+    const unsigned char *data,  /* in */
+    const long long *offsets,   /* in */
+    RGB *rows,                  /* out */
+    int number_of_rows,         /* in */
+    int width,                  /* in */
+    int tile_size               /* in */
+) {
+    int tile_columns = (width + tile_size - 1) / tile_size;
+    int tile_rows = (number_of_rows + tile_size - 1) / tile_size;
+    int corrupt_tiles = 0;
+
+    unsigned char *tiles = (unsigned char *)acquire_buffer((size_t)number_of_threads * tile_size * tile_size * 3);
+
+    #pragma omp parallel for num_threads(number_of_threads) reduction(+:corrupt_tiles) schedule(dynamic, 1)
+    for (int tile = 0; tile < tile_rows * tile_columns; tile++) {
+        unsigned char *tile_bytes = tiles + (size_t)omp_get_thread_num() * tile_size * tile_size * 3;
+
+        int first_row = (tile / tile_columns) * tile_size;
+        int first_column = (tile % tile_columns) * tile_size;
+        int tile_height = (number_of_rows - first_row < tile_size) ? number_of_rows - first_row : tile_size;
+        int tile_width = (width - first_column < tile_size) ? width - first_column : tile_size;
+        int tile_bytes_size = tile_height * tile_width * 3;
+
+        const unsigned char *compressed = data + (offsets[tile] - offsets[0]);
+        long long compressed_size = offsets[tile + 1] - offsets[tile];
+
+        if (compressed_size == tile_bytes_size) {
+            memcpy(tile_bytes, compressed, tile_bytes_size);
+        } else if (compressed_size <= 0 || compressed_size > tile_bytes_size
+                || lz_decompress(compressed, (int)compressed_size, tile_bytes, tile_bytes_size)) {
+            corrupt_tiles++;
+            continue;
+        }
+
+        for (int y = 0; y < tile_height; y++) {
+            memcpy(rows + (size_t)(first_row + y) * width + first_column, tile_bytes + y * tile_width * 3, tile_width * 3);
+        }
+    }
+
+    release_buffer(tiles);
+
+    return corrupt_tiles;
+}
+
+/* Moves the slots of the compressed tiles next to each other, returns their total size */
+static long long pack_tiles(
+    unsigned char *slots,       /* in / out */
+    const long long *sizes,     /* in */
+    int number_of_tiles,        /* in */
+    int tile_size               /* in */
+) {
+    int slot_size = lz_compress_bound(tile_size * tile_size * 3);
+    long long packed_size = 0;
+    for (int tile = 0; tile < number_of_tiles; tile++) {
+        memmove(slots + packed_size, slots + (size_t)tile * slot_size, sizes[tile]);
+        packed_size += sizes[tile];
+    }
+    return packed_size;
+}
+
+/*
+ * Reads or writes size bytes at offset in calls of at most MAX_TRANSFER_SIZE bytes, every
+ * process making as many calls as the one with the most bytes; collective
+ */
+static void transfer_band_at_all(
+    MPI_File *file_handle,      /* in */
+    MPI_Offset offset,          /* in */
+    unsigned char *buffer,      /* in / out */
+    long long size,             /* in */
+    int writing                 /* in */
+) {
+    long long number_of_transfers = (size + MAX_TRANSFER_SIZE - 1) / MAX_TRANSFER_SIZE;
+    MPI_Allreduce(MPI_IN_PLACE, &number_of_transfers, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+
+    MPI_Status status;
+
+    for (long long transfer = 0; transfer < number_of_transfers; transfer++) {
+        long long first = transfer * MAX_TRANSFER_SIZE;
+        long long count = (size - first < MAX_TRANSFER_SIZE) ? size - first : MAX_TRANSFER_SIZE;
+        if (count < 0) {
+            count = 0;
+        }
+
+        if (writing) {
+            MPI_File_write_at_all(*file_handle, offset + first, buffer + first, (int)count, MPI_UNSIGNED_CHAR, &status);
+        } else {
+            MPI_File_read_at_all(*file_handle, offset + first, buffer + first, (int)count, MPI_UNSIGNED_CHAR, &status);
+        }
+    }
+}
+
+/*
+ * Moves rows from one partition of the image rows among the processes to another,
+ * every process giving the rows it holds in the first and getting those of the second
+ */
+static void redistribute_rows(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int width,                  /* in */
+    const RGB *source,          /* in */
+    int source_first_row,       /* in */
+    int source_rows,            /* in */
+    RGB *destination,           /* out */
+    int destination_first_row,  /* in */
+    int destination_rows        /* in */
+) {
+    int local_partitions[4] = { source_first_row, source_rows, destination_first_row, destination_rows };
+    int *partitions = (int *)malloc(number_of_processes * 4 * sizeof(int));
+    int *counts = (int *)malloc(number_of_processes * 4 * sizeof(int));
+    if (!partitions || !counts) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    MPI_Allgather(local_partitions, 4, MPI_INT, partitions, 4, MPI_INT, MPI_COMM_WORLD);
+
+    int *send_counts = counts;
+    int *send_displacements = counts + number_of_processes;
+    int *receive_counts = counts + 2 * number_of_processes;
+    int *receive_displacements = counts + 3 * number_of_processes;
+
+    /* Counts are in rows, whose bytes overflow an int for bands of 2 GiB */
+    MPI_Datatype row_type;
+    MPI_Type_contiguous(width * (int)sizeof(RGB), MPI_BYTE, &row_type);
+    MPI_Type_commit(&row_type);
+
+    for (int peer = 0; peer < number_of_processes; peer++) {
+        const int *partition = partitions + peer * 4;
+
+        /* Rows of this process going to the peer */
+        int first = (source_first_row > partition[2]) ? source_first_row : partition[2];
+        int last = (source_first_row + source_rows < partition[2] + partition[3]) ? source_first_row + source_rows : partition[2] + partition[3];
+        send_counts[peer] = (last > first) ? last - first : 0;
+        send_displacements[peer] = (last > first) ? first - source_first_row : 0;
+
+        /* Rows of the peer coming to this process */
+        first = (partition[0] > destination_first_row) ? partition[0] : destination_first_row;
+        last = (partition[0] + partition[1] < destination_first_row + destination_rows) ? partition[0] + partition[1] : destination_first_row + destination_rows;
+        receive_counts[peer] = (last > first) ? last - first : 0;
+        receive_displacements[peer] = (last > first) ? first - destination_first_row : 0;
+    }
+
+    MPI_Alltoallv(
+        source, send_counts, send_displacements, row_type,
+        destination, receive_counts, receive_displacements, row_type,
+        MPI_COMM_WORLD
+    );
+
+    MPI_Type_free(&row_type);
+
+    free(partitions);
+    free(counts);
+}
+
+void read_image_height_and_width_from_tiled_image_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int *image_height,          /* out */
+    int *image_width            /* out */
+) {
+    unsigned char header[TILED_IMAGE_HEADER_SIZE];
+    int tile_size;
+
+    MPI_Status status;
+    MPI_File_read_at_all(*file_handle, 0, header, TILED_IMAGE_HEADER_SIZE, MPI_UNSIGNED_CHAR, &status);
+
+    if (decode_header(header, image_height, image_width, &tile_size)) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error: Not a valid tiled image file\n");
+            fflush(stderr);
+        }
+        MPI_File_close(file_handle);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+}
+
+int read_header_from_tiled_image_file(
+    MPI_File *file_handle,      /* in */
+    int *image_height,          /* out */
+    int *image_width            /* out */
+) {
+    unsigned char header[TILED_IMAGE_HEADER_SIZE];
+    int tile_size;
+
+    MPI_Status status;
+    int count = 0;
+    if (MPI_File_read_at(*file_handle, 0, header, TILED_IMAGE_HEADER_SIZE, MPI_UNSIGNED_CHAR, &status) != MPI_SUCCESS
+            || MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &count) != MPI_SUCCESS || count != TILED_IMAGE_HEADER_SIZE) {
+        return 1;
+    }
+
+    if (decode_header(header, image_height, image_width, &tile_size)) {
+        return 1;
+    }
+
+    /* The offsets of every tile and of the end must all be in the file */
+    int number_of_tiles = ((*image_height + tile_size - 1) / tile_size) * ((*image_width + tile_size - 1) / tile_size);
+    MPI_Offset file_size;
+    if (MPI_File_get_size(*file_handle, &file_size) != MPI_SUCCESS) {
+        return 1;
+    }
+
+    return first_tile_offset(number_of_tiles) > file_size;
+}
+
+void read_strip_from_tiled_image_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int number_of_threads,      /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row               /* in */
+) {
+    unsigned char header[TILED_IMAGE_HEADER_SIZE];
+    int file_height;
+    int file_width;
+    int tile_size;
+
+    MPI_Status status;
+    MPI_File_read_at_all(*file_handle, 0, header, TILED_IMAGE_HEADER_SIZE, MPI_UNSIGNED_CHAR, &status);
+
+    if (decode_header(header, &file_height, &file_width, &tile_size) || file_height != height || file_width != width) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error: Not a valid tiled image file\n");
+            fflush(stderr);
+        }
+        MPI_File_close(file_handle);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        return;
+    }
+
+    int tile_rows = (height + tile_size - 1) / tile_size;
+    int tile_columns = (width + tile_size - 1) / tile_size;
+
+    int first_tile_row;
+    int number_of_tile_rows;
+    tile_row_band(process_rank, number_of_processes, tile_rows, &first_tile_row, &number_of_tile_rows);
+
+    int band_first_row;
+    int band_rows;
+    tile_row_band_rows(first_tile_row, number_of_tile_rows, tile_size, height, &band_first_row, &band_rows);
+    int first_tile = first_tile_row * tile_columns;
+    int number_of_tiles = number_of_tile_rows * tile_columns;
+
+    long long *offsets = (long long *)malloc((number_of_tiles + 1) * sizeof(long long));
+    if (!offsets) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    MPI_File_read_at_all(
+        *file_handle,
+        TILED_IMAGE_HEADER_SIZE + (MPI_Offset)first_tile * sizeof(long long),
+        offsets,
+        (number_of_tiles + 1) * sizeof(long long),
+        MPI_BYTE,
+        &status
+    );
+
+    MPI_Offset file_size = 0;
+    MPI_File_get_size(*file_handle, &file_size);
+
+    if (check_tile_offsets(offsets, band_rows, width, tile_size, first_tile_offset(tile_rows * tile_columns), file_size)) {
+        fprintf(stderr, "Error: Corrupt tile offsets in tile rows %d to %d\n", first_tile_row, first_tile_row + number_of_tile_rows - 1);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* The tiles of a band of tile rows are contiguous in the file */
+    long long compressed_size = offsets[number_of_tiles] - offsets[0];
+    unsigned char *compressed = (unsigned char *)acquire_buffer(compressed_size + 1);
+
+    transfer_band_at_all(file_handle, offsets[0], compressed, compressed_size, 0);
+
+    RGB *band = (RGB *)acquire_image_buffer(((size_t)band_rows * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+
+    if (decompress_tiles(number_of_threads, compressed, offsets, band, band_rows, width, tile_size) > 0) {
+        fprintf(stderr, "Error: Corrupt tiles in tile rows %d to %d\n", first_tile_row, first_tile_row + number_of_tile_rows - 1);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    release_buffer(compressed);
+    free(offsets);
+
+    redistribute_rows(
+        process_rank,
+        number_of_processes,
+        width,
+        band,
+        band_first_row,
+        band_rows,
+        initial_local_data,
+        first_row,
+        local_height
+    );
+
+    release_buffer(band);
+}
+
+void write_strip_to_tiled_image_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int number_of_threads,      /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const RGB *new_local_data,  /* in */
+    int local_height,           /* in */
+    int first_row               /* in */
+) {
+    int tile_size = TILED_IMAGE_TILE_SIZE;
+    int tile_rows = (height + tile_size - 1) / tile_size;
+    int tile_columns = (width + tile_size - 1) / tile_size;
+    int total_number_of_tiles = tile_rows * tile_columns;
+
+    int first_tile_row;
+    int number_of_tile_rows;
+    tile_row_band(process_rank, number_of_processes, tile_rows, &first_tile_row, &number_of_tile_rows);
+
+    int band_first_row;
+    int band_rows;
+    tile_row_band_rows(first_tile_row, number_of_tile_rows, tile_size, height, &band_first_row, &band_rows);
+    int first_tile = first_tile_row * tile_columns;
+    int number_of_tiles = number_of_tile_rows * tile_columns;
+
+    RGB *band = (RGB *)acquire_image_buffer(((size_t)band_rows * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+
+    redistribute_rows(
+        process_rank,
+        number_of_processes,
+        width,
+        new_local_data,
+        first_row,
+        local_height,
+        band,
+        band_first_row,
+        band_rows
+    );
+
+    unsigned char *slots = (unsigned char *)acquire_buffer((size_t)number_of_tiles * lz_compress_bound(tile_size * tile_size * 3) + 1);
+    long long *sizes = (long long *)malloc((number_of_tiles + 1) * sizeof(long long));
+    long long *offsets = (long long *)malloc((number_of_tiles + 1) * sizeof(long long));
+    if (!sizes || !offsets) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    compress_tiles(number_of_threads, band, band_rows, width, tile_size, slots, sizes);
+    release_buffer(band);
+
+    long long packed_size = pack_tiles(slots, sizes, number_of_tiles, tile_size);
+
+    /* The tiles of the processes before this one come first */
+    long long preceding_size = 0;
+    MPI_Exscan(&packed_size, &preceding_size, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (process_rank == 0) {
+        preceding_size = 0;
+    }
+
+    long long total_size = 0;
+    MPI_Allreduce(&packed_size, &total_size, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    MPI_Offset data_offset = first_tile_offset(total_number_of_tiles);
+    MPI_File_set_size(*file_handle, data_offset + total_size);
+
+    offsets[0] = data_offset + preceding_size;
+    for (int tile = 0; tile < number_of_tiles; tile++) {
+        offsets[tile + 1] = offsets[tile] + sizes[tile];
+    }
+
+    unsigned char header[TILED_IMAGE_HEADER_SIZE];
+    encode_header(header, height, width, tile_size);
+
+    MPI_Status status;
+
+    MPI_File_write_at_all(*file_handle, 0, header, (process_rank == 0) ? TILED_IMAGE_HEADER_SIZE : 0, MPI_UNSIGNED_CHAR, &status);
+
+    /* The last process also writes the end of the file, which follows its last tile */
+    MPI_File_write_at_all(
+        *file_handle,
+        TILED_IMAGE_HEADER_SIZE + (MPI_Offset)first_tile * sizeof(long long),
+        offsets,
+        (number_of_tiles + ((process_rank == number_of_processes - 1) ? 1 : 0)) * sizeof(long long),
+        MPI_BYTE,
+        &status
+    );
+
+    transfer_band_at_all(file_handle, offsets[0], slots, packed_size, 1);
+
+    release_buffer(slots);
+    free(sizes);
+    free(offsets);
+}
+
+/* Reads a tiled image file, builds an Image struct and returns it */
+Image *read_image_from_tiled_image_file(const char *file_name) {
+    FILE *file = fopen(file_name, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open file %s\n", file_name);
+        return NULL;
+    }
+
+    unsigned char header[TILED_IMAGE_HEADER_SIZE];
+    int height;
+    int width;
+    int tile_size;
+    if (fread(header, sizeof(unsigned char), TILED_IMAGE_HEADER_SIZE, file) != TILED_IMAGE_HEADER_SIZE
+            || decode_header(header, &height, &width, &tile_size)) {
+        fprintf(stderr, "Error: Not a valid tiled image file\n");
+        fclose(file);
+        return NULL;
+    }
+
+    int number_of_tiles = ((height + tile_size - 1) / tile_size) * ((width + tile_size - 1) / tile_size);
+
+    long long file_size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        file_size = ftell(file);
+    }
+    if (file_size < 0 || fseek(file, TILED_IMAGE_HEADER_SIZE, SEEK_SET) != 0) {
+        fprintf(stderr, "Error: Could not read file %s\n", file_name);
+        fclose(file);
+        return NULL;
+    }
+
+    long long *offsets = (long long *)malloc((number_of_tiles + 1) * sizeof(long long));
+    RGB *data = (RGB *)malloc((size_t)height * width * sizeof(RGB));
+    Image *image = (Image *)malloc(sizeof(Image));
+    if (!offsets || !data || !image) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fclose(file);
+        free(offsets);
+        free(data);
+        free(image);
+        return NULL;
+    }
+
+    unsigned char *compressed = NULL;
+    int failed = (fread(offsets, sizeof(long long), number_of_tiles + 1, file) != (size_t)(number_of_tiles + 1)
+        || offsets[0] != first_tile_offset(number_of_tiles)
+        || check_tile_offsets(offsets, height, width, tile_size, offsets[0], file_size));
+
+    if (!failed) {
+        compressed = (unsigned char *)malloc(offsets[number_of_tiles] - offsets[0] + 1);
+        failed = !compressed
+            || fread(compressed, sizeof(unsigned char), offsets[number_of_tiles] - offsets[0], file) != (size_t)(offsets[number_of_tiles] - offsets[0])
+            || decompress_tiles(1, compressed, offsets, data, height, width, tile_size) > 0;
+    }
+
+    fclose(file);
+    free(compressed);
+    free(offsets);
+
+    if (failed) {
+        fprintf(stderr, "Error: Corrupt tiled image file %s\n", file_name);
+        free(data);
+        free(image);
+        return NULL;
+    }
+
+    image->width = width;
+    image->height = height;
+    image->data = data;
+
+    return image;
+}
+
+/* Saves an Image struct in the given file in the tiled image format */
+int save_image_to_tiled_image_file(const Image *image, const char *file_name) {
+    FILE *file = fopen(file_name, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not create file %s\n", file_name);
+        return 1;
+    }
+
+    int tile_size = TILED_IMAGE_TILE_SIZE;
+    int number_of_tiles = ((image->height + tile_size - 1) / tile_size) * ((image->width + tile_size - 1) / tile_size);
+
+    unsigned char *slots = (unsigned char *)malloc((size_t)number_of_tiles * lz_compress_bound(tile_size * tile_size * 3));
+    long long *sizes = (long long *)malloc((number_of_tiles + 1) * sizeof(long long));
+    long long *offsets = (long long *)malloc((number_of_tiles + 1) * sizeof(long long));
+    if (!slots || !sizes || !offsets) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fclose(file);
+        free(slots);
+        free(sizes);
+        free(offsets);
+        return 1;
+    }
+
+    compress_tiles(1, image->data, image->height, image->width, tile_size, slots, sizes);
+    long long packed_size = pack_tiles(slots, sizes, number_of_tiles, tile_size);
+
+    offsets[0] = first_tile_offset(number_of_tiles);
+    for (int tile = 0; tile < number_of_tiles; tile++) {
+        offsets[tile + 1] = offsets[tile] + sizes[tile];
+    }
+
+    unsigned char header[TILED_IMAGE_HEADER_SIZE];
+    encode_header(header, image->height, image->width, tile_size);
+
+    fwrite(header, sizeof(unsigned char), TILED_IMAGE_HEADER_SIZE, file);
+    fwrite(offsets, sizeof(long long), number_of_tiles + 1, file);
+    fwrite(slots, sizeof(unsigned char), packed_size, file);
+
+    fclose(file);
+
+    free(slots);
+    free(sizes);
+    free(offsets);
+
+    return 0;
+}
\ No newline at end of file
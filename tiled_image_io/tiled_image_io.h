@@ -0,0 +1,82 @@
+#ifndef TILED_IMAGE_IO_H
+#define TILED_IMAGE_IO_H
+
+#include "mpi.h"
+#include "../bmp_image.h"
+
+/*
+ * Tiled image files, selected by the .tlz extension, cut the image into square
+ * tiles stored top-down and row by row, each compressed on its own with the LZ
+ * codec, or left raw when that does not make it smaller. The header holds the
+ * magic "TLZ1", the width, the height and the tile size as 32-bit integers,
+ * followed by the 64-bit file offsets of every tile and of the end of the file,
+ * so that any tile can be located without decoding the others.
+ */
+
+#define TILED_IMAGE_FILE_EXTENSION ".tlz"
+
+/* Side of the tiles written, in pixels */
+#define TILED_IMAGE_TILE_SIZE 256
+
+/* Returns 1 when the file name has the tiled image extension */
+int is_tiled_image_file_name(
+    const char *file_name
+);
+
+void read_image_height_and_width_from_tiled_image_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    MPI_File *file_handle,      /* in */
+    int *image_height,          /* out */
+    int *image_width            /* out */
+);
+
+/* Reads and checks the header of a tiled image file, returning 1 instead of aborting when it is not one; not collective */
+int read_header_from_tiled_image_file(
+    MPI_File *file_handle,      /* in */
+    int *image_height,          /* out */
+    int *image_width            /* out */
+);
+
+/*
+ * Reads local_height rows starting at row first_row of the image, which may be
+ * partitioned in any way; collective. Every process decodes the tiles of its own
+ * share of tile rows and the rows are then moved to the strips that hold them.
+ */
+void read_strip_from_tiled_image_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int number_of_threads,      /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *initial_local_data,    /* out */
+    int local_height,           /* in */
+    int first_row               /* in */
+);
+
+/*
+ * Writes local_height rows starting at row first_row of the image, which may be
+ * partitioned in any way; collective. The rows are first moved so that every
+ * process holds whole tile rows, which it compresses, and the file offset of its
+ * tiles is the exclusive prefix sum of the compressed sizes of the others.
+ */
+void write_strip_to_tiled_image_file(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int number_of_threads,      /* in */
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    const RGB *new_local_data,  /* in */
+    int local_height,           /* in */
+    int first_row               /* in */
+);
+
+/* Reads a tiled image file, builds an Image struct and returns it */
+Image *read_image_from_tiled_image_file(const char *file_name);
+
+/* Saves an Image struct in the given file in the tiled image format */
+int save_image_to_tiled_image_file(const Image *image, const char *file_name);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "work_stealing.h"
+#include "../shared_file_system_bmp_io/shared_file_system_bmp_io.h"
+#include "../buffer_pool/buffer_pool.h"
+
+/* Returns the first block owned by the given process, its blocks following the static strips */
+static int first_owned_block(
+    int process_rank,           /* in */
+    int number_of_processes,    /* in */
+    int number_of_blocks        /* in */
+) {
+    int blocks_per_process = number_of_blocks / number_of_processes;
+    int rest = number_of_blocks % number_of_processes;
+    return process_rank * blocks_per_process + ((process_rank < rest) ? process_rank : rest);
+}
+
+/* Takes the next block of the owner, returning -1 once all of them are taken */
+static int take_block(
+    MPI_Win window,             /* in */
+    int owner,                  /* in */
+    int number_of_processes,    /* in */
+    int number_of_blocks        /* in */
+) {
+    int first = first_owned_block(owner, number_of_processes, number_of_blocks);
+    int last = first_owned_block(owner + 1, number_of_processes, number_of_blocks);
+
+    int one = 1;
+    int taken;
+    MPI_Fetch_and_op(&one, &taken, MPI_INT, owner, 0, MPI_SUM, window);
+    MPI_Win_flush(owner, window);
+
+    return (first + taken < last) ? first + taken : -1;
+}
+
+/* Reads the rows of a block and its halo, filling the halo outside the image with zeros or the nearest image row */
+static void read_block_with_padding(
+    MPI_File *file_handle,      /* in */
+    int height,                 /* in */
+    int width,                  /* in */
+    RGB *rows,                  /* out */
+    RGB *data_with_padding,     /* out */
+    int first_row,              /* in */
+    int block_height,           /* in */
+    int padding,                /* in */
+    int replicate               /* in */
+) {
+    int window_first_row = (first_row - padding > 0) ? first_row - padding : 0;
+    int window_last_row = (first_row + block_height + padding < height) ? first_row + block_height + padding : height;
+
+    read_rows_from_BMP_file(file_handle, height, width, rows, window_last_row - window_first_row, window_first_row);
+
+    int width_with_padding = width + 2 * padding;
+
+    for (int y = 0; y < block_height + 2 * padding; y++) {
+        int image_row = first_row - padding + y;
+        int row_inside = (image_row >= 0 && image_row < height);
+        if (image_row < 0) image_row = 0;
+        if (image_row > height - 1) image_row = height - 1;
+
+        RGB *row = data_with_padding + y * width_with_padding;
+        if (row_inside || replicate) {
+            const RGB *source = rows + (image_row - window_first_row) * width;
+            memcpy(row + padding, source, width * sizeof(RGB));
+            for (int x = 0; x < padding; x++) {
+                row[x] = replicate ? source[0] : (RGB){ 0 };
+                row[padding + width + x] = replicate ? source[width - 1] : (RGB){ 0 };
+            }
+        } else {
+            memset(row, 0, width_with_padding * sizeof(RGB));
+        }
+    }
+}
+
+void process_with_work_stealing(
+    int process_rank,               /* in */
+    int number_of_processes,        /* in */
+    int number_of_threads,          /* in */
+    const Operation *operation,     /* in */
+    const char *in_file_name,       /* in */
+    const char *out_file_name       /* in */
+) {
+    double start_time = MPI_Wtime();
+
+    MPI_File in_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, in_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", in_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int height;
+    int width;
+    read_image_height_and_width_from_BMP_file(process_rank, number_of_processes, &in_file_handle, &height, &width);
+
+    BMPLayout layout;
+    read_BMP_layout_from_BMP_file(&in_file_handle, &layout);
+
+    int padding = operation_padding(operation, height);
+    int replicate = operation_replicates_borders(operation);
+
+    int block_rows = 4 * padding;
+    if (block_rows < WORK_STEALING_MIN_BLOCK_ROWS) {
+        block_rows = WORK_STEALING_MIN_BLOCK_ROWS;
+    }
+    int number_of_blocks = (height + block_rows - 1) / block_rows;
+
+    MPI_File out_file_handle;
+    if (MPI_File_open(MPI_COMM_WORLD, out_file_name, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &out_file_handle) != MPI_SUCCESS) {
+        if (process_rank == 0) {
+            fprintf(stderr, "Error opening %s\n", out_file_name);
+            fflush(stderr);
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* MPI_MODE_CREATE keeps the bytes of an existing file, which may be longer than the new one */
+    int row_with_padding_size = (width * layout.bytes_per_pixel + 3) & (~3);
+    MPI_File_set_size(out_file_handle, 54 + (MPI_Offset)height * row_with_padding_size);
+
+    if (process_rank == 0) {
+        write_BMP_header_to_BMP_file(&out_file_handle, height, width, &layout);
+    }
+
+    /* The counter of the blocks taken from this process */
+    int *taken_blocks;
+    MPI_Win window;
+    MPI_Win_allocate(sizeof(int), sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD, &taken_blocks, &window);
+    /* The counter is set within the epoch and synced before any process may fetch it */
+    MPI_Win_lock_all(0, window);
+    *taken_blocks = 0;
+    MPI_Win_sync(window);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    int width_with_padding = width + 2 * padding;
+    int height_with_padding = block_rows + 2 * padding;
+
+    RGB *rows = (RGB *)acquire_buffer(((size_t)height_with_padding * width + 1) * sizeof(RGB));
+    RGB *data_with_padding = (RGB *)acquire_image_buffer(((size_t)height_with_padding * width_with_padding + 1) * sizeof(RGB), width_with_padding * sizeof(RGB), number_of_threads);
+    RGB *new_data = (RGB *)acquire_image_buffer(((size_t)block_rows * width + 1) * sizeof(RGB), width * sizeof(RGB), number_of_threads);
+
+    /* Blocks processed, of which stolen, and the time spent on them */
+    int counts[2] = { 0, 0 };
+    double busy_time = 0.0;
+
+    /* Own blocks first, then those of the next processes in turn */
+    for (int i = 0; i < number_of_processes; i++) {
+        int owner = (process_rank + i) % number_of_processes;
+
+        int block;
+        while ((block = take_block(window, owner, number_of_processes, number_of_blocks)) >= 0) {
+            double block_start_time = MPI_Wtime();
+
+            int first_row = block * block_rows;
+            int block_height = (first_row + block_rows < height) ? block_rows : height - first_row;
+
+            read_block_with_padding(&in_file_handle, height, width, rows, data_with_padding, first_row, block_height, padding, replicate);
+
+            apply_operation(
+                number_of_threads,
+                operation,
+                data_with_padding,
+                block_height + 2 * padding,
+                width_with_padding,
+                new_data,
+                block_height,
+                width,
+                padding,
+                first_row,
+                height,
+                MPI_COMM_SELF
+            );
+
+            write_rows_to_BMP_file(&out_file_handle, height, width, new_data, block_height, first_row, &layout);
+
+            counts[0]++;
+            counts[1] += (owner != process_rank);
+            busy_time += MPI_Wtime() - block_start_time;
+        }
+    }
+
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+
+    release_buffer(rows);
+    release_buffer(data_with_padding);
+    release_buffer(new_data);
+
+    MPI_File_close(&out_file_handle);
+    MPI_File_close(&in_file_handle);
+
+    int *all_counts = (int *)malloc(2 * number_of_processes * sizeof(int));
+    double *busy_times = (double *)malloc(number_of_processes * sizeof(double));
+    if (!all_counts || !busy_times) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    MPI_Gather(counts, 2, MPI_INT, all_counts, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gather(&busy_time, 1, MPI_DOUBLE, busy_times, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (process_rank == 0) {
+        fprintf(stdout, "\n%d blocks of %d rows:\n", number_of_blocks, block_rows);
+        for (int i = 0; i < number_of_processes; i++) {
+            fprintf(stdout, "  process %d: %d blocks, %d stolen, %f seconds busy\n", i, all_counts[2 * i], all_counts[2 * i + 1], busy_times[i]);
+        }
+        fprintf(stdout, "%dx%d image saved in file %s in %f seconds\n", width, height, out_file_name, MPI_Wtime() - start_time);
+        fflush(stdout);
+    }
+
+    free(all_counts);
+    free(busy_times);
+}
\ No newline at end of file
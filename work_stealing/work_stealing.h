@@ -0,0 +1,28 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include "../operations/operations.h"
+
+/* Fewest rows of a block, so that reading its halo stays cheap next to its own rows */
+#define WORK_STEALING_MIN_BLOCK_ROWS 32
+
+/*
+ * Applies the operation block of rows by block of rows, balancing the load
+ * dynamically. Every process owns the blocks of its static strip and a counter
+ * of those already taken, exposed in an RMA window; it takes its own blocks
+ * with MPI_Fetch_and_op() on that counter and, once they run out, steals the
+ * remaining blocks of the other processes the same way. Every block is read
+ * with its halo straight from the input file and written at its offset in the
+ * output file, both independently of the other processes. The caller has
+ * checked operation_is_tile_local().
+ */
+void process_with_work_stealing(
+    int process_rank,
+    int number_of_processes,
+    int number_of_threads,
+    const Operation *operation,
+    const char *in_file_name,
+    const char *out_file_name
+);
+
+#endif
\ No newline at end of file